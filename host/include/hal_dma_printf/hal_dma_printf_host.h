@@ -0,0 +1,141 @@
+/**
+ * @file hal_dma_printf_host.h
+ * @brief Control of the simulated UART, clock and interrupts of host builds
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * With HAL_DMA_PRINTF_ENABLE_HOST_HAL=ON the library is built against the
+ * stand-in usart.h in host/include, so application tests link the real
+ * library on a development machine. This header drives that environment:
+ *
+ * - Time is simulated. It only advances through HalDmaPrintfHostAdvance,
+ *   HalDmaPrintfHostRunUntilIdle, blocking HAL_UART_Transmit calls and a
+ *   fixed step on every HAL_GetTick call (CPU time spent polling).
+ * - A DMA transfer takes its line time at the configured baud rate. Its
+ *   bytes are read from memory when it completes, so data overwritten while
+ *   in flight shows up corrupted, as it would on the wire.
+ * - Completion interrupts run when due and PRIMASK is clear: inside
+ *   HAL_GetTick, __enable_irq/__set_PRIMASK(0) and the functions above.
+ *   __get_IPSR is non-zero while they run.
+ * - RX bytes are written into the RX DMA buffer by
+ *   HalDmaPrintfHostInjectRx. The line goes idle at the end of each call,
+ *   which ends a HAL_UARTEx_ReceiveToIdle_DMA reception.
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_HOST_HAL=ON in CMake
+ *
+ * @code
+ * MX_USART1_UART_Init();
+ * HalDmaPrintfSetup(&huart1, false);
+ * HalDmaPrintfHostPrintf("speed=%d\r\n", 42);
+ * HalDmaPrintfHostRunUntilIdle(1000000);
+ * uint8_t out[64];
+ * size_t n = HalDmaPrintfHostReadOutput(&huart1, out, sizeof(out));
+ * @endcode
+ */
+
+#ifndef HAL_DMA_PRINTF_HOST_H
+#define HAL_DMA_PRINTF_HOST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "usart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Counters of one simulated UART
+ */
+typedef struct {
+  uint32_t tx_bytes;         /**< Bytes put on the wire */
+  uint32_t tx_transfers;     /**< Completed DMA transfers */
+  uint32_t tx_busy_rejects;  /**< HAL_UART_Transmit_DMA calls while busy */
+  uint32_t tx_max_transfer;  /**< Largest DMA transfer in bytes */
+  uint64_t tx_line_busy_us;  /**< Time the TX line was sending */
+  uint32_t rx_bytes;         /**< Injected bytes stored by RX DMA */
+  uint32_t rx_dropped;       /**< Injected bytes with no RX DMA running */
+} HalDmaPrintfHostUartStats;
+
+/**
+ * @brief Current simulated time
+ * @return Microseconds since start (HAL_GetTick() is this / 1000)
+ */
+uint64_t HalDmaPrintfHostGetTimeUs(void);
+
+/**
+ * @brief Advance simulated time, running completions as they fall due
+ * @param us Microseconds to advance
+ */
+void HalDmaPrintfHostAdvance(uint32_t us);
+
+/**
+ * @brief Advance simulated time until no DMA transfer is in flight
+ * @param max_us Upper bound on the time to advance
+ * @return true if every UART went idle, false on timeout or if PRIMASK is set
+ * @details With HAL_DMA_PRINTF_ENABLE_DEFERRED, queued data only moves on
+ * when HalDmaPrintfRunDeferred is called, e.g. from a deferred trigger set
+ * with HalDmaPrintfSetDeferredTrigger.
+ */
+bool HalDmaPrintfHostRunUntilIdle(uint32_t max_us);
+
+/**
+ * @brief Set the simulated CPU time consumed by each HAL_GetTick call
+ * @param us Microseconds per call (default 1; 0 stops time while polling,
+ * so blocking waits never time out)
+ */
+void HalDmaPrintfHostSetPollStep(uint32_t us);
+
+/**
+ * @brief Take bytes sent by a UART
+ * @param huart UART handle
+ * @param[out] buffer Destination
+ * @param size Size of buffer
+ * @return Number of bytes copied; they are removed from the capture
+ */
+size_t HalDmaPrintfHostReadOutput(UART_HandleTypeDef* huart, uint8_t* buffer,
+                                  size_t size);
+
+/**
+ * @brief Receive bytes on a UART
+ * @param huart UART handle
+ * @param data Bytes arriving on the line
+ * @param size Number of bytes
+ * @return Number of bytes stored by RX DMA
+ */
+size_t HalDmaPrintfHostInjectRx(UART_HandleTypeDef* huart,
+                                const uint8_t* data, size_t size);
+
+/**
+ * @brief Get counters of a UART
+ * @param huart UART handle
+ * @param[out] stats Counters since HAL_UART_Init or the last reset
+ * @return true on success, false if huart was not initialized
+ */
+bool HalDmaPrintfHostGetStats(UART_HandleTypeDef* huart,
+                              HalDmaPrintfHostUartStats* stats);
+
+/**
+ * @brief Reset counters of a UART
+ * @param huart UART handle
+ */
+void HalDmaPrintfHostResetStats(UART_HandleTypeDef* huart);
+
+/**
+ * @brief printf to file descriptor 1 through the library's _write
+ * @param format printf format
+ * @return Value returned by _write, or -1 if formatting failed
+ * @details The host C library does not call _write, so this routes a
+ * formatted message like newlib's printf does on the target.
+ */
+int HalDmaPrintfHostPrintf(const char* format, ...)
+    __attribute__((format(printf, 1, 2)));
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // HAL_DMA_PRINTF_HOST_H
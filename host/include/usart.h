@@ -0,0 +1,245 @@
+/**
+ * @file usart.h
+ * @brief Host stand-in for the CubeMX usart.h and the STM32 HAL it pulls in
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * Declares the subset of the STM32F4 HAL, CMSIS core and CubeMX usart.h
+ * that hal-dma-printf uses, with the same names and layouts, so the library
+ * and code calling it compile and run on a Linux/macOS host. The behaviour
+ * behind it (a simulated UART with DMA, clock and interrupt mask) lives in
+ * host/src/hal_dma_printf_host.cc and is controlled through
+ * hal_dma_printf/hal_dma_printf_host.h.
+ *
+ * @note Only on the include path with HAL_DMA_PRINTF_ENABLE_HOST_HAL=ON.
+ *       Never use it in a firmware build.
+ */
+
+#ifndef HAL_DMA_PRINTF_HOST_USART_H
+#define HAL_DMA_PRINTF_HOST_USART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// stm32f4xx_hal_conf.h: the library requires registered callbacks
+#define USE_HAL_UART_REGISTER_CALLBACKS 1
+
+// ============================================================================
+// Generic HAL definitions (stm32f4xx_hal_def.h)
+// ============================================================================
+
+typedef enum {
+  HAL_OK = 0x00U,
+  HAL_ERROR = 0x01U,
+  HAL_BUSY = 0x02U,
+  HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum { HAL_UNLOCKED = 0x00U, HAL_LOCKED = 0x01U } HAL_LockTypeDef;
+
+#define SET_BIT(REG, BIT) ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT) ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT) ((REG) & (BIT))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK) \
+  ((REG) = (((REG) & (~(CLEARMASK))) | (SETMASK)))
+
+// ============================================================================
+// Peripheral registers (stm32f4xx.h)
+// ============================================================================
+
+typedef struct {
+  volatile uint32_t SR;
+  volatile uint32_t DR;
+  volatile uint32_t BRR;
+  volatile uint32_t CR1;
+  volatile uint32_t CR2;
+  volatile uint32_t CR3;
+  volatile uint32_t GTPR;
+} USART_TypeDef;
+
+typedef struct {
+  volatile uint32_t CR;
+  volatile uint32_t NDTR;
+  volatile uint32_t PAR;
+  volatile uint32_t M0AR;
+  volatile uint32_t M1AR;
+  volatile uint32_t FCR;
+} DMA_Stream_TypeDef;
+
+#define USART_CR1_M 0x00001000U
+#define USART_CR2_STOP_1 0x00002000U
+#define USART_CR3_DMAR 0x00000040U
+#define USART_CR3_DMAT 0x00000080U
+
+#define DMA_SxCR_EN 0x00000001U
+#define DMA_SxCR_DMEIE 0x00000002U
+#define DMA_SxCR_TEIE 0x00000004U
+#define DMA_SxCR_HTIE 0x00000008U
+#define DMA_SxCR_TCIE 0x00000010U
+#define DMA_SxCR_CIRC 0x00000100U
+
+#define DMA_FLAG_FEIF0_4 0x00000001U
+#define DMA_FLAG_DMEIF0_4 0x00000004U
+#define DMA_FLAG_TEIF0_4 0x00000008U
+#define DMA_FLAG_HTIF0_4 0x00000010U
+#define DMA_FLAG_TCIF0_4 0x00000020U
+
+// ============================================================================
+// DMA (stm32f4xx_hal_dma.h)
+// ============================================================================
+
+#define DMA_NORMAL 0x00000000U
+#define DMA_CIRCULAR DMA_SxCR_CIRC
+
+typedef struct {
+  uint32_t Mode; /**< DMA_NORMAL or DMA_CIRCULAR */
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef {
+  DMA_Stream_TypeDef* Instance;
+  DMA_InitTypeDef Init;
+  void* Parent;
+  uint32_t StreamBaseAddress;
+  uint32_t StreamIndex;
+} DMA_HandleTypeDef;
+
+// ============================================================================
+// UART (stm32f4xx_hal_uart.h)
+// ============================================================================
+
+#define UART_WORDLENGTH_8B 0x00000000U
+#define UART_WORDLENGTH_9B USART_CR1_M
+#define UART_STOPBITS_1 0x00000000U
+#define UART_STOPBITS_2 USART_CR2_STOP_1
+#define UART_PARITY_NONE 0x00000000U
+#define UART_MODE_TX_RX 0x0000000CU
+#define UART_HWCONTROL_NONE 0x00000000U
+#define UART_OVERSAMPLING_16 0x00000000U
+
+typedef struct {
+  uint32_t BaudRate;  /**< 0: transfers complete without line time */
+  uint32_t WordLength;
+  uint32_t StopBits;
+  uint32_t Parity;
+  uint32_t Mode;
+  uint32_t HwFlowCtl;
+  uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef enum {
+  HAL_UART_STATE_RESET = 0x00U,
+  HAL_UART_STATE_READY = 0x20U,
+  HAL_UART_STATE_BUSY = 0x24U,
+  HAL_UART_STATE_BUSY_TX = 0x21U,
+  HAL_UART_STATE_BUSY_RX = 0x22U,
+  HAL_UART_STATE_BUSY_TX_RX = 0x23U,
+  HAL_UART_STATE_TIMEOUT = 0xA0U,
+  HAL_UART_STATE_ERROR = 0xE0U
+} HAL_UART_StateTypeDef;
+
+typedef enum {
+  HAL_UART_TX_HALFCOMPLETE_CB_ID = 0x00U,
+  HAL_UART_TX_COMPLETE_CB_ID = 0x01U,
+  HAL_UART_RX_HALFCOMPLETE_CB_ID = 0x02U,
+  HAL_UART_RX_COMPLETE_CB_ID = 0x03U,
+  HAL_UART_ERROR_CB_ID = 0x04U,
+  HAL_UART_ABORT_COMPLETE_CB_ID = 0x05U,
+  HAL_UART_ABORT_TRANSMIT_COMPLETE_CB_ID = 0x06U,
+  HAL_UART_ABORT_RECEIVE_COMPLETE_CB_ID = 0x07U
+} HAL_UART_CallbackIDTypeDef;
+
+typedef struct __UART_HandleTypeDef {
+  USART_TypeDef* Instance;
+  UART_InitTypeDef Init;
+  DMA_HandleTypeDef* hdmatx;
+  DMA_HandleTypeDef* hdmarx;
+  HAL_LockTypeDef Lock;
+  volatile HAL_UART_StateTypeDef gState;
+  volatile HAL_UART_StateTypeDef RxState;
+  volatile uint32_t ErrorCode;
+
+  void (*TxHalfCpltCallback)(struct __UART_HandleTypeDef* huart);
+  void (*TxCpltCallback)(struct __UART_HandleTypeDef* huart);
+  void (*RxHalfCpltCallback)(struct __UART_HandleTypeDef* huart);
+  void (*RxCpltCallback)(struct __UART_HandleTypeDef* huart);
+  void (*ErrorCallback)(struct __UART_HandleTypeDef* huart);
+  void (*AbortCpltCallback)(struct __UART_HandleTypeDef* huart);
+  void (*AbortTransmitCpltCallback)(struct __UART_HandleTypeDef* huart);
+  void (*AbortReceiveCpltCallback)(struct __UART_HandleTypeDef* huart);
+  void (*RxEventCallback)(struct __UART_HandleTypeDef* huart, uint16_t Pos);
+} UART_HandleTypeDef;
+
+typedef void (*pUART_CallbackTypeDef)(UART_HandleTypeDef* huart);
+typedef void (*pUART_RxEventCallbackTypeDef)(UART_HandleTypeDef* huart,
+                                             uint16_t Pos);
+
+/**
+ * @brief Configure the simulated UART from huart->Init
+ * @details Stands in for HAL_UART_Init plus HAL_UART_MspInit: the handle
+ * gets simulated USART registers and TX/RX DMA streams (RX circular), as a
+ * CubeMX project with both DMA requests configured would.
+ */
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_RegisterCallback(UART_HandleTypeDef* huart,
+                                            HAL_UART_CallbackIDTypeDef id,
+                                            pUART_CallbackTypeDef callback);
+HAL_StatusTypeDef HAL_UART_RegisterRxEventCallback(
+    UART_HandleTypeDef* huart, pUART_RxEventCallbackTypeDef callback);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart,
+                                    const uint8_t* data, uint16_t size,
+                                    uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart,
+                                        const uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef* huart,
+                                       uint8_t* data, uint16_t size);
+
+/**
+ * @brief Receive until the buffer is full or the line goes idle
+ * @details RxEventCallback replaces the RX complete callbacks: at half
+ * (RxState still busy), when full and when idle, with the bytes received.
+ * Idle is detected at the end of each HalDmaPrintfHostInjectRx call.
+ */
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef* huart,
+                                               uint8_t* data, uint16_t size);
+
+// ============================================================================
+// System (stm32f4xx_hal.h, system_stm32f4xx.h)
+// ============================================================================
+
+uint32_t HAL_GetTick(void);
+extern uint32_t SystemCoreClock;
+
+// ============================================================================
+// Core intrinsics (cmsis_gcc.h)
+// ============================================================================
+
+/** @brief Simulated PRIMASK; completions wait while it is set */
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+void __disable_irq(void);
+void __enable_irq(void);
+
+/** @brief Non-zero while a simulated completion interrupt runs */
+uint32_t __get_IPSR(void);
+
+// ============================================================================
+// CubeMX usart.h
+// ============================================================================
+
+extern UART_HandleTypeDef huart1;
+extern UART_HandleTypeDef huart2;
+
+/** @brief Initialize huart1/huart2 at 115200 baud, 8N1 */
+void MX_USART1_UART_Init(void);
+void MX_USART2_UART_Init(void);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // HAL_DMA_PRINTF_HOST_USART_H
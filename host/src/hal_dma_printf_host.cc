@@ -0,0 +1,517 @@
+/**
+ * @file hal_dma_printf_host.cc
+ * @brief Simulated UART, DMA, clock and interrupt mask behind host/usart.h
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf/hal_dma_printf_host.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "usart.h"
+
+// Library output hook (src/hal_dma_printf.cc)
+extern "C" int _write(int file, char* ptr, int len);
+
+// Number of UART handles that can be initialized
+#ifndef HAL_DMA_PRINTF_HOST_MAX_UARTS
+#define HAL_DMA_PRINTF_HOST_MAX_UARTS 4
+#endif
+
+namespace {
+
+// IPSR while a completion runs: exception number of DMA2_Stream7_IRQn (70)
+constexpr uint32_t kDmaExceptionNumber = 16 + 70;
+
+/**
+ * @brief State of one simulated UART with its TX and RX DMA streams
+ */
+struct SimUart {
+  UART_HandleTypeDef* huart;
+  USART_TypeDef registers;
+  DMA_HandleTypeDef hdmatx;
+  DMA_HandleTypeDef hdmarx;
+  DMA_Stream_TypeDef tx_stream;
+  DMA_Stream_TypeDef rx_stream;
+
+  // Transfer in flight (tx_data == nullptr: idle)
+  const uint8_t* tx_data;
+  uint16_t tx_size;
+  uint64_t tx_start_ns;
+  uint64_t tx_end_ns;
+
+  // RX DMA target (rx_data == nullptr: not receiving)
+  uint8_t* rx_data;
+  uint16_t rx_size;
+  bool rx_to_idle;  // Started by HAL_UARTEx_ReceiveToIdle_DMA
+
+  std::vector<uint8_t> output;
+  HalDmaPrintfHostUartStats stats;
+};
+
+SimUart g_uarts[HAL_DMA_PRINTF_HOST_MAX_UARTS];
+int g_uart_count = 0;
+
+uint64_t g_now_ns = 0;
+uint64_t g_poll_step_ns = 1000;
+uint32_t g_primask = 0;
+bool g_in_interrupt = false;
+
+/**
+ * @brief Find the simulated UART of a handle
+ * @param huart UART handle
+ * @return Simulated UART, or nullptr if HAL_UART_Init was not called on it
+ */
+SimUart* FindUart(const UART_HandleTypeDef* huart) {
+  for (int i = 0; i < g_uart_count; ++i) {
+    if (g_uarts[i].huart == huart) { return &g_uarts[i]; }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Line time of a number of characters
+ * @param huart UART handle
+ * @param size Number of characters
+ * @return Nanoseconds (0 at baud rate 0)
+ */
+uint64_t GetLineTimeNs(const UART_HandleTypeDef* huart, uint32_t size) {
+  const UART_InitTypeDef& init = huart->Init;
+  if (init.BaudRate == 0) { return 0; }
+
+  // Start bit, data bits (parity included), stop bits
+  const uint64_t bits = 1U +
+                        ((init.WordLength == UART_WORDLENGTH_9B) ? 9U : 8U) +
+                        ((init.StopBits == UART_STOPBITS_2) ? 2U : 1U);
+  return size * bits * 1000000000ULL / init.BaudRate;
+}
+
+/**
+ * @brief Run a UART interrupt handler the way the NVIC would
+ * @param huart UART handle
+ * @param callback Registered callback (may be nullptr)
+ */
+void RaiseInterrupt(UART_HandleTypeDef* huart,
+                    void (*callback)(UART_HandleTypeDef*)) {
+  if (callback == nullptr) { return; }
+  const bool was_in_interrupt = g_in_interrupt;
+  g_in_interrupt = true;
+  callback(huart);
+  g_in_interrupt = was_in_interrupt;
+}
+
+/**
+ * @brief Run the RX event handler the way the NVIC would
+ * @param huart UART handle
+ * @param pos Bytes received into the buffer
+ */
+void RaiseRxEvent(UART_HandleTypeDef* huart, uint16_t pos) {
+  if (huart->RxEventCallback == nullptr) { return; }
+  const bool was_in_interrupt = g_in_interrupt;
+  g_in_interrupt = true;
+  huart->RxEventCallback(huart, pos);
+  g_in_interrupt = was_in_interrupt;
+}
+
+/**
+ * @brief Finish the transfer in flight and raise its completion
+ * @param uart Simulated UART
+ */
+void CompleteTransmit(SimUart& uart) {
+  // DMA reads memory as the bytes go out, so take them only now
+  uart.output.insert(uart.output.end(), uart.tx_data,
+                     uart.tx_data + uart.tx_size);
+  uart.stats.tx_bytes += uart.tx_size;
+  ++uart.stats.tx_transfers;
+  if (uart.tx_size > uart.stats.tx_max_transfer) {
+    uart.stats.tx_max_transfer = uart.tx_size;
+  }
+  uart.stats.tx_line_busy_us += (uart.tx_end_ns - uart.tx_start_ns) / 1000U;
+
+  uart.tx_data = nullptr;
+  uart.tx_stream.NDTR = 0;
+  CLEAR_BIT(uart.tx_stream.CR, DMA_SxCR_EN);
+  uart.huart->gState = HAL_UART_STATE_READY;
+  RaiseInterrupt(uart.huart, uart.huart->TxCpltCallback);
+}
+
+/**
+ * @brief Find the transfer that completes first
+ * @return Simulated UART, or nullptr if every UART is idle
+ */
+SimUart* FindNextCompletion() {
+  SimUart* next = nullptr;
+  for (int i = 0; i < g_uart_count; ++i) {
+    SimUart& uart = g_uarts[i];
+    if (uart.tx_data == nullptr) { continue; }
+    if (next == nullptr || uart.tx_end_ns < next->tx_end_ns) { next = &uart; }
+  }
+  return next;
+}
+
+/**
+ * @brief Run completions due by a point in time, in order
+ * @param until_ns Latest completion time to run
+ * @details Time is moved to each completion before its interrupt runs, so
+ * transfers started from a callback begin when the previous one ended.
+ * Nothing runs while PRIMASK is set or inside an interrupt (no nesting).
+ */
+void ServiceInterrupts(uint64_t until_ns) {
+  while (g_primask == 0 && !g_in_interrupt) {
+    SimUart* next = FindNextCompletion();
+    if (next == nullptr || next->tx_end_ns > until_ns) { return; }
+    if (next->tx_end_ns > g_now_ns) { g_now_ns = next->tx_end_ns; }
+    CompleteTransmit(*next);
+  }
+}
+
+/**
+ * @brief Store one received byte in the RX DMA buffer
+ * @param uart Simulated UART
+ * @param byte Received byte
+ * @return true if RX DMA took the byte
+ */
+bool ReceiveByte(SimUart& uart, uint8_t byte) {
+  if (uart.rx_data == nullptr) { return false; }
+
+  UART_HandleTypeDef* huart = uart.huart;
+  uart.rx_data[uart.rx_size - uart.rx_stream.NDTR] = byte;
+  --uart.rx_stream.NDTR;
+  ++uart.stats.rx_bytes;
+
+  // Completion first: a one-byte transfer has no separate half event
+  if (uart.rx_stream.NDTR == 0) {
+    const bool to_idle = uart.rx_to_idle;
+    const uint16_t size = uart.rx_size;
+    if (huart->hdmarx->Init.Mode == DMA_CIRCULAR) {
+      uart.rx_stream.NDTR = uart.rx_size;
+    } else {
+      uart.rx_data = nullptr;
+      CLEAR_BIT(uart.rx_stream.CR, DMA_SxCR_EN);
+      huart->RxState = HAL_UART_STATE_READY;
+    }
+    if (to_idle) {
+      RaiseRxEvent(huart, size);
+    } else {
+      RaiseInterrupt(huart, huart->RxCpltCallback);
+    }
+  } else if (uart.rx_stream.NDTR == uart.rx_size / 2U) {
+    if (uart.rx_to_idle) {
+      RaiseRxEvent(huart, uart.rx_size / 2U);
+    } else {
+      RaiseInterrupt(huart, huart->RxHalfCpltCallback);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Raise the idle line event of a to-idle reception
+ * @param uart Simulated UART
+ * @details As in the HAL, a Normal mode transfer is stopped first, so the
+ * callback may start the next one.
+ */
+void IdleLine(SimUart& uart) {
+  if (uart.rx_data == nullptr || !uart.rx_to_idle) { return; }
+
+  UART_HandleTypeDef* huart = uart.huart;
+  const uint16_t received =
+      static_cast<uint16_t>(uart.rx_size - uart.rx_stream.NDTR);
+  if (received == 0) { return; }
+  if (huart->hdmarx->Init.Mode != DMA_CIRCULAR) {
+    uart.rx_data = nullptr;
+    CLEAR_BIT(uart.rx_stream.CR, DMA_SxCR_EN);
+    huart->RxState = HAL_UART_STATE_READY;
+  }
+  RaiseRxEvent(huart, received);
+}
+
+/**
+ * @brief Initialize a handle the way MX_USARTx_UART_Init does
+ * @param huart UART handle
+ */
+void InitDefaultUart(UART_HandleTypeDef* huart) {
+  huart->Init.BaudRate = 115200;
+  huart->Init.WordLength = UART_WORDLENGTH_8B;
+  huart->Init.StopBits = UART_STOPBITS_1;
+  huart->Init.Parity = UART_PARITY_NONE;
+  huart->Init.Mode = UART_MODE_TX_RX;
+  huart->Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  huart->Init.OverSampling = UART_OVERSAMPLING_16;
+  HAL_UART_Init(huart);
+}
+
+}  // anonymous namespace
+
+// ============================================================================
+// HAL and CMSIS stand-ins
+// ============================================================================
+
+uint32_t SystemCoreClock = 168000000U;
+
+UART_HandleTypeDef huart1;
+UART_HandleTypeDef huart2;
+
+extern "C" HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart) {
+  if (huart == nullptr) { return HAL_ERROR; }
+
+  SimUart* uart = FindUart(huart);
+  if (uart == nullptr) {
+    if (g_uart_count >= HAL_DMA_PRINTF_HOST_MAX_UARTS) { return HAL_ERROR; }
+    uart = &g_uarts[g_uart_count++];
+  }
+  uart->huart = huart;
+  uart->registers = USART_TypeDef{};
+  uart->tx_stream = DMA_Stream_TypeDef{};
+  uart->rx_stream = DMA_Stream_TypeDef{};
+  uart->tx_data = nullptr;
+  uart->rx_data = nullptr;
+  uart->rx_to_idle = false;
+  uart->output.clear();
+  uart->stats = HalDmaPrintfHostUartStats{};
+
+  // __HAL_LINKDMA as generated into HAL_UART_MspInit
+  uart->hdmatx = DMA_HandleTypeDef{};
+  uart->hdmatx.Instance = &uart->tx_stream;
+  uart->hdmatx.Init.Mode = DMA_NORMAL;
+  uart->hdmatx.Parent = huart;
+  uart->hdmarx = DMA_HandleTypeDef{};
+  uart->hdmarx.Instance = &uart->rx_stream;
+  uart->hdmarx.Init.Mode = DMA_CIRCULAR;
+  uart->hdmarx.Parent = huart;
+
+  huart->Instance = &uart->registers;
+  huart->hdmatx = &uart->hdmatx;
+  huart->hdmarx = &uart->hdmarx;
+  huart->Lock = HAL_UNLOCKED;
+  huart->ErrorCode = 0;
+  huart->gState = HAL_UART_STATE_READY;
+  huart->RxState = HAL_UART_STATE_READY;
+  return HAL_OK;
+}
+
+extern "C" HAL_StatusTypeDef HAL_UART_RegisterCallback(
+    UART_HandleTypeDef* huart, HAL_UART_CallbackIDTypeDef id,
+    pUART_CallbackTypeDef callback) {
+  if (huart == nullptr || callback == nullptr) { return HAL_ERROR; }
+
+  switch (id) {
+    case HAL_UART_TX_HALFCOMPLETE_CB_ID:
+      huart->TxHalfCpltCallback = callback;
+      break;
+    case HAL_UART_TX_COMPLETE_CB_ID:
+      huart->TxCpltCallback = callback;
+      break;
+    case HAL_UART_RX_HALFCOMPLETE_CB_ID:
+      huart->RxHalfCpltCallback = callback;
+      break;
+    case HAL_UART_RX_COMPLETE_CB_ID:
+      huart->RxCpltCallback = callback;
+      break;
+    case HAL_UART_ERROR_CB_ID:
+      huart->ErrorCallback = callback;
+      break;
+    case HAL_UART_ABORT_COMPLETE_CB_ID:
+      huart->AbortCpltCallback = callback;
+      break;
+    case HAL_UART_ABORT_TRANSMIT_COMPLETE_CB_ID:
+      huart->AbortTransmitCpltCallback = callback;
+      break;
+    case HAL_UART_ABORT_RECEIVE_COMPLETE_CB_ID:
+      huart->AbortReceiveCpltCallback = callback;
+      break;
+    default:
+      return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+extern "C" HAL_StatusTypeDef HAL_UART_RegisterRxEventCallback(
+    UART_HandleTypeDef* huart, pUART_RxEventCallbackTypeDef callback) {
+  if (huart == nullptr || callback == nullptr) { return HAL_ERROR; }
+  huart->RxEventCallback = callback;
+  return HAL_OK;
+}
+
+extern "C" HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart,
+                                               const uint8_t* data,
+                                               uint16_t size,
+                                               uint32_t timeout) {
+  static_cast<void>(timeout);
+  SimUart* uart = FindUart(huart);
+  if (uart == nullptr || data == nullptr || size == 0) { return HAL_ERROR; }
+  if (huart->gState != HAL_UART_STATE_READY) { return HAL_BUSY; }
+
+  // Polled transfer: the CPU waits out the line time, interrupts still run
+  uart->output.insert(uart->output.end(), data, data + size);
+  uart->stats.tx_bytes += size;
+  const uint64_t line_time_ns = GetLineTimeNs(huart, size);
+  uart->stats.tx_line_busy_us += line_time_ns / 1000U;
+  const uint64_t end_ns = g_now_ns + line_time_ns;
+  ServiceInterrupts(end_ns);
+  if (end_ns > g_now_ns) { g_now_ns = end_ns; }
+  return HAL_OK;
+}
+
+extern "C" HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart,
+                                                   const uint8_t* data,
+                                                   uint16_t size) {
+  SimUart* uart = FindUart(huart);
+  if (uart == nullptr || data == nullptr || size == 0) { return HAL_ERROR; }
+  if (huart->gState != HAL_UART_STATE_READY) {
+    ++uart->stats.tx_busy_rejects;
+    return HAL_BUSY;
+  }
+
+  huart->gState = HAL_UART_STATE_BUSY_TX;
+  uart->tx_data = data;
+  uart->tx_size = size;
+  uart->tx_start_ns = g_now_ns;
+  uart->tx_end_ns = g_now_ns + GetLineTimeNs(huart, size);
+  uart->tx_stream.NDTR = size;
+  SET_BIT(uart->tx_stream.CR, DMA_SxCR_EN);
+  return HAL_OK;
+}
+
+extern "C" HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef* huart,
+                                                  uint8_t* data,
+                                                  uint16_t size) {
+  SimUart* uart = FindUart(huart);
+  if (uart == nullptr || data == nullptr || size == 0) { return HAL_ERROR; }
+  if (huart->RxState != HAL_UART_STATE_READY) { return HAL_BUSY; }
+
+  huart->RxState = HAL_UART_STATE_BUSY_RX;
+  uart->rx_data = data;
+  uart->rx_size = size;
+  uart->rx_to_idle = false;
+  uart->rx_stream.NDTR = size;
+  SET_BIT(uart->rx_stream.CR, DMA_SxCR_EN);
+  return HAL_OK;
+}
+
+extern "C" HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(
+    UART_HandleTypeDef* huart, uint8_t* data, uint16_t size) {
+  const HAL_StatusTypeDef status = HAL_UART_Receive_DMA(huart, data, size);
+  if (status == HAL_OK) { FindUart(huart)->rx_to_idle = true; }
+  return status;
+}
+
+extern "C" uint32_t HAL_GetTick(void) {
+  g_now_ns += g_poll_step_ns;
+  ServiceInterrupts(g_now_ns);
+  return static_cast<uint32_t>(g_now_ns / 1000000U);
+}
+
+extern "C" uint32_t __get_PRIMASK(void) { return g_primask; }
+
+extern "C" void __set_PRIMASK(uint32_t priMask) {
+  g_primask = priMask & 1U;
+  ServiceInterrupts(g_now_ns);
+}
+
+extern "C" void __disable_irq(void) { g_primask = 1; }
+
+extern "C" void __enable_irq(void) { __set_PRIMASK(0); }
+
+extern "C" uint32_t __get_IPSR(void) {
+  return g_in_interrupt ? kDmaExceptionNumber : 0U;
+}
+
+extern "C" void MX_USART1_UART_Init(void) { InitDefaultUart(&huart1); }
+
+extern "C" void MX_USART2_UART_Init(void) { InitDefaultUart(&huart2); }
+
+// ============================================================================
+// Public C API Implementation
+// ============================================================================
+
+extern "C" uint64_t HalDmaPrintfHostGetTimeUs(void) {
+  return g_now_ns / 1000U;
+}
+
+extern "C" void HalDmaPrintfHostAdvance(uint32_t us) {
+  const uint64_t target_ns = g_now_ns + us * 1000ULL;
+  ServiceInterrupts(target_ns);
+  if (target_ns > g_now_ns) { g_now_ns = target_ns; }
+}
+
+extern "C" bool HalDmaPrintfHostRunUntilIdle(uint32_t max_us) {
+  const uint64_t deadline_ns = g_now_ns + max_us * 1000ULL;
+  while (SimUart* next = FindNextCompletion()) {
+    if (g_primask != 0 || next->tx_end_ns > deadline_ns) {
+      if (deadline_ns > g_now_ns) { g_now_ns = deadline_ns; }
+      return false;
+    }
+    ServiceInterrupts(next->tx_end_ns);
+  }
+  return true;
+}
+
+extern "C" void HalDmaPrintfHostSetPollStep(uint32_t us) {
+  g_poll_step_ns = us * 1000ULL;
+}
+
+extern "C" size_t HalDmaPrintfHostReadOutput(UART_HandleTypeDef* huart,
+                                             uint8_t* buffer, size_t size) {
+  SimUart* uart = FindUart(huart);
+  if (uart == nullptr || buffer == nullptr) { return 0; }
+
+  const size_t count = (uart->output.size() < size) ? uart->output.size()
+                                                     : size;
+  memcpy(buffer, uart->output.data(), count);
+  uart->output.erase(uart->output.begin(), uart->output.begin() + count);
+  return count;
+}
+
+extern "C" size_t HalDmaPrintfHostInjectRx(UART_HandleTypeDef* huart,
+                                           const uint8_t* data, size_t size) {
+  SimUart* uart = FindUart(huart);
+  if (uart == nullptr || data == nullptr) { return 0; }
+
+  size_t stored = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (ReceiveByte(*uart, data[i])) {
+      ++stored;
+    } else {
+      ++uart->stats.rx_dropped;
+    }
+  }
+  IdleLine(*uart);
+  return stored;
+}
+
+extern "C" bool HalDmaPrintfHostGetStats(UART_HandleTypeDef* huart,
+                                         HalDmaPrintfHostUartStats* stats) {
+  const SimUart* uart = FindUart(huart);
+  if (uart == nullptr || stats == nullptr) { return false; }
+  *stats = uart->stats;
+  return true;
+}
+
+extern "C" void HalDmaPrintfHostResetStats(UART_HandleTypeDef* huart) {
+  SimUart* uart = FindUart(huart);
+  if (uart != nullptr) { uart->stats = HalDmaPrintfHostUartStats{}; }
+}
+
+extern "C" int HalDmaPrintfHostPrintf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  va_list args_copy;
+  va_copy(args_copy, args);
+  const int len = vsnprintf(nullptr, 0, format, args_copy);
+  va_end(args_copy);
+  if (len < 0) {
+    va_end(args);
+    return -1;
+  }
+
+  std::vector<char> text(static_cast<size_t>(len) + 1);
+  vsnprintf(text.data(), text.size(), format, args);
+  va_end(args);
+  return _write(1, text.data(), len);
+}
@@ -41,8 +41,179 @@ extern "C" {
 #define HAL_DMA_PRINTF_ERROR_NO_DMA_RX -3   /**< RX DMA not configured */
 #define HAL_DMA_PRINTF_ERROR_NO_CALLBACK -4 /**< Register callbacks disabled \
                                              */
+#define HAL_DMA_PRINTF_ERROR_NO_SPACE -5    /**< Not enough buffer space */
+#define HAL_DMA_PRINTF_ERROR_INVALID_ARG -6 /**< Invalid argument */
+#define HAL_DMA_PRINTF_ERROR_NOT_READY -7   /**< Setup not completed */
+#define HAL_DMA_PRINTF_ERROR_TIMEOUT -8     /**< Operation timed out */
+#define HAL_DMA_PRINTF_ERROR_DMA_MODE -9    /**< RX DMA mode not usable */
 /** @} */
 
+/**
+ * @brief Message severity
+ *
+ * @details
+ * Output through stdout is INFO unless written with HalDmaPrintfLog; output
+ * through stderr is always ERROR.
+ */
+typedef enum {
+  HAL_DMA_PRINTF_SEVERITY_DEBUG = 0,
+  HAL_DMA_PRINTF_SEVERITY_INFO,
+  HAL_DMA_PRINTF_SEVERITY_WARNING,
+  HAL_DMA_PRINTF_SEVERITY_ERROR,
+  HAL_DMA_PRINTF_SEVERITY_COUNT
+} HalDmaPrintfSeverity;
+
+/**
+ * @brief How to detect that a host is listening
+ */
+typedef enum {
+  HAL_DMA_PRINTF_GATING_OFF = 0,     /**< Always produce output */
+  HAL_DMA_PRINTF_GATING_RX_ACTIVITY, /**< Output while RX saw recent bytes */
+  HAL_DMA_PRINTF_GATING_CALLBACK     /**< Ask a user callback (e.g. DTR pin) */
+} HalDmaPrintfGatingMode;
+
+/**
+ * @brief Output encodings (bit flags)
+ */
+typedef enum {
+  HAL_DMA_PRINTF_ENCODING_TEXT = 0x00,      /**< Plain text only */
+  HAL_DMA_PRINTF_ENCODING_FRAMES = 0x01,    /**< Binary frames, sequence tags */
+  HAL_DMA_PRINTF_ENCODING_DICTIONARY = 0x02 /**< Dictionary-compressed text */
+} HalDmaPrintfEncoding;
+
+/**
+ * @brief When output of a file descriptor starts transmission
+ */
+typedef enum {
+  HAL_DMA_PRINTF_FLUSH_IMMEDIATE = 0, /**< Start the DMA on every write */
+  HAL_DMA_PRINTF_FLUSH_COALESCE       /**< Wait for coalesce_bytes queued */
+} HalDmaPrintfFlushPolicy;
+
+/**
+ * @brief What a file descriptor does when TX buffer is full
+ */
+typedef enum {
+  HAL_DMA_PRINTF_OVERFLOW_DROP_NEW = 0, /**< Drop the new message */
+  HAL_DMA_PRINTF_OVERFLOW_DROP_OLDEST,  /**< Evict oldest queued messages */
+  HAL_DMA_PRINTF_OVERFLOW_BLOCK,        /**< Wait for space (lossless) */
+  HAL_DMA_PRINTF_OVERFLOW_LAST_VALUE    /**< Replace own queued message */
+} HalDmaPrintfOverflowPolicy;
+
+/**
+ * @brief Output policy of one file descriptor
+ */
+typedef struct {
+  HalDmaPrintfFlushPolicy flush;
+  uint16_t coalesce_bytes; /**< Queued bytes that start a COALESCE flush */
+  HalDmaPrintfOverflowPolicy overflow;
+  HalDmaPrintfSeverity priority; /**< Severity of messages from this fd */
+} HalDmaPrintfFdPolicy;
+
+/**
+ * @brief Scheduling parameters of one output class
+ */
+typedef struct {
+  /** Share of the link relative to other backlogged classes (1 or more) */
+  uint16_t weight;
+  /** Serve the class ahead of its turn once its oldest message has waited
+   *  this long; 0 for no limit */
+  uint16_t max_latency_ms;
+} HalDmaPrintfClassConfig;
+
+/**
+ * @brief Statistics of one output class
+ */
+typedef struct {
+  uint32_t sent_bytes;      /**< Bytes handed to the DMA */
+  uint32_t dropped_bytes;   /**< Bytes of messages dropped on a full queue */
+  uint32_t transfers;       /**< DMA transfers started for the class */
+  uint32_t max_latency_ms;  /**< Longest time a message waited in queue */
+  uint32_t deadline_boosts; /**< Times served early for max_latency_ms */
+  uint32_t queued_bytes;    /**< Bytes waiting at the time of the call */
+} HalDmaPrintfClassStats;
+
+/**
+ * @brief Runtime statistics
+ */
+typedef struct {
+  /** Messages dropped because the TX buffer was full, per severity */
+  uint32_t dropped_messages[HAL_DMA_PRINTF_SEVERITY_COUNT];
+  /** Queued messages evicted to make room for higher severities */
+  uint32_t evicted_messages[HAL_DMA_PRINTF_SEVERITY_COUNT];
+  /** Total bytes of dropped and evicted messages */
+  uint32_t lost_bytes;
+  /** Bytes sent from the spill device after being stored there */
+  uint32_t spilled_bytes;
+  /** Status updates (and LAST_VALUE messages) written over a still queued
+   *  value */
+  uint32_t coalesced_updates;
+  /** Times RX stopped because every pool block was waiting or held; input
+   *  is lost until a block is released */
+  uint32_t rx_pool_stalls;
+} HalDmaPrintfStats;
+
+/**
+ * @brief Block device that stores output while it cannot be sent
+ *
+ * @details
+ * Blocks are HAL_DMA_PRINTF_SPILL_BLOCK_SIZE bytes, written whole and in
+ * order, so they map directly onto flash pages. Callbacks return 0 on
+ * success; write_block erases the block first if the medium needs it.
+ */
+typedef struct {
+  uint32_t block_count; /**< Number of blocks on the device */
+  int (*write_block)(void* context, uint32_t block, const uint8_t* data);
+  int (*read_block)(void* context, uint32_t block, uint8_t* data);
+  void* context; /**< Passed to the callbacks */
+} HalDmaPrintfSpillDevice;
+
+/**
+ * @brief Results of HalDmaPrintfRunBenchmark
+ *
+ * @details Cycle counts come from the DWT cycle counter; on cores without
+ * one they are derived from HAL_GetTick() and only coarse.
+ */
+typedef struct {
+  uint32_t bytes;            /**< Bytes sent, including framing */
+  uint32_t bytes_per_second; /**< Achieved TX throughput */
+  uint32_t transfers;        /**< DMA transfers completed */
+  uint32_t enqueue_cycles;   /**< Average cycles to queue one 64-byte frame */
+  uint32_t isr_cycles;       /**< Average cycles in the completion callback */
+  /** Average cycles from completion callback entry to next transfer start */
+  uint32_t restart_cycles;
+} HalDmaPrintfBenchmark;
+
+/** Number of message sizes measured by HalDmaPrintfRunCopyBenchmark */
+#define HAL_DMA_PRINTF_COPY_BENCHMARK_SIZES 8
+
+/**
+ * @brief Results of HalDmaPrintfRunCopyBenchmark
+ *
+ * @details Averages over every source and destination alignment, in cycles
+ * per copy (call included).
+ */
+typedef struct {
+  uint32_t size[HAL_DMA_PRINTF_COPY_BENCHMARK_SIZES]; /**< Bytes per copy */
+  uint32_t memcpy_cycles[HAL_DMA_PRINTF_COPY_BENCHMARK_SIZES];
+  /** HAL_DMA_PRINTF_ENABLE_WORD_COPY's word-sized ring copy */
+  uint32_t ring_copy_cycles[HAL_DMA_PRINTF_COPY_BENCHMARK_SIZES];
+} HalDmaPrintfCopyBenchmark;
+
+/**
+ * @brief Cycle costs of the two halves of transfer completion
+ */
+typedef struct {
+  uint32_t isr_count;             /**< Completion interrupts */
+  uint32_t isr_cycles_total;      /**< Cycles spent in them */
+  uint32_t isr_cycles_max;        /**< Longest single interrupt */
+  uint32_t deferred_count;        /**< HalDmaPrintfRunDeferred calls */
+  uint32_t deferred_cycles_total; /**< Cycles spent in them */
+  uint32_t deferred_cycles_max;   /**< Longest single call */
+  /** Completions that found data queued but no chunk prepared; the link
+   *  idled until the deferred half ran */
+  uint32_t prepare_misses;
+} HalDmaPrintfDeferredStats;
+
 /**
  * @brief Initialize the HAL DMA printf library
  *
@@ -61,6 +232,8 @@ extern "C" {
  * @return int Error code (HAL_DMA_PRINTF_OK on success)
  *
  * @note This function configures stdin/stdout buffering to unbuffered mode
+ * @note Output printed before this call is kept in TX buffer (up to its
+ *       size) and sent in one DMA transfer as soon as setup succeeds
  *
  * @code
  * // Example usage in main.c:
@@ -70,6 +243,97 @@ extern "C" {
  */
 int HalDmaPrintfSetup(UART_HandleTypeDef* huart, bool enable_echo);
 
+/**
+ * @brief Initialize the library with output striped over two UARTs
+ *
+ * @details
+ * Like HalDmaPrintfSetup, but TX output is split into sequence-numbered
+ * frames that are sent over whichever of the two UARTs is idle, for up to
+ * twice the bandwidth of one link. Input is read from @p huart only.
+ * Reassemble the captures of both links on the host with
+ * `tools/hal_dma_printf_tool.py unstripe`.
+ *
+ * @param[in] huart Pointer to primary UART handle (TX and RX DMA)
+ * @param[in] huart_secondary Pointer to secondary UART handle (TX DMA)
+ * @param[in] enable_echo Enable character echo for input (true/false)
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_STRIPING=ON in CMake
+ */
+int HalDmaPrintfSetupBonded(UART_HandleTypeDef* huart,
+                            UART_HandleTypeDef* huart_secondary,
+                            bool enable_echo);
+
+/**
+ * @brief TX DMA stream interrupt handler for the register-level backend
+ *
+ * @details
+ * With the register-level backend, transfers are started by writing the TX
+ * DMA stream registers directly instead of through HAL_UART_Transmit_DMA,
+ * and the next transfer starts from the DMA transfer-complete interrupt
+ * rather than after HAL's USART TC interrupt. Call this from the TX stream's
+ * IRQ handler in place of HAL_DMA_IRQHandler.
+ *
+ * @code
+ * void DMA1_Stream6_IRQHandler(void) {
+ *   HalDmaPrintfTxDmaIrqHandler();  // was HAL_DMA_IRQHandler(&hdma_usart2_tx)
+ * }
+ * @endcode
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_LL_TX=ON in CMake (STM32 DMA stream
+ *       controllers such as F2/F4/F7; not combinable with striping)
+ */
+void HalDmaPrintfTxDmaIrqHandler(void);
+
+/**
+ * @brief Deferred half of TX transfer completion
+ *
+ * @details
+ * With HAL_DMA_PRINTF_ENABLE_DEFERRED, the transfer-complete interrupt only
+ * restarts the DMA on a chunk prepared in advance and releases the finished
+ * chunk's space; its cost stays the same whatever features are enabled.
+ * Choosing and preparing the following chunk (scheduling, wraparound,
+ * statistics) happens here. The interrupt requests this call through the
+ * deferred trigger, which by default pends PendSV:
+ *
+ * @code
+ * void PendSV_Handler(void) { HalDmaPrintfRunDeferred(); }
+ * @endcode
+ *
+ * Writers prepare a chunk themselves when none is, so output also flows if
+ * this runs late, but the link may idle between transfers meanwhile.
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_DEFERRED=ON in CMake (not with
+ *       striping)
+ */
+void HalDmaPrintfRunDeferred(void);
+
+/**
+ * @brief Set how the completion interrupt requests HalDmaPrintfRunDeferred
+ *
+ * @details
+ * Under an RTOS that owns PendSV, pass a function that wakes a task or
+ * hook calling HalDmaPrintfRunDeferred (e.g. a task notification from
+ * ISR). NULL disables the request; then call HalDmaPrintfRunDeferred
+ * periodically.
+ *
+ * @param[in] trigger Called from the completion interrupt
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_DEFERRED=ON in CMake
+ */
+void HalDmaPrintfSetDeferredTrigger(void (*trigger)(void));
+
+/**
+ * @brief Get cycle costs of the interrupt and deferred completion halves
+ *
+ * @param[out] stats Destination for the measurements (DWT cycles)
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_DEFERRED=ON in CMake. Reset by
+ *       HalDmaPrintfResetStats.
+ */
+void HalDmaPrintfGetDeferredStats(HalDmaPrintfDeferredStats* stats);
+
 /**
  * @brief Enable echo mode for input characters
  *
@@ -98,6 +362,338 @@ void HalDmaPrintfDisableEcho(void);
  */
 size_t HalDmaPrintfGetBufferSize(void);
 
+/**
+ * @brief printf with a severity attached to the resulting message
+ *
+ * @details
+ * The severity decides which messages are dropped or evicted when the TX
+ * buffer overflows (see HAL_DMA_PRINTF_ENABLE_EVICTION).
+ *
+ * @param[in] severity Severity of the message
+ * @param[in] format printf format string
+ *
+ * @return int Number of characters written, negative on error
+ *
+ * @code
+ * HalDmaPrintfLog(HAL_DMA_PRINTF_SEVERITY_WARNING, "Temp: %d C\r\n", temp);
+ * @endcode
+ */
+int HalDmaPrintfLog(HalDmaPrintfSeverity severity, const char* format, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+/**
+ * @brief Suppress output while no host is listening
+ *
+ * @details
+ * While no listener is detected, HalDmaPrintfLog returns before formatting
+ * and _write discards its data without touching TX buffer. Output resumes
+ * on the first call after the listener is detected again.
+ *
+ * - HAL_DMA_PRINTF_GATING_RX_ACTIVITY: a listener is present if a byte was
+ *   received in the last @p timeout_ms. `tools/hal_dma_printf_tool.py
+ *   --heartbeat` sends NUL bytes for this; _read discards them.
+ * - HAL_DMA_PRINTF_GATING_CALLBACK: @p is_connected decides, e.g. by reading
+ *   a DTR-like GPIO.
+ *
+ * @param[in] mode Gating mode
+ * @param[in] timeout_ms RX silence after which the listener is considered gone
+ * @param[in] is_connected Callback for HAL_DMA_PRINTF_GATING_CALLBACK
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_GATING=ON in CMake. Call after
+ *       HalDmaPrintfSetup.
+ */
+int HalDmaPrintfSetGating(HalDmaPrintfGatingMode mode, uint32_t timeout_ms,
+                          bool (*is_connected)(void));
+
+/**
+ * @brief Send the latest value of a status key (last value wins)
+ *
+ * @details
+ * For values where only the newest one matters, such as a temperature or a
+ * mode. Each update is sent as a binary frame holding @p key and the value.
+ * If the previous update of @p key is still queued (not yet handed to the
+ * DMA) and has the same size, it is overwritten in place instead of
+ * appending, so a burst of updates occupies one frame of TX buffer and the
+ * host receives the freshest value. Decode with
+ * `tools/hal_dma_printf_tool.py status`.
+ *
+ * @param[in] key Status key (0 to HAL_DMA_PRINTF_STATUS_MAX_KEYS - 1)
+ * @param[in] value Value bytes (e.g. a number or fixed-width text)
+ * @param[in] size Size of the value in bytes
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success,
+ *         HAL_DMA_PRINTF_ERROR_NO_SPACE if a new frame did not fit)
+ *
+ * @code
+ * HalDmaPrintfStatusUpdate(STATUS_TEMPERATURE, &temp_c, sizeof(temp_c));
+ * @endcode
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_STATUS=ON in CMake
+ */
+int HalDmaPrintfStatusUpdate(uint8_t key, const void* value, uint16_t size);
+
+/**
+ * @brief Measure the DMA path on the running board
+ *
+ * @details
+ * Waits until TX is idle, then keeps TX buffer filled with @p bytes worth of
+ * padding frames (frame type 0x07, skipped by the host tool) and measures
+ * the achieved throughput, the cost of queuing, the time spent in the
+ * transfer-complete callback and the restart latency between transfers.
+ * Blocks until everything is sent; intended to run once at boot.
+ *
+ * @param[in] bytes Amount of data to send (e.g. 8192)
+ * @param[out] result Measured values
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success,
+ *         HAL_DMA_PRINTF_ERROR_TIMEOUT if TX did not finish within 10 s)
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_BENCHMARK=ON in CMake. Not for use
+ *       with striping.
+ */
+int HalDmaPrintfRunBenchmark(uint32_t bytes, HalDmaPrintfBenchmark* result);
+
+/**
+ * @brief Compare library memcpy with the word-sized ring copy
+ *
+ * @details
+ * Copies messages of 4 to 128 bytes into a scratch buffer with both routines
+ * and reports their average cost, to decide whether
+ * HAL_DMA_PRINTF_ENABLE_WORD_COPY pays off on the core and C library in
+ * use. Runs with interrupts disabled for each single copy; does not touch
+ * TX buffer.
+ *
+ * @param[out] result Measured values
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_BENCHMARK=ON in CMake
+ */
+int HalDmaPrintfRunCopyBenchmark(HalDmaPrintfCopyBenchmark* result);
+
+/**
+ * @brief Check whether output is currently produced
+ *
+ * @details
+ * Use this to skip expensive work that only feeds printf, e.g.
+ * `if (HalDmaPrintfIsListenerConnected()) { printf(...); }`.
+ *
+ * @return bool true if setup is done and a listener is detected (always
+ *         true without gating)
+ */
+bool HalDmaPrintfIsListenerConnected(void);
+
+/**
+ * @brief Take the oldest filled RX block
+ *
+ * @details
+ * With HAL_DMA_PRINTF_ENABLE_RX_POOL, RX DMA fills fixed-size blocks from a
+ * pool instead of one circular buffer. A block is handed over when it is
+ * full or the line goes idle, and belongs to the caller until
+ * HalDmaPrintfRxRelease, so a slow consumer can parse it in place while
+ * reception continues into other blocks. When every block is waiting or
+ * held, reception stops (counted in rx_pool_stalls) and restarts on the next
+ * release.
+ *
+ * _read takes blocks through this function as well; use either scanf and
+ * friends or this API on one build.
+ *
+ * @param[out] size Number of bytes in the block
+ *
+ * @return uint8_t* Block data, or NULL if no block is ready
+ *
+ * @code
+ * size_t size;
+ * uint8_t* data;
+ * while ((data = HalDmaPrintfRxAcquire(&size)) != NULL) {
+ *   ParsePacket(data, size);
+ *   HalDmaPrintfRxRelease(data);
+ * }
+ * @endcode
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_RX_POOL=ON in CMake, HAL with
+ *       HAL_UARTEx_ReceiveToIdle_DMA and RX DMA in Normal mode
+ */
+uint8_t* HalDmaPrintfRxAcquire(size_t* size);
+
+/**
+ * @brief Return a block taken with HalDmaPrintfRxAcquire to the pool
+ *
+ * @param[in] data Block data as returned by HalDmaPrintfRxAcquire
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success,
+ *         HAL_DMA_PRINTF_ERROR_NULL_PTR if @p data is NULL,
+ *         HAL_DMA_PRINTF_ERROR_INVALID_ARG if @p data is not a held block)
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_RX_POOL=ON in CMake
+ */
+int HalDmaPrintfRxRelease(uint8_t* data);
+
+/**
+ * @brief Get the output encodings in use
+ *
+ * @details
+ * Without HAL_DMA_PRINTF_ENABLE_NEGOTIATION, every encoding the build enables
+ * is always in use. With it, output starts as plain text, so a bare terminal
+ * shows readable output, and the host tool picks the encodings:
+ *
+ * - `tools/hal_dma_printf_tool.py --negotiate` sends a hello frame listing
+ *   the encodings it decodes every 500 ms. _read discards hellos.
+ * - The next write after a hello switches to the requested encodings this
+ *   build supports and marks the switch with a reply frame, so the tool
+ *   changes decoding at the same point in the stream.
+ * - After HAL_DMA_PRINTF_NEGOTIATION_TIMEOUT_MS without a hello, output falls
+ *   back to plain text.
+ *
+ * While binary frames are off, watch, profiler, status and trace frames and
+ * sequence tags are discarded.
+ *
+ * @return uint8_t HAL_DMA_PRINTF_ENCODING_* flags
+ */
+uint8_t HalDmaPrintfGetEncoding(void);
+
+/**
+ * @brief Store output that would be dropped on a block device
+ *
+ * @details
+ * When TX buffer is full, or gating reports no listener, text written
+ * through _write is appended to @p device instead of being discarded. Once
+ * a listener is present and TX buffer has room, HalDmaPrintfSpillPoll sends
+ * the stored text first, oldest block first, and new output queues behind
+ * it until the device is empty. Messages are dropped only when the device
+ * itself is full.
+ *
+ * @param[in] device Device description (copied), or NULL to disable
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_SPILL=ON in CMake. Contents are not
+ *       kept across resets; setting a device starts with it empty.
+ *       Binary frames and serializer output are not spilled.
+ */
+int HalDmaPrintfSetSpillDevice(const HalDmaPrintfSpillDevice* device);
+
+/**
+ * @brief Send spilled output while TX buffer has room
+ *
+ * @details
+ * Call from the main loop (device reads may block, so not from interrupts).
+ * Does nothing while no listener is detected.
+ */
+void HalDmaPrintfSpillPoll(void);
+
+/**
+ * @brief Set the output policy of a file descriptor
+ *
+ * @details
+ * Each descriptor reaching _write (stdout, stderr, or descriptors opened
+ * through custom newlib hooks) uses its own entry; all of them share TX
+ * buffer and the DMA. Defaults: immediate flush, DROP_NEW, INFO priority
+ * (ERROR for stderr). HalDmaPrintfLog's severity overrides the priority.
+ *
+ * - DROP_OLDEST evicts the oldest queued messages of the same or lower
+ *   priority (requires HAL_DMA_PRINTF_ENABLE_EVICTION).
+ * - BLOCK waits up to 1 s for the DMA to free space; in interrupt context
+ *   it behaves like DROP_NEW.
+ * - LAST_VALUE overwrites the descriptor's previous message in place if it
+ *   has the same length and has not been handed to the DMA yet (not with
+ *   dictionary compression).
+ *
+ * @param[in] file File descriptor (0 to HAL_DMA_PRINTF_MAX_FDS - 1)
+ * @param[in] policy Policy to use (copied)
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ *
+ * @code
+ * const HalDmaPrintfFdPolicy stdout_policy = {
+ *     HAL_DMA_PRINTF_FLUSH_COALESCE, 64, HAL_DMA_PRINTF_OVERFLOW_DROP_OLDEST,
+ *     HAL_DMA_PRINTF_SEVERITY_INFO};
+ * HalDmaPrintfSetFdPolicy(STDOUT_FILENO, &stdout_policy);
+ * @endcode
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_FD_POLICY=ON in CMake
+ */
+int HalDmaPrintfSetFdPolicy(int file, const HalDmaPrintfFdPolicy* policy);
+
+/**
+ * @brief Start transmission of output held back by COALESCE descriptors
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_FD_POLICY=ON in CMake
+ */
+void HalDmaPrintfFlush(void);
+
+/**
+ * @brief Set weight and latency limit of an output class
+ *
+ * @details
+ * Output classes share the link by weighted deficit round-robin: whenever a
+ * DMA transfer completes, the next one is taken from the class whose turn
+ * it is, and over time each backlogged class gets bandwidth in proportion
+ * to its weight (weight x HAL_DMA_PRINTF_CLASS_QUANTUM bytes per round). A
+ * class whose oldest message has waited @c max_latency_ms is served first.
+ * Class 0 is TX buffer itself and carries everything not assigned to
+ * another class; classes 1 and up have their own queue of
+ * HAL_DMA_PRINTF_CLASS_BUFFER_SIZE bytes. Defaults: weight 1, no limit.
+ *
+ * @param[in] class_id Class (0 to HAL_DMA_PRINTF_CLASS_COUNT - 1)
+ * @param[in] config Parameters (copied)
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_SCHEDULER=ON in CMake (not with
+ *       striping or the dictionary)
+ */
+int HalDmaPrintfSetClassConfig(int class_id,
+                               const HalDmaPrintfClassConfig* config);
+
+/**
+ * @brief Send the output of a file descriptor through an output class
+ *
+ * @details
+ * Messages of classes 1 and up are kept whole: a transfer never starts or
+ * ends inside one. They bypass the eviction, spill and per-fd overflow
+ * handling of TX buffer; a message that does not fit into its class queue
+ * is dropped.
+ *
+ * @param[in] file File descriptor (0 to HAL_DMA_PRINTF_MAX_FDS - 1)
+ * @param[in] class_id Class (0 to HAL_DMA_PRINTF_CLASS_COUNT - 1)
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_SCHEDULER=ON in CMake
+ */
+int HalDmaPrintfSetFdClass(int file, int class_id);
+
+/**
+ * @brief Get the statistics of an output class
+ *
+ * @param[in] class_id Class (0 to HAL_DMA_PRINTF_CLASS_COUNT - 1)
+ * @param[out] stats Destination for the statistics
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_SCHEDULER=ON in CMake. Reset by
+ *       HalDmaPrintfResetStats.
+ */
+int HalDmaPrintfGetClassStats(int class_id, HalDmaPrintfClassStats* stats);
+
+/**
+ * @brief Get a copy of the runtime statistics
+ *
+ * @param[out] stats Destination for the statistics
+ */
+void HalDmaPrintfGetStats(HalDmaPrintfStats* stats);
+
+/**
+ * @brief Reset all runtime statistics to zero
+ */
+void HalDmaPrintfResetStats(void);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
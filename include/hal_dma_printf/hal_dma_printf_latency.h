@@ -0,0 +1,130 @@
+/**
+ * @file hal_dma_printf_latency.h
+ * @brief Round-trip latency of console commands, per command and stage
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * Measures how long a console command takes from its line ending arriving
+ * on RX to the first byte of the response starting on TX, broken down into
+ * the stages of HalDmaPrintfLatencyStage. A command is a line returned by
+ * _read (scanf, fgets, std::cin); it is keyed by its first word, and the
+ * response is the next _write after it. Each command gets a log2 histogram
+ * per stage. HalDmaPrintfLatencySend sends them as binary frames for
+ * `tools/hal_dma_printf_tool.py latency`, or read them with
+ * HalDmaPrintfLatencyGet.
+ *
+ * The line ending's arrival is taken from the RX pool's idle-line event
+ * minus the character times after it, so the RX pool is required.
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_LATENCY=ON in CMake (which needs
+ *       HAL_DMA_PRINTF_ENABLE_RX_POOL=ON)
+ */
+
+#ifndef HAL_DMA_PRINTF_LATENCY_H
+#define HAL_DMA_PRINTF_LATENCY_H
+
+#include <stdint.h>
+
+#include "hal_dma_printf/hal_dma_printf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Histogram buckets per stage; bucket i counts times below 16 << i
+ *  microseconds, the last one everything longer */
+#define HAL_DMA_PRINTF_LATENCY_BUCKETS 16
+
+/** @brief Characters of a command's first word that identify it */
+#define HAL_DMA_PRINTF_LATENCY_NAME_SIZE 8
+
+/**
+ * @brief Stages of a command round trip, in order
+ */
+typedef enum {
+  /** Line ending on the wire to the RX idle-line (or block full) event */
+  HAL_DMA_PRINTF_LATENCY_STAGE_RX = 0,
+  /** RX event to _read returning the line */
+  HAL_DMA_PRINTF_LATENCY_STAGE_READ = 1,
+  /** _read return to the first _write of the response (the handler) */
+  HAL_DMA_PRINTF_LATENCY_STAGE_HANDLER = 2,
+  /** First response byte queued to its DMA transfer starting */
+  HAL_DMA_PRINTF_LATENCY_STAGE_TX = 3,
+  /** Whole round trip: sum of the stages above */
+  HAL_DMA_PRINTF_LATENCY_STAGE_TOTAL = 4,
+  HAL_DMA_PRINTF_LATENCY_STAGE_COUNT = 5
+} HalDmaPrintfLatencyStage;
+
+/**
+ * @brief Latency histograms of one command
+ */
+typedef struct {
+  /** First word of the command line, NUL-terminated */
+  char name[HAL_DMA_PRINTF_LATENCY_NAME_SIZE + 1];
+  /** Completed round trips */
+  uint32_t count;
+  /** Longest time per stage in microseconds */
+  uint32_t max_us[HAL_DMA_PRINTF_LATENCY_STAGE_COUNT];
+  /** Round trips per stage and bucket (saturating) */
+  uint16_t histogram[HAL_DMA_PRINTF_LATENCY_STAGE_COUNT]
+                    [HAL_DMA_PRINTF_LATENCY_BUCKETS];
+} HalDmaPrintfLatencyReport;
+
+/**
+ * @brief Start measuring command round trips
+ *
+ * @details
+ * Times come from the DWT cycle counter where the core has one, otherwise
+ * from HAL_GetTick() (millisecond resolution). The RX stage is computed
+ * from the baud rate. Commands beyond HAL_DMA_PRINTF_LATENCY_MAX_COMMANDS
+ * distinct names are counted under the last one, named "*".
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ *
+ * @code
+ * HalDmaPrintfLatencyStart();
+ * char line[64];
+ * while (fgets(line, sizeof(line), stdin) != NULL) {
+ *   RunCommand(line);  // its first printf ends the measurement
+ *   if (strncmp(line, "stats", 5) == 0) { HalDmaPrintfLatencySend(); }
+ * }
+ * @endcode
+ */
+int HalDmaPrintfLatencyStart(void);
+
+/**
+ * @brief Stop measuring (collected histograms are kept)
+ */
+void HalDmaPrintfLatencyStop(void);
+
+/**
+ * @brief Clear all commands and histograms
+ */
+void HalDmaPrintfLatencyReset(void);
+
+/**
+ * @brief Copy the histograms of one command
+ *
+ * @param[in] index Command index, 0 up to the number of commands seen
+ * @param[out] report Destination
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success,
+ *         HAL_DMA_PRINTF_ERROR_INVALID_ARG past the last command)
+ */
+int HalDmaPrintfLatencyGet(int index, HalDmaPrintfLatencyReport* report);
+
+/**
+ * @brief Send the histograms of every command as binary frames
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success,
+ *         HAL_DMA_PRINTF_ERROR_NO_SPACE if TX buffer could not take all
+ *         frames; the ones that fit are sent)
+ */
+int HalDmaPrintfLatencySend(void);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // HAL_DMA_PRINTF_LATENCY_H
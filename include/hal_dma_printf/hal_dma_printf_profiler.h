@@ -0,0 +1,103 @@
+/**
+ * @file hal_dma_printf_profiler.h
+ * @brief Sampling profiler streaming PC samples over hal-dma-printf
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * A periodic interrupt records the program counter it interrupted into a
+ * small sample ring. HalDmaPrintfProfilerPoll sends the samples as binary
+ * frames on the printf UART, and `tools/hal_dma_printf_tool.py profile`
+ * turns them into a per-function histogram using the firmware ELF.
+ *
+ * The interrupt does a constant amount of work (one store); samples that do
+ * not fit because the ring is full are counted, not queued. Each frame
+ * carries the number of samples taken and dropped and, where the DWT cycle
+ * counter exists, the cycles spent recording, so the host can report the
+ * profiler's own overhead.
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_PROFILER=ON in CMake
+ */
+
+#ifndef HAL_DMA_PRINTF_PROFILER_H
+#define HAL_DMA_PRINTF_PROFILER_H
+
+#include <stdint.h>
+
+#include "hal_dma_printf/hal_dma_printf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Define an interrupt handler that samples the interrupted PC
+ *
+ * @details
+ * The handler reads the PC from the exception stack frame and tail-calls
+ * HalDmaPrintfProfilerRecord, which acknowledges the interrupt through the
+ * callback given to HalDmaPrintfProfilerStart. Cortex-M3/M4/M7 only.
+ *
+ * @code
+ * // stm32f4xx_it.c: replaces the generated TIM7_IRQHandler
+ * HAL_DMA_PRINTF_PROFILER_IRQ_HANDLER(TIM7_IRQHandler)
+ *
+ * static void AckTimer(void) { __HAL_TIM_CLEAR_IT(&htim7, TIM_IT_UPDATE); }
+ *
+ * HAL_TIM_Base_Start_IT(&htim7);  // e.g. 1 kHz
+ * HalDmaPrintfProfilerStart(AckTimer);
+ * while (1) {
+ *   HalDmaPrintfProfilerPoll();
+ * }
+ * @endcode
+ */
+#define HAL_DMA_PRINTF_PROFILER_IRQ_HANDLER(name)     \
+  __attribute__((naked)) void name(void) {            \
+    __asm volatile(                                   \
+        "tst lr, #4\n"                                \
+        "ite eq\n"                                    \
+        "mrseq r0, msp\n"                             \
+        "mrsne r0, psp\n"                             \
+        "ldr r0, [r0, #24]\n"                         \
+        "b HalDmaPrintfProfilerRecord\n");            \
+  }
+
+/**
+ * @brief Start accepting samples
+ *
+ * @param[in] acknowledge Clears the sampling interrupt's pending flag; called
+ *            from HalDmaPrintfProfilerRecord (may be NULL, e.g. for SysTick)
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ */
+int HalDmaPrintfProfilerStart(void (*acknowledge)(void));
+
+/**
+ * @brief Stop accepting samples (queued samples are still sent)
+ */
+void HalDmaPrintfProfilerStop(void);
+
+/**
+ * @brief Record one sample
+ *
+ * @details
+ * Called by the handler defined with HAL_DMA_PRINTF_PROFILER_IRQ_HANDLER.
+ * May also be called from any interrupt with a PC obtained some other way.
+ *
+ * @param[in] pc Interrupted program counter
+ */
+void HalDmaPrintfProfilerRecord(uint32_t pc);
+
+/**
+ * @brief Send queued samples once half of the sample ring is filled
+ *
+ * @details
+ * Call from the main loop. Samples stay queued if TX buffer has no room.
+ */
+void HalDmaPrintfProfilerPoll(void);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // HAL_DMA_PRINTF_PROFILER_H
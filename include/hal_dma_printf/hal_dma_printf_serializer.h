@@ -0,0 +1,98 @@
+/**
+ * @file hal_dma_printf_serializer.h
+ * @brief Streaming JSON/CSV serializer writing directly into TX buffer
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * Builds JSON documents and CSV rows one element at a time without an
+ * intermediate buffer or heap: every call formats straight into TX buffer.
+ * A document may be larger than TX buffer. When a call runs out of space it
+ * returns HAL_DMA_PRINTF_ERROR_NO_SPACE after queuing what fit; calling it
+ * again with the same arguments resumes exactly where it stopped.
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_SERIALIZER=ON in CMake
+ *
+ * @code
+ * HalDmaPrintfWriter w;
+ * HalDmaPrintfWriterInit(&w);
+ * HalDmaPrintfJsonBeginObject(&w);
+ * HalDmaPrintfJsonKey(&w, "speed");
+ * HalDmaPrintfJsonInt(&w, motor_speed);
+ * HalDmaPrintfJsonEndObject(&w);
+ * @endcode
+ */
+
+#ifndef HAL_DMA_PRINTF_SERIALIZER_H
+#define HAL_DMA_PRINTF_SERIALIZER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hal_dma_printf/hal_dma_printf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum JSON nesting depth */
+#define HAL_DMA_PRINTF_WRITER_MAX_DEPTH 32
+
+/**
+ * @brief Serializer state (treat as opaque)
+ */
+typedef struct {
+  uint32_t object_bits;    /**< Bit n set: level n is an object */
+  uint32_t has_item_bits;  /**< Bit n set: level n already has an element */
+  uint32_t resume_offset;  /**< Bytes of an interrupted call already queued */
+  uint8_t depth;           /**< Current nesting depth */
+  bool after_key;          /**< A key was written, its value is next */
+} HalDmaPrintfWriter;
+
+/**
+ * @brief Reset a serializer to the start of a new document or CSV row
+ *
+ * @param[out] writer Serializer state
+ */
+void HalDmaPrintfWriterInit(HalDmaPrintfWriter* writer);
+
+/**
+ * @defgroup HAL_DMA_PRINTF_Json JSON
+ * @{
+ * All functions return HAL_DMA_PRINTF_OK, HAL_DMA_PRINTF_ERROR_NO_SPACE
+ * (partially queued; call again with the same arguments),
+ * HAL_DMA_PRINTF_ERROR_INVALID_ARG (call not valid at this point of the
+ * document) or HAL_DMA_PRINTF_ERROR_NOT_READY.
+ */
+int HalDmaPrintfJsonBeginObject(HalDmaPrintfWriter* writer);
+int HalDmaPrintfJsonEndObject(HalDmaPrintfWriter* writer);
+int HalDmaPrintfJsonBeginArray(HalDmaPrintfWriter* writer);
+int HalDmaPrintfJsonEndArray(HalDmaPrintfWriter* writer);
+int HalDmaPrintfJsonKey(HalDmaPrintfWriter* writer, const char* key);
+int HalDmaPrintfJsonString(HalDmaPrintfWriter* writer, const char* value);
+int HalDmaPrintfJsonInt(HalDmaPrintfWriter* writer, int32_t value);
+int HalDmaPrintfJsonUint(HalDmaPrintfWriter* writer, uint32_t value);
+int HalDmaPrintfJsonFloat(HalDmaPrintfWriter* writer, float value);
+int HalDmaPrintfJsonBool(HalDmaPrintfWriter* writer, bool value);
+int HalDmaPrintfJsonNull(HalDmaPrintfWriter* writer);
+/** @} */
+
+/**
+ * @defgroup HAL_DMA_PRINTF_Csv CSV
+ * @{
+ * Fields are separated by commas; HalDmaPrintfCsvEndRow terminates the row
+ * with CRLF. Strings are quoted only when they contain a comma, quote or line
+ * break. Return values are as for the JSON functions.
+ */
+int HalDmaPrintfCsvString(HalDmaPrintfWriter* writer, const char* value);
+int HalDmaPrintfCsvInt(HalDmaPrintfWriter* writer, int32_t value);
+int HalDmaPrintfCsvUint(HalDmaPrintfWriter* writer, uint32_t value);
+int HalDmaPrintfCsvFloat(HalDmaPrintfWriter* writer, float value);
+int HalDmaPrintfCsvEndRow(HalDmaPrintfWriter* writer);
+/** @} */
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // HAL_DMA_PRINTF_SERIALIZER_H
@@ -0,0 +1,62 @@
+/**
+ * @file hal_dma_printf_trace.h
+ * @brief Capture of the _write workload for replay on the host
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * Records the time, file descriptor and length of every _write call and
+ * sends the records as binary frames. `tools/hal_dma_printf_tool.py replay`
+ * feeds a captured trace through a model of TX buffer and UART to check
+ * whether a buffer size and baud rate survive the real traffic.
+ *
+ * The records themselves use TX bandwidth (8 bytes per call plus framing),
+ * so capture on a link with headroom or expect the trace to overstate load.
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_TRACE=ON in CMake
+ */
+
+#ifndef HAL_DMA_PRINTF_TRACE_H
+#define HAL_DMA_PRINTF_TRACE_H
+
+#include <stdint.h>
+
+#include "hal_dma_printf/hal_dma_printf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start recording _write calls
+ *
+ * @details
+ * Timestamps are in microseconds from the DWT cycle counter where the core
+ * has one, otherwise from HAL_GetTick() (millisecond resolution). They wrap
+ * after 2^32 us. The cycle counter wraps much sooner, so with it
+ * HalDmaPrintfTracePoll must run at least once per counter period (about
+ * 25 s at 168 MHz) while no _write calls are recorded.
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success)
+ */
+int HalDmaPrintfTraceStart(void);
+
+/**
+ * @brief Stop recording (queued records are still sent)
+ */
+void HalDmaPrintfTraceStop(void);
+
+/**
+ * @brief Send queued records once half of the record ring is filled
+ *
+ * @details
+ * Call from the main loop. Records that do not fit into the ring are
+ * counted and reported to the host as lost.
+ */
+void HalDmaPrintfTracePoll(void);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // HAL_DMA_PRINTF_TRACE_H
@@ -0,0 +1,82 @@
+/**
+ * @file hal_dma_printf_watch.h
+ * @brief Variable watch streaming for hal-dma-printf
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * Streams snapshots of registered variables as binary frames on the same
+ * UART as printf. This replaces printf-every-loop debugging: a snapshot is a
+ * handful of raw bytes instead of formatted text, and no formatting runs on
+ * the target. Use `tools/hal_dma_printf_tool.py watch` to convert the stream
+ * into CSV for plotting.
+ *
+ * @note Requires HAL_DMA_PRINTF_ENABLE_WATCH=ON in CMake
+ */
+
+#ifndef HAL_DMA_PRINTF_WATCH_H
+#define HAL_DMA_PRINTF_WATCH_H
+
+#include <stdint.h>
+
+#include "hal_dma_printf/hal_dma_printf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Register a variable to be included in every snapshot
+ *
+ * @param[in] address Address of the variable
+ * @param[in] size Size of the variable in bytes (1 to 255)
+ *
+ * @return int Index of the variable in the snapshot on success, error code
+ * otherwise (HAL_DMA_PRINTF_ERROR_NO_SPACE if the watch table is full)
+ *
+ * @note The maximum number of variables is HAL_DMA_PRINTF_WATCH_MAX_VARIABLES
+ *
+ * @code
+ * HalDmaPrintfWatchAdd(&motor_speed, sizeof(motor_speed));
+ * HalDmaPrintfWatchSetPeriod(10);
+ * while (1) {
+ *   HalDmaPrintfWatchPoll();
+ * }
+ * @endcode
+ */
+int HalDmaPrintfWatchAdd(const volatile void* address, uint16_t size);
+
+/**
+ * @brief Remove all registered variables
+ */
+void HalDmaPrintfWatchClear(void);
+
+/**
+ * @brief Set the period for snapshots sent by HalDmaPrintfWatchPoll
+ *
+ * @param[in] period_ms Period in milliseconds (0 disables periodic snapshots)
+ */
+void HalDmaPrintfWatchSetPeriod(uint32_t period_ms);
+
+/**
+ * @brief Send one snapshot of all registered variables now
+ *
+ * @return int Error code (HAL_DMA_PRINTF_OK on success,
+ * HAL_DMA_PRINTF_ERROR_NO_SPACE if the snapshot was dropped)
+ */
+int HalDmaPrintfWatchSnapshot(void);
+
+/**
+ * @brief Send a snapshot if the configured period has elapsed
+ *
+ * @details
+ * Call from the main loop or a periodic task. Uses HAL_GetTick() as the time
+ * base.
+ */
+void HalDmaPrintfWatchPoll(void);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // HAL_DMA_PRINTF_WATCH_H
@@ -7,176 +7,3151 @@
 
 #include "hal_dma_printf/hal_dma_printf.h"
 
+#include <unistd.h>
+
+#if HAL_DMA_PRINTF_ENABLE_REENT
+#include <errno.h>
+#include <reent.h>
+
+#include <climits>
+#endif
+
+#include <cstdarg>
 #include <cstdio>
 #include <cstring>
 
-#include "usart.h"
+#include "hal_dma_printf_internal.h"
+#include "usart.h"
+
+// Default buffer size (can be overridden by compiler flag)
+#ifndef HAL_DMA_PRINTF_BUFFER_SIZE
+#define HAL_DMA_PRINTF_BUFFER_SIZE 1024
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_DICTIONARY
+#define HAL_DMA_PRINTF_ENABLE_DICTIONARY 0
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_EVICTION
+#define HAL_DMA_PRINTF_ENABLE_EVICTION 0
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_STRIPING
+#define HAL_DMA_PRINTF_ENABLE_STRIPING 0
+#endif
+
+// Largest chunk sent as one striped frame
+#ifndef HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE
+#define HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE 128
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_GATING
+#define HAL_DMA_PRINTF_ENABLE_GATING 0
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_SPILL
+#define HAL_DMA_PRINTF_ENABLE_SPILL 0
+#endif
+
+// Unit of spill device reads and writes
+#ifndef HAL_DMA_PRINTF_SPILL_BLOCK_SIZE
+#define HAL_DMA_PRINTF_SPILL_BLOCK_SIZE 256
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_STATUS
+#define HAL_DMA_PRINTF_ENABLE_STATUS 0
+#endif
+
+// Number of status channel keys
+#ifndef HAL_DMA_PRINTF_STATUS_MAX_KEYS
+#define HAL_DMA_PRINTF_STATUS_MAX_KEYS 16
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_FD_POLICY
+#define HAL_DMA_PRINTF_ENABLE_FD_POLICY 0
+#endif
+
+// File descriptors with their own policy; higher ones share stdout's
+#ifndef HAL_DMA_PRINTF_MAX_FDS
+#define HAL_DMA_PRINTF_MAX_FDS 8
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_SCHEDULER
+#define HAL_DMA_PRINTF_ENABLE_SCHEDULER 0
+#endif
+
+// Output classes, including class 0 (TX buffer itself)
+#ifndef HAL_DMA_PRINTF_CLASS_COUNT
+#define HAL_DMA_PRINTF_CLASS_COUNT 4
+#endif
+
+// Queue size of each class other than class 0
+#ifndef HAL_DMA_PRINTF_CLASS_BUFFER_SIZE
+#define HAL_DMA_PRINTF_CLASS_BUFFER_SIZE 256
+#endif
+
+// Queued messages tracked per class queue
+#ifndef HAL_DMA_PRINTF_CLASS_MAX_MESSAGES
+#define HAL_DMA_PRINTF_CLASS_MAX_MESSAGES 16
+#endif
+
+// Bytes a class may send per round for each unit of weight
+#ifndef HAL_DMA_PRINTF_CLASS_QUANTUM
+#define HAL_DMA_PRINTF_CLASS_QUANTUM 64
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_BENCHMARK
+#define HAL_DMA_PRINTF_ENABLE_BENCHMARK 0
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_TRACE
+#define HAL_DMA_PRINTF_ENABLE_TRACE 0
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_WORD_COPY
+#define HAL_DMA_PRINTF_ENABLE_WORD_COPY 0
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_LL_TX
+#define HAL_DMA_PRINTF_ENABLE_LL_TX 0
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_DEFERRED
+#define HAL_DMA_PRINTF_ENABLE_DEFERRED 0
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED && HAL_DMA_PRINTF_ENABLE_STRIPING
+#error "HAL_DMA_PRINTF_ENABLE_DEFERRED cannot be combined with striping"
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_REENT
+#define HAL_DMA_PRINTF_ENABLE_REENT 0
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_SEQUENCE
+#define HAL_DMA_PRINTF_ENABLE_SEQUENCE 0
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_SEQUENCE && \
+    (HAL_DMA_PRINTF_ENABLE_SCHEDULER || HAL_DMA_PRINTF_ENABLE_SPILL)
+#error "HAL_DMA_PRINTF_ENABLE_SEQUENCE cannot be combined with the scheduler \
+or spill"
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+#define HAL_DMA_PRINTF_ENABLE_NEGOTIATION 0
+#endif
+
+// Time without a host hello after which output falls back to plain text
+#ifndef HAL_DMA_PRINTF_NEGOTIATION_TIMEOUT_MS
+#define HAL_DMA_PRINTF_NEGOTIATION_TIMEOUT_MS 2000
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION && HAL_DMA_PRINTF_ENABLE_STRIPING
+#error "HAL_DMA_PRINTF_ENABLE_NEGOTIATION cannot be combined with striping"
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_RX_POOL
+#define HAL_DMA_PRINTF_ENABLE_RX_POOL 0
+#endif
+
+// Size of one RX pool block; also the longest input handed over at once
+#ifndef HAL_DMA_PRINTF_RX_BLOCK_SIZE
+#define HAL_DMA_PRINTF_RX_BLOCK_SIZE 64
+#endif
+
+// Number of RX pool blocks
+#ifndef HAL_DMA_PRINTF_RX_BLOCK_COUNT
+#define HAL_DMA_PRINTF_RX_BLOCK_COUNT 8
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_RX_POOL && HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+#error "HAL_DMA_PRINTF_ENABLE_RX_POOL cannot be combined with negotiation"
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_LATENCY
+#define HAL_DMA_PRINTF_ENABLE_LATENCY 0
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_LATENCY && !HAL_DMA_PRINTF_ENABLE_RX_POOL
+#error "HAL_DMA_PRINTF_ENABLE_LATENCY requires HAL_DMA_PRINTF_ENABLE_RX_POOL"
+#endif
+
+#ifndef HAL_DMA_PRINTF_ENABLE_LOCK_STUBS
+#define HAL_DMA_PRINTF_ENABLE_LOCK_STUBS 0
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_LOCK_STUBS && HAL_DMA_PRINTF_ENABLE_SPILL
+#error "HAL_DMA_PRINTF_ENABLE_LOCK_STUBS cannot be combined with spill"
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_LL_TX && HAL_DMA_PRINTF_ENABLE_STRIPING
+#error "HAL_DMA_PRINTF_ENABLE_LL_TX cannot be combined with striping"
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER && \
+    (HAL_DMA_PRINTF_ENABLE_STRIPING || HAL_DMA_PRINTF_ENABLE_DICTIONARY)
+#error "HAL_DMA_PRINTF_ENABLE_SCHEDULER cannot be combined with striping or \
+the dictionary"
+#endif
+
+// Number of queued messages tracked for eviction
+#ifndef HAL_DMA_PRINTF_MAX_RECORDS
+#define HAL_DMA_PRINTF_MAX_RECORDS 32
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_DICTIONARY
+// Generated by tools/hal_dma_printf_tool.py gen-dict
+#ifdef HAL_DMA_PRINTF_DICTIONARY_HEADER
+#include HAL_DMA_PRINTF_DICTIONARY_HEADER
+#else
+#include "hal_dma_printf_dictionary_default.h"
+#endif
+#endif
+
+namespace {
+
+// Internal state (anonymous namespace for encapsulation)
+UART_HandleTypeDef* g_huart = nullptr;
+alignas(4) uint8_t g_tx_buffer[HAL_DMA_PRINTF_BUFFER_SIZE];
+volatile int g_tx_read_idx = 0;
+volatile int g_tx_write_idx = 0;
+volatile int g_tx_dma_size = 0;  // Bytes handed to the DMA, not yet sent
+#if !HAL_DMA_PRINTF_ENABLE_RX_POOL
+uint8_t g_rx_buffer[HAL_DMA_PRINTF_BUFFER_SIZE];
+volatile int g_rx_read_idx = 0;
+#endif
+bool g_enable_echo = false;
+
+// Running byte counts; their difference is the number of queued bytes
+uint32_t g_tx_write_total = 0;
+volatile uint32_t g_tx_dispatch_total = 0;
+
+HalDmaPrintfSeverity g_severity = HAL_DMA_PRINTF_SEVERITY_INFO;
+HalDmaPrintfStats g_stats = {};
+
+// Encodings this build can produce
+constexpr uint8_t kSupportedEncoding =
+    HAL_DMA_PRINTF_ENCODING_FRAMES |
+    (HAL_DMA_PRINTF_ENABLE_DICTIONARY ? HAL_DMA_PRINTF_ENCODING_DICTIONARY
+                                      : 0);
+
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+/**
+ * @brief Matcher of host hello frames in RX data, fed one byte at a time
+ * @details A hello is a kFrameTypeEncoding frame with one byte of requested
+ * HAL_DMA_PRINTF_ENCODING_* flags; the reply has the same layout.
+ */
+struct HelloParser {
+  int pos;        // Bytes of the frame matched so far
+  uint8_t flags;  // Requested encodings
+};
+
+uint8_t g_encoding = HAL_DMA_PRINTF_ENCODING_TEXT;
+int g_pending_encoding = -1;  // Requested; applied once the reply is queued
+uint32_t g_last_hello_tick = 0;
+int g_hello_scan_idx = 0;       // RX buffer position scanned for hellos
+HelloParser g_hello_scan = {};  // Used by UpdateEncoding
+HelloParser g_hello_read = {};  // Used by _read to drop hellos from input
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_SEQUENCE
+// Every queued message is preceded by a sequence frame: sequence number
+// (uint16 LE), optionally followed by the running lost count (uint16 LE)
+constexpr int kSequenceTagMaxSize = hal_dma_printf_internal::kFrameOverhead + 4;
+
+// The lost count is repeated this often even when unchanged, so a host that
+// missed the tag carrying a change catches up
+constexpr uint16_t kSequenceLostInterval = 64;
+
+// Both counters wrap; the host works with differences
+uint16_t g_sequence = 0;            // Number of the next message
+uint16_t g_lost_messages = 0;       // Dropped and evicted messages
+uint16_t g_lost_messages_sent = 0;  // Value carried by the last tag
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_EVICTION
+/**
+ * @brief Position of one queued message in the TX stream
+ * @details Kept beside the buffer instead of as an inline header, so DMA
+ * transfers stay contiguous and no header bytes reach the wire.
+ */
+struct TxRecord {
+  uint32_t start;  // Position in g_tx_write_total terms
+  int size;
+  HalDmaPrintfSeverity severity;
+};
+
+TxRecord g_records[HAL_DMA_PRINTF_MAX_RECORDS];
+int g_record_count = 0;  // Records are kept oldest first
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_GATING
+// Sent by the host tool to keep output enabled; discarded by _read
+constexpr char kHeartbeatByte = '\0';
+
+HalDmaPrintfGatingMode g_gating_mode = HAL_DMA_PRINTF_GATING_OFF;
+uint32_t g_gating_timeout_ms = 0;
+bool (*g_listener_callback)(void) = nullptr;
+uint32_t g_last_rx_activity = 0;
+uint32_t g_last_rx_tick = 0;
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_RX_POOL
+static_assert(HAL_DMA_PRINTF_RX_BLOCK_COUNT >= 2 &&
+                  HAL_DMA_PRINTF_RX_BLOCK_COUNT <= 32,
+              "Invalid HAL_DMA_PRINTF_RX_BLOCK_COUNT");
+static_assert(HAL_DMA_PRINTF_RX_BLOCK_SIZE >= 2 &&
+                  HAL_DMA_PRINTF_RX_BLOCK_SIZE <= UINT16_MAX,
+              "Invalid HAL_DMA_PRINTF_RX_BLOCK_SIZE");
+
+constexpr uint32_t kRxAllBlocks =
+    (HAL_DMA_PRINTF_RX_BLOCK_COUNT == 32)
+        ? 0xFFFFFFFFU
+        : (1U << HAL_DMA_PRINTF_RX_BLOCK_COUNT) - 1U;
+
+// Every block is in exactly one place: free, being filled by the DMA, in
+// the ready queue, or held by a consumer
+alignas(4) uint8_t g_rx_blocks[HAL_DMA_PRINTF_RX_BLOCK_COUNT]
+                              [HAL_DMA_PRINTF_RX_BLOCK_SIZE];
+uint16_t g_rx_block_sizes[HAL_DMA_PRINTF_RX_BLOCK_COUNT];
+uint32_t g_rx_free_blocks = 0;  // Bit per block
+uint32_t g_rx_held_blocks = 0;  // Bit per block
+volatile int g_rx_dma_block = -1;  // -1: reception stopped
+
+// Filled blocks, oldest first
+uint8_t g_rx_ready[HAL_DMA_PRINTF_RX_BLOCK_COUNT];
+int g_rx_ready_head = 0;
+volatile int g_rx_ready_count = 0;
+
+// Bytes handed over so far (wraps); RX activity for gating
+volatile uint32_t g_rx_pool_received = 0;
+
+// Block _read is working through
+uint8_t* g_rx_read_block = nullptr;
+size_t g_rx_read_size = 0;
+size_t g_rx_read_offset = 0;
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+uint32_t g_rx_block_times[HAL_DMA_PRINTF_RX_BLOCK_COUNT];  // RX event times
+uint32_t g_rx_read_time = 0;  // RX event time of the block _read is in
+volatile int g_latency_tx_idx = -1;  // First response byte; -1: none
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_STATUS
+/**
+ * @brief Last queued update of one status key
+ * @details While the frame has not been handed to the DMA, a new value of
+ * the same size is written over it instead of being appended.
+ */
+struct StatusSlot {
+  uint32_t start;  // Frame position in g_tx_write_total terms
+  uint16_t size;   // Value size; 0 if no frame was queued
+};
+
+StatusSlot g_status_slots[HAL_DMA_PRINTF_STATUS_MAX_KEYS];
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+static_assert(HAL_DMA_PRINTF_MAX_FDS > STDERR_FILENO,
+              "HAL_DMA_PRINTF_MAX_FDS must cover stdout and stderr");
+
+// Longest HAL_DMA_PRINTF_OVERFLOW_BLOCK waits before dropping the message
+constexpr uint32_t kBlockTimeoutMs = 1000;
+
+/**
+ * @brief Policy and last-value position of one file descriptor
+ */
+struct FdState {
+  HalDmaPrintfFdPolicy policy;
+  uint32_t last_start;  // Last message (LAST_VALUE), g_tx_write_total terms
+  int last_size;        // 0 if none
+};
+
+FdState g_fd_states[HAL_DMA_PRINTF_MAX_FDS];
+bool g_fd_states_ready = false;
+bool g_log_active = false;  // HalDmaPrintfLog's severity overrides priority
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+static_assert(HAL_DMA_PRINTF_CLASS_COUNT >= 2 &&
+                  HAL_DMA_PRINTF_CLASS_COUNT <= 16,
+              "Invalid HAL_DMA_PRINTF_CLASS_COUNT");
+
+/**
+ * @brief Scheduling state of one output class
+ */
+struct TxClass {
+  HalDmaPrintfClassConfig config;  // weight 0 (never configured) counts as 1
+  int32_t deficit;                 // Bytes the class may still send this round
+  HalDmaPrintfClassStats stats;
+};
+
+/**
+ * @brief End of one message in a class queue
+ */
+struct ClassMessage {
+  uint32_t end;   // Position after the message, in write_total terms
+  uint32_t tick;  // HAL_GetTick() when it was queued
+};
+
+/**
+ * @brief Own ring of classes 1 and up
+ * @details Class 0 is TX buffer itself, so everything not assigned to a
+ * class (binary frames, serializer output, ...) keeps working unchanged.
+ * Message ends are kept beside the ring, as eviction records are, so a
+ * transfer never splits a message between two classes.
+ */
+struct ClassQueue {
+  uint8_t buffer[HAL_DMA_PRINTF_CLASS_BUFFER_SIZE];
+  int read_idx;
+  int write_idx;
+  volatile int dma_size;  // Bytes handed to the DMA, not yet sent
+  uint32_t write_total;
+  volatile uint32_t dispatch_total;
+  ClassMessage messages[HAL_DMA_PRINTF_CLASS_MAX_MESSAGES];
+  int message_head;
+  volatile int message_count;
+};
+
+TxClass g_classes[HAL_DMA_PRINTF_CLASS_COUNT];
+ClassQueue g_class_queues[HAL_DMA_PRINTF_CLASS_COUNT - 1];
+uint8_t g_fd_classes[HAL_DMA_PRINTF_MAX_FDS];
+int g_class_turn = 0;                  // Next class in round-robin order
+int g_class_continue = -1;             // Class with a message split at ring end
+ClassQueue* g_class_dma = nullptr;     // Queue the DMA is sending from
+uint32_t g_tx_queued_tick = 0;         // Class 0: oldest queued byte's tick
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_BENCHMARK
+/**
+ * @brief Cycle totals collected while HalDmaPrintfRunBenchmark runs
+ */
+struct BenchmarkCounters {
+  volatile bool active;
+  volatile uint32_t complete_cycles;  // Entry of the last completion callback
+  volatile uint32_t isr_cycles;
+  volatile uint32_t isr_count;
+  volatile uint32_t restart_cycles;
+  volatile uint32_t restart_count;
+};
+
+BenchmarkCounters g_benchmark = {};
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED
+/**
+ * @brief One contiguous transfer, prepared or in flight
+ */
+struct TxChunk {
+  const uint8_t* data;
+  int size;                // 0: none
+  volatile int* dma_size;  // Counter holding the bytes until they are sent
+};
+
+// The completion interrupt only starts g_tx_next; choosing and preparing the
+// chunk after it is left to HalDmaPrintfRunDeferred
+TxChunk g_tx_inflight = {};
+TxChunk g_tx_next = {};
+HalDmaPrintfDeferredStats g_deferred_stats = {};
+
+#if defined(SCB_ICSR_PENDSVSET_Msk)
+/**
+ * @brief Default deferred trigger: pend PendSV
+ */
+void PendDeferredWork() { SCB->ICSR = SCB_ICSR_PENDSVSET_Msk; }
+
+void (*g_deferred_trigger)(void) = PendDeferredWork;
+#else
+void (*g_deferred_trigger)(void) = nullptr;
+#endif
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_SPILL
+// Spilled text is kept as a FIFO of blocks on the device plus one partially
+// filled block in RAM; blocks are read back into g_spill_read_block
+HalDmaPrintfSpillDevice g_spill_device = {};
+uint8_t g_spill_block[HAL_DMA_PRINTF_SPILL_BLOCK_SIZE];
+uint8_t g_spill_read_block[HAL_DMA_PRINTF_SPILL_BLOCK_SIZE];
+int g_spill_block_fill = 0;
+uint32_t g_spill_head = 0;   // Device block holding the oldest data
+uint32_t g_spill_count = 0;  // Blocks stored on the device
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_STRIPING
+// Striped frame: frame header, sequence number (uint16 LE), data, checksum
+constexpr int kStripeHeaderSize = 6;
+constexpr int kStripeFrameSize =
+    kStripeHeaderSize + HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE + 1;
+
+static_assert(HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE > 0 &&
+                  HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE <= UINT16_MAX - 2,
+              "Invalid HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE");
+
+/**
+ * @brief One UART of a bonded pair
+ * @details Chunks are copied out of TX buffer into the link's own frame so
+ * both links can transmit at once and complete in any order.
+ */
+struct StripeLink {
+  UART_HandleTypeDef* huart;
+  volatile bool busy;
+  uint8_t frame[kStripeFrameSize];
+};
+
+StripeLink g_stripe_links[2];
+uint16_t g_stripe_sequence = 0;
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_LL_TX
+/**
+ * @brief Interrupt status/clear registers of a DMA controller
+ * @details Same layout the HAL uses through DMA_HandleTypeDef's
+ * StreamBaseAddress; StreamIndex is the bit offset of the stream's flags.
+ */
+struct DmaBaseRegisters {
+  volatile uint32_t ISR;
+  volatile uint32_t reserved;
+  volatile uint32_t IFCR;
+};
+
+// Every interrupt flag of stream 0, shifted by StreamIndex for others
+constexpr uint32_t kDmaAllFlags = DMA_FLAG_TCIF0_4 | DMA_FLAG_HTIF0_4 |
+                                  DMA_FLAG_TEIF0_4 | DMA_FLAG_DMEIF0_4 |
+                                  DMA_FLAG_FEIF0_4;
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_BENCHMARK || HAL_DMA_PRINTF_ENABLE_DEFERRED
+/**
+ * @brief Read a free-running cycle counter
+ * @return DWT cycle count, or HAL_GetTick() scaled to cycles on cores
+ * without DWT (and on the host)
+ */
+inline uint32_t GetCycleCount() {
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+  return DWT->CYCCNT;
+#else
+  return HAL_GetTick() * (SystemCoreClock / 1000U);
+#endif
+}
+#endif
+
+/**
+ * @brief Calculate available data in TX buffer
+ * @return Number of bytes available to transmit
+ */
+inline int GetTxAvailableBytes() {
+  if (g_tx_write_idx >= g_tx_read_idx) {
+    return g_tx_write_idx - g_tx_read_idx;
+  }
+  return HAL_DMA_PRINTF_BUFFER_SIZE - g_tx_read_idx + g_tx_write_idx;
+}
+
+#if HAL_DMA_PRINTF_ENABLE_WORD_COPY || HAL_DMA_PRINTF_ENABLE_BENCHMARK
+// Cortex-M0/M0+ fault on unaligned word loads; later cores and hosts don't.
+// Host tests set HAL_DMA_PRINTF_HAS_UNALIGNED_LOADS=0 to run the ARMv6-M path.
+#ifndef HAL_DMA_PRINTF_HAS_UNALIGNED_LOADS
+#if defined(__ARM_ARCH_6M__)
+#define HAL_DMA_PRINTF_HAS_UNALIGNED_LOADS 0
+#else
+#define HAL_DMA_PRINTF_HAS_UNALIGNED_LOADS 1
+#endif
+#endif
+constexpr bool kHasUnalignedLoads = HAL_DMA_PRINTF_HAS_UNALIGNED_LOADS;
+
+/**
+ * @brief Load a word from a 4-byte aligned address
+ * @param src Source
+ * @return Word in native byte order
+ */
+inline uint32_t LoadAlignedWord(const uint8_t* src) {
+  uint32_t word;
+  memcpy(&word, __builtin_assume_aligned(src, 4), sizeof(word));
+  return word;
+}
+
+/**
+ * @brief Load a word from any address (unaligned access must be supported)
+ * @param src Source
+ * @return Word in native byte order
+ */
+inline uint32_t LoadUnalignedWord(const uint8_t* src) {
+  uint32_t word;
+  memcpy(&word, src, sizeof(word));
+  return word;
+}
+
+/**
+ * @brief Store a word to a 4-byte aligned address
+ * @param dst Destination
+ * @param word Word in native byte order
+ */
+inline void StoreAlignedWord(uint8_t* dst, uint32_t word) {
+  memcpy(__builtin_assume_aligned(dst, 4), &word, sizeof(word));
+}
+
+/**
+ * @brief Copy a short message into a ring buffer slot
+ * @param dst Destination (no wrap inside)
+ * @param src Source, any alignment
+ * @param len Number of bytes
+ * @details Replaces memcpy for typical 20-60 byte lines, where library
+ * memcpy spends most of its time on setup. Up to 3 head bytes bring dst to a
+ * word boundary; whole words follow, 16 bytes per unrolled step, then the
+ * tail. A source at a different alignment is read with unaligned loads, or
+ * on ARMv6-M as aligned words shifted together (little-endian). The shifted
+ * loop stops while the next aligned word still lies inside the source, so
+ * nothing past the end is read.
+ */
+void CopyToRing(uint8_t* dst, const uint8_t* src, int len) {
+  while ((reinterpret_cast<uintptr_t>(dst) & 3U) != 0 && len > 0) {
+    *dst++ = *src++;
+    --len;
+  }
+
+  const uint32_t src_offset = reinterpret_cast<uintptr_t>(src) & 3U;
+  if (src_offset == 0) {
+    for (; len >= 16; len -= 16, src += 16, dst += 16) {
+      StoreAlignedWord(dst, LoadAlignedWord(src));
+      StoreAlignedWord(dst + 4, LoadAlignedWord(src + 4));
+      StoreAlignedWord(dst + 8, LoadAlignedWord(src + 8));
+      StoreAlignedWord(dst + 12, LoadAlignedWord(src + 12));
+    }
+    for (; len >= 4; len -= 4, src += 4, dst += 4) {
+      StoreAlignedWord(dst, LoadAlignedWord(src));
+    }
+  } else if (kHasUnalignedLoads) {
+    for (; len >= 16; len -= 16, src += 16, dst += 16) {
+      StoreAlignedWord(dst, LoadUnalignedWord(src));
+      StoreAlignedWord(dst + 4, LoadUnalignedWord(src + 4));
+      StoreAlignedWord(dst + 8, LoadUnalignedWord(src + 8));
+      StoreAlignedWord(dst + 12, LoadUnalignedWord(src + 12));
+    }
+    for (; len >= 4; len -= 4, src += 4, dst += 4) {
+      StoreAlignedWord(dst, LoadUnalignedWord(src));
+    }
+  } else if (len >= 8) {
+    const uint8_t* aligned = src - src_offset;
+    const uint32_t low_shift = 8U * src_offset;
+    const uint32_t high_shift = 32U - low_shift;
+    uint32_t current = LoadAlignedWord(aligned);
+    // The word after the last output word may end past src + len; the last
+    // 4 to 7 bytes are left to the byte loop
+    for (; len >= 8; len -= 4, src += 4, dst += 4) {
+      aligned += 4;
+      const uint32_t next = LoadAlignedWord(aligned);
+      StoreAlignedWord(dst, (current >> low_shift) | (next << high_shift));
+      current = next;
+    }
+  }
+
+  while (len > 0) {
+    *dst++ = *src++;
+    --len;
+  }
+}
+#endif
+
+/**
+ * @brief Copy one contiguous piece into TX buffer
+ * @param dst Destination inside g_tx_buffer
+ * @param src Source
+ * @param len Number of bytes
+ */
+inline void CopyTxBytes(uint8_t* dst, const uint8_t* src, int len) {
+#if HAL_DMA_PRINTF_ENABLE_WORD_COPY
+  CopyToRing(dst, src, len);
+#else
+  memcpy(dst, src, len);
+#endif
+}
+
+/**
+ * @brief Copy data into TX buffer at write position
+ * @param data Pointer to data
+ * @param len Length of data (caller guarantees enough free space)
+ */
+void CopyToTxBuffer(const uint8_t* data, int len) {
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+  if (g_tx_read_idx == g_tx_write_idx) { g_tx_queued_tick = HAL_GetTick(); }
+#endif
+  const int space_at_end = HAL_DMA_PRINTF_BUFFER_SIZE - g_tx_write_idx;
+  if (space_at_end > len) {
+    CopyTxBytes(&g_tx_buffer[g_tx_write_idx], data, len);
+    g_tx_write_idx = g_tx_write_idx + len;
+  } else {
+    CopyTxBytes(&g_tx_buffer[g_tx_write_idx], data, space_at_end);
+    CopyTxBytes(g_tx_buffer, data + space_at_end, len - space_at_end);
+    g_tx_write_idx = len - space_at_end;
+  }
+  g_tx_write_total += len;
+}
+
+/**
+ * @brief Calculate free space in TX buffer
+ * @return Number of bytes that can be queued without overwriting pending or
+ * in-flight data
+ */
+inline int GetTxFreeBytes() {
+  // One slot stays empty so that a full buffer is distinguishable from empty
+  return HAL_DMA_PRINTF_BUFFER_SIZE - 1 - GetTxAvailableBytes() -
+         g_tx_dma_size;
+}
+
+/**
+ * @brief Check whether output currently uses an encoding
+ * @param encoding HAL_DMA_PRINTF_ENCODING_* flag
+ * @return true if in use (always, if the build supports it and negotiation
+ * is disabled)
+ */
+inline bool IsEncodingActive(uint8_t encoding) {
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+  return (g_encoding & encoding) != 0;
+#else
+  return (kSupportedEncoding & encoding) != 0;
+#endif
+}
+
+/**
+ * @brief Calculate worst-case buffer space needed for a message
+ * @param len Length of message
+ * @return Number of bytes, including the message's sequence tag
+ */
+inline int GetTxRequiredBytes(int len) {
+  int size = len;
+#if HAL_DMA_PRINTF_ENABLE_DICTIONARY
+  // Every byte may need an escape
+  if (IsEncodingActive(HAL_DMA_PRINTF_ENCODING_DICTIONARY)) { size = 2 * len; }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_SEQUENCE
+  if (IsEncodingActive(HAL_DMA_PRINTF_ENCODING_FRAMES)) {
+    size += kSequenceTagMaxSize;
+  }
+#endif
+  return size;
+}
+
+/**
+ * @brief Count a message lost to a full TX buffer
+ * @param severity Severity of the message
+ * @param len Length of the message
+ */
+inline void CountDroppedMessage(HalDmaPrintfSeverity severity, int len) {
+  ++g_stats.dropped_messages[severity];
+  g_stats.lost_bytes += len;
+#if HAL_DMA_PRINTF_ENABLE_SEQUENCE
+  // The number is skipped, so the host sees a gap the lost count explains
+  ++g_sequence;
+  ++g_lost_messages;
+#endif
+}
+
+#if HAL_DMA_PRINTF_ENABLE_SEQUENCE
+/**
+ * @brief Queue the sequence frame that goes in front of a message
+ * @details The running lost count is included when it changed since the
+ * last tag, and on every kSequenceLostInterval-th message. Caller guarantees
+ * kSequenceTagMaxSize free bytes.
+ */
+void WriteSequenceTag() {
+  using hal_dma_printf_internal::kFrameOverhead;
+
+  const uint16_t lost = g_lost_messages;
+  const bool with_lost = (lost != g_lost_messages_sent) ||
+                         (g_sequence % kSequenceLostInterval == 0);
+  const uint8_t payload_size = with_lost ? 4 : 2;
+  uint8_t tag[kSequenceTagMaxSize] = {
+      hal_dma_printf_internal::kFrameSync,
+      hal_dma_printf_internal::kFrameTypeSequence,
+      payload_size,
+      0,
+      static_cast<uint8_t>(g_sequence),
+      static_cast<uint8_t>(g_sequence >> 8),
+      static_cast<uint8_t>(lost),
+      static_cast<uint8_t>(lost >> 8)};
+
+  const int size = kFrameOverhead + payload_size;
+  uint8_t sum = 0;
+  for (int i = 1; i < size - 1; ++i) { sum += tag[i]; }
+  tag[size - 1] = static_cast<uint8_t>(-sum);
+  CopyToTxBuffer(tag, size);
+
+  g_lost_messages_sent = lost;
+  ++g_sequence;
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_DICTIONARY
+// Dictionary coding (must match tools/hal_dma_printf_tool.py)
+constexpr uint8_t kDictEscape = 0x7F;
+constexpr uint8_t kDictEscapeXor = 0x40;
+constexpr uint8_t kDictTokenBase = 0x80;
+
+static_assert(hal_dma_printf_dictionary::kEntryCount <= 0x100 - kDictTokenBase,
+              "Dictionary has more entries than token bytes");
+
+/**
+ * @brief Find the dictionary entry text starts with
+ * @param ptr Pointer to text
+ * @param len Length of text
+ * @return Entry index, or -1 if no entry matches
+ * @details Entries sharing the first byte are sorted longest first, so the
+ * first match is the longest.
+ */
+inline int MatchDictionaryEntry(const char* ptr, int len) {
+  namespace dict = hal_dma_printf_dictionary;
+
+  const uint8_t ch = static_cast<uint8_t>(ptr[0]);
+  for (int e = dict::kFirstEntry[ch]; e < dict::kFirstEntry[ch + 1]; ++e) {
+    const int entry_len = dict::kEntryLengths[e];
+    if (entry_len <= len && memcmp(ptr, dict::kEntries[e], entry_len) == 0) {
+      return e;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Calculate the length of text encoded with the static dictionary
+ * @param ptr Pointer to text
+ * @param len Length of text
+ * @return Number of bytes WriteDictionaryEncoded writes for the text
+ */
+int GetDictionaryEncodedSize(const char* ptr, int len) {
+  int size = 0;
+  int i = 0;
+  while (i < len) {
+    const int entry = MatchDictionaryEntry(&ptr[i], len - i);
+    if (entry >= 0) {
+      ++size;
+      i += hal_dma_printf_dictionary::kEntryLengths[entry];
+      continue;
+    }
+    const uint8_t ch = static_cast<uint8_t>(ptr[i]);
+    size += (ch == 0 || ch >= kDictEscape) ? 2 : 1;
+    ++i;
+  }
+  return size;
+}
+
+/**
+ * @brief Encode text with the static dictionary directly into TX buffer
+ * @param ptr Pointer to text to encode
+ * @param len Length of text
+ * @details Dictionary matches become a single token byte; bytes that could be
+ * mistaken for a token, the escape itself or NUL are escaped. The table lives
+ * in flash, so no RAM beyond the TX buffer is needed.
+ */
+void WriteDictionaryEncoded(const char* ptr, int len) {
+  int write_idx = g_tx_write_idx;
+  auto push = [&write_idx](uint8_t byte) {
+    g_tx_buffer[write_idx] = byte;
+    write_idx = (write_idx + 1) % HAL_DMA_PRINTF_BUFFER_SIZE;
+  };
+
+  int i = 0;
+  while (i < len) {
+    const int entry = MatchDictionaryEntry(&ptr[i], len - i);
+    if (entry >= 0) {
+      push(static_cast<uint8_t>(kDictTokenBase + entry));
+      i += hal_dma_printf_dictionary::kEntryLengths[entry];
+      continue;
+    }
+
+    const uint8_t ch = static_cast<uint8_t>(ptr[i]);
+    if (ch == 0 || ch >= kDictEscape) {
+      push(kDictEscape);
+      push(ch ^ kDictEscapeXor);
+    } else {
+      push(ch);
+    }
+    ++i;
+  }
+
+  g_tx_write_total +=
+      (write_idx - g_tx_write_idx + HAL_DMA_PRINTF_BUFFER_SIZE) %
+      HAL_DMA_PRINTF_BUFFER_SIZE;
+  g_tx_write_idx = write_idx;
+}
+
+/**
+ * @brief Write text with dictionary escaping only, as far as space allows
+ * @param ptr Pointer to text
+ * @param len Length of text
+ * @param free_bytes Free space in TX buffer
+ * @return Number of input bytes consumed
+ * @details Used for output written in pieces, where a dictionary match could
+ * straddle two writes.
+ */
+int WriteDictionaryEscaped(const char* ptr, int len, int free_bytes) {
+  int write_idx = g_tx_write_idx;
+  int consumed = 0;
+  while (consumed < len) {
+    const uint8_t ch = static_cast<uint8_t>(ptr[consumed]);
+    const bool escape = (ch == 0 || ch >= kDictEscape);
+    const int needed = escape ? 2 : 1;
+    if (free_bytes < needed) { break; }
+    free_bytes -= needed;
+
+    if (escape) {
+      g_tx_buffer[write_idx] = kDictEscape;
+      write_idx = (write_idx + 1) % HAL_DMA_PRINTF_BUFFER_SIZE;
+      g_tx_buffer[write_idx] = ch ^ kDictEscapeXor;
+    } else {
+      g_tx_buffer[write_idx] = ch;
+    }
+    write_idx = (write_idx + 1) % HAL_DMA_PRINTF_BUFFER_SIZE;
+    ++consumed;
+  }
+
+  g_tx_write_total +=
+      (write_idx - g_tx_write_idx + HAL_DMA_PRINTF_BUFFER_SIZE) %
+      HAL_DMA_PRINTF_BUFFER_SIZE;
+  g_tx_write_idx = write_idx;
+  return consumed;
+}
+#endif
+
+/**
+ * @brief Calculate the exact buffer space needed for a message
+ * @param ptr Pointer to the message
+ * @param len Length of message
+ * @return Number of bytes, including the message's sequence tag
+ * @details Unlike GetTxRequiredBytes, a dictionary-encoded message only
+ * reserves what it encodes to, so messages longer than half of TX buffer
+ * still fit.
+ */
+inline int GetMessageRequiredBytes([[maybe_unused]] const char* ptr,
+                                   int len) {
+  int size = len;
+#if HAL_DMA_PRINTF_ENABLE_DICTIONARY
+  if (IsEncodingActive(HAL_DMA_PRINTF_ENCODING_DICTIONARY)) {
+    size = GetDictionaryEncodedSize(ptr, len);
+  }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_SEQUENCE
+  if (IsEncodingActive(HAL_DMA_PRINTF_ENCODING_FRAMES)) {
+    size += kSequenceTagMaxSize;
+  }
+#endif
+  return size;
+}
+
+/**
+ * @brief Queue message text in the current encoding
+ * @param ptr Pointer to text
+ * @param len Length of text (GetMessageRequiredBytes(ptr, len) free bytes
+ * checked by the caller)
+ */
+inline void QueueText(const char* ptr, int len) {
+#if HAL_DMA_PRINTF_ENABLE_DICTIONARY
+  if (IsEncodingActive(HAL_DMA_PRINTF_ENCODING_DICTIONARY)) {
+    WriteDictionaryEncoded(ptr, len);
+    return;
+  }
+#endif
+  CopyToTxBuffer(reinterpret_cast<const uint8_t*>(ptr), len);
+}
+
+#if HAL_DMA_PRINTF_ENABLE_EVICTION
+/**
+ * @brief Remember a message just written to TX buffer
+ * @param start Value of g_tx_write_total before the message was written
+ * @param severity Severity of the message
+ * @details Records already handed to the DMA are retired first. When the
+ * table is still full the message is simply not tracked, which only means it
+ * cannot be evicted.
+ */
+void AddTxRecord(uint32_t start, HalDmaPrintfSeverity severity) {
+  int retired = 0;
+  while (retired < g_record_count &&
+         static_cast<int32_t>(g_records[retired].start - g_tx_dispatch_total) <
+             0) {
+    ++retired;
+  }
+  if (retired > 0) {
+    g_record_count -= retired;
+    memmove(g_records, &g_records[retired], g_record_count * sizeof(TxRecord));
+  }
+
+  if (g_record_count < HAL_DMA_PRINTF_MAX_RECORDS) {
+    g_records[g_record_count++] = {
+        start, static_cast<int>(g_tx_write_total - start), severity};
+  }
+}
+
+/**
+ * @brief Remove a queued record's bytes from TX buffer
+ * @param index Index in g_records
+ * @details Later queued bytes are moved down over the record. Must be called
+ * with interrupts disabled, since the DMA may otherwise be restarted on the
+ * bytes being moved.
+ */
+void RemoveTxRecord(int index) {
+  const TxRecord record = g_records[index];
+  const int queued = GetTxAvailableBytes();
+  const int offset = static_cast<int>(record.start - g_tx_dispatch_total);
+
+  for (int i = offset; i + record.size < queued; ++i) {
+    g_tx_buffer[(g_tx_read_idx + i) % HAL_DMA_PRINTF_BUFFER_SIZE] =
+        g_tx_buffer[(g_tx_read_idx + i + record.size) %
+                    HAL_DMA_PRINTF_BUFFER_SIZE];
+  }
+  g_tx_write_idx =
+      (g_tx_write_idx - record.size + HAL_DMA_PRINTF_BUFFER_SIZE) %
+      HAL_DMA_PRINTF_BUFFER_SIZE;
+  g_tx_write_total -= record.size;
+
+  for (int i = index + 1; i < g_record_count; ++i) {
+    g_records[i].start -= record.size;
+    g_records[i - 1] = g_records[i];
+  }
+  --g_record_count;
+
+#if HAL_DMA_PRINTF_ENABLE_STATUS
+  // Status frames queued after the record moved down with the data
+  for (StatusSlot& slot : g_status_slots) {
+    if (static_cast<int32_t>(slot.start - record.start) > 0) {
+      slot.start -= record.size;
+    }
+  }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+  for (FdState& state : g_fd_states) {
+    // The message may start after its sequence tag
+    const uint32_t record_offset = state.last_start - record.start;
+    if (record_offset < static_cast<uint32_t>(record.size)) {
+      state.last_size = 0;
+    } else if (static_cast<int32_t>(record_offset) > 0) {
+      state.last_start -= record.size;
+    }
+  }
+#endif
+
+  ++g_stats.evicted_messages[record.severity];
+  g_stats.lost_bytes += record.size;
+#if HAL_DMA_PRINTF_ENABLE_SEQUENCE
+  ++g_lost_messages;
+#endif
+}
+
+/**
+ * @brief Evict queued low-severity messages until enough space is free
+ * @param required Number of free bytes needed
+ * @param severity Severity of the incoming message
+ * @return true if enough space is free now
+ * @details Only WARNING and above may evict, and only DEBUG and INFO messages
+ * are evicted: lowest severity first, oldest first within a severity.
+ * Messages already handed to the DMA are never touched.
+ */
+bool EvictTxRecords(int required, HalDmaPrintfSeverity severity) {
+  if (severity < HAL_DMA_PRINTF_SEVERITY_WARNING) { return false; }
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  for (int victim = HAL_DMA_PRINTF_SEVERITY_DEBUG;
+       victim < HAL_DMA_PRINTF_SEVERITY_WARNING &&
+       GetTxFreeBytes() < required;
+       ++victim) {
+    int i = 0;
+    while (i < g_record_count && GetTxFreeBytes() < required) {
+      const bool queued = static_cast<int32_t>(g_records[i].start -
+                                               g_tx_dispatch_total) >= 0;
+      if (queued && g_records[i].severity == victim) {
+        RemoveTxRecord(i);
+      } else {
+        ++i;
+      }
+    }
+  }
+
+  const bool has_space = GetTxFreeBytes() >= required;
+  __set_PRIMASK(primask);
+  return has_space;
+}
+
+/**
+ * @brief Evict the oldest queued messages until enough space is free
+ * @param required Number of free bytes needed
+ * @param severity Severity of the incoming message
+ * @return true if enough space is free now
+ * @details Used by HAL_DMA_PRINTF_OVERFLOW_DROP_OLDEST. Only messages of the
+ * same or a lower severity are evicted.
+ */
+[[maybe_unused]] bool EvictOldestTxRecords(int required,
+                                           HalDmaPrintfSeverity severity) {
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  int i = 0;
+  while (i < g_record_count && GetTxFreeBytes() < required) {
+    const bool queued =
+        static_cast<int32_t>(g_records[i].start - g_tx_dispatch_total) >= 0;
+    if (queued && g_records[i].severity <= severity) {
+      RemoveTxRecord(i);
+    } else {
+      ++i;
+    }
+  }
+
+  const bool has_space = GetTxFreeBytes() >= required;
+  __set_PRIMASK(primask);
+  return has_space;
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_GATING
+/**
+ * @brief Value that changes whenever bytes are received
+ * @return RX DMA counter, or with the RX pool the bytes handed over (the
+ * counter restarts with every block)
+ */
+inline uint32_t GetRxActivity() {
+#if HAL_DMA_PRINTF_ENABLE_RX_POOL
+  return g_rx_pool_received;
+#else
+  return g_huart->hdmarx->Instance->NDTR;
+#endif
+}
+#endif
+
+/**
+ * @brief Check whether anybody is listening on the TX side
+ * @return true if output should be produced
+ * @details In RX activity mode, any received byte (including host tool
+ * heartbeats) counts as a sign of life. The RX DMA counter is compared with
+ * its last seen value, so no interrupt is needed.
+ */
+inline bool IsListenerConnected() {
+#if HAL_DMA_PRINTF_ENABLE_GATING
+  switch (g_gating_mode) {
+    case HAL_DMA_PRINTF_GATING_RX_ACTIVITY: {
+      const uint32_t activity = GetRxActivity();
+      const uint32_t now = HAL_GetTick();
+      if (activity != g_last_rx_activity) {
+        g_last_rx_activity = activity;
+        g_last_rx_tick = now;
+      }
+      return now - g_last_rx_tick < g_gating_timeout_ms;
+    }
+    case HAL_DMA_PRINTF_GATING_CALLBACK:
+      return g_listener_callback();
+    default:
+      return true;
+  }
+#else
+  return true;
+#endif
+}
+
+/**
+ * @brief Make sure TX buffer can take a message
+ * @param required Number of free bytes needed
+ * @param severity Severity of the message
+ * @return true if the message fits
+ */
+inline bool MakeTxSpace(int required,
+                        [[maybe_unused]] HalDmaPrintfSeverity severity) {
+  if (GetTxFreeBytes() >= required) { return true; }
+#if HAL_DMA_PRINTF_ENABLE_EVICTION
+  return EvictTxRecords(required, severity);
+#else
+  return false;
+#endif
+}
+
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+/**
+ * @brief End a command latency measurement if its response starts now
+ * @param start TX buffer index of the first byte being sent
+ * @param size Number of bytes being sent
+ */
+inline void CheckResponseStart(int start, int size) {
+  if (g_latency_tx_idx < 0) { return; }
+  int offset = g_latency_tx_idx - start;
+  if (offset < 0) { offset += HAL_DMA_PRINTF_BUFFER_SIZE; }
+  if (offset >= size) { return; }
+  g_latency_tx_idx = -1;
+  hal_dma_printf_internal::RecordResponseSent();
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_STRIPING
+/**
+ * @brief Hand the next chunks of TX buffer to every idle bonded link
+ * @details Runs from _write and from both links' completion interrupts, so
+ * it executes with interrupts disabled.
+ */
+void StartStripedTransmit() {
+  using hal_dma_printf_internal::kFrameSync;
+  using hal_dma_printf_internal::kFrameTypeStripe;
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  for (StripeLink& link : g_stripe_links) {
+    const int available = GetTxAvailableBytes();
+    if (available == 0) { break; }
+    if (link.busy) { continue; }
+
+    const int chunk_size = (available < HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE)
+                               ? available
+                               : HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE;
+    const int payload_size = chunk_size + 2;
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+    CheckResponseStart(g_tx_read_idx, chunk_size);
+#endif
+    uint8_t* frame = link.frame;
+    frame[0] = kFrameSync;
+    frame[1] = kFrameTypeStripe;
+    frame[2] = static_cast<uint8_t>(payload_size & 0xFF);
+    frame[3] = static_cast<uint8_t>(payload_size >> 8);
+    frame[4] = static_cast<uint8_t>(g_stripe_sequence & 0xFF);
+    frame[5] = static_cast<uint8_t>(g_stripe_sequence >> 8);
+    ++g_stripe_sequence;
+
+    uint8_t sum = frame[1] + frame[2] + frame[3] + frame[4] + frame[5];
+    for (int i = 0; i < chunk_size; ++i) {
+      const uint8_t byte = g_tx_buffer[g_tx_read_idx];
+      frame[kStripeHeaderSize + i] = byte;
+      sum += byte;
+      g_tx_read_idx = (g_tx_read_idx + 1) % HAL_DMA_PRINTF_BUFFER_SIZE;
+    }
+    frame[kStripeHeaderSize + chunk_size] = static_cast<uint8_t>(-sum);
+    g_tx_dispatch_total += chunk_size;
+
+    link.busy = true;
+    HAL_UART_Transmit_DMA(link.huart, frame,
+                          kStripeHeaderSize + chunk_size + 1);
+  }
+
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Check whether transmission is striped over two UARTs
+ * @return true after HalDmaPrintfSetupBonded
+ */
+inline bool IsStriped() { return g_stripe_links[1].huart != nullptr; }
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_LL_TX
+/**
+ * @brief Prepare TX DMA stream and USART for register-level transfers
+ * @details The stream keeps the direction, width and increment settings from
+ * HAL_DMA_Init; only the peripheral address and interrupt enables are set
+ * here, once, instead of on every transfer.
+ */
+void SetupLowLevelTransmit() {
+  DMA_Stream_TypeDef* stream = g_huart->hdmatx->Instance;
+  auto* dma =
+      reinterpret_cast<DmaBaseRegisters*>(g_huart->hdmatx->StreamBaseAddress);
+
+  CLEAR_BIT(stream->CR, DMA_SxCR_EN);
+  while (READ_BIT(stream->CR, DMA_SxCR_EN) != 0) {}
+  dma->IFCR = kDmaAllFlags << g_huart->hdmatx->StreamIndex;
+
+#ifdef USART_TDR_TDR
+  stream->PAR = static_cast<uint32_t>(
+      reinterpret_cast<uintptr_t>(&g_huart->Instance->TDR));
+#else
+  stream->PAR = static_cast<uint32_t>(
+      reinterpret_cast<uintptr_t>(&g_huart->Instance->DR));
+#endif
+  MODIFY_REG(stream->CR, DMA_SxCR_HTIE | DMA_SxCR_DMEIE,
+             DMA_SxCR_TCIE | DMA_SxCR_TEIE);
+  SET_BIT(g_huart->Instance->CR3, USART_CR3_DMAT);
+}
+
+/**
+ * @brief Start one transfer by writing the DMA stream registers directly
+ * @param data Start of the data (inside TX buffer)
+ * @param size Number of bytes
+ * @details Replaces HAL_UART_Transmit_DMA, which locks the handle, checks
+ * state and reprograms the whole stream for every transfer. The stream is
+ * idle here: it is only started again after its completion interrupt.
+ */
+inline void StartLowLevelTransmit(const uint8_t* data, int size) {
+  DMA_Stream_TypeDef* stream = g_huart->hdmatx->Instance;
+  stream->M0AR = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(data));
+  stream->NDTR = static_cast<uint32_t>(size);
+  SET_BIT(stream->CR, DMA_SxCR_EN);
+}
+#endif
+
+/**
+ * @brief Start the DMA on a contiguous block
+ * @param data Start of the data
+ * @param size Number of bytes
+ */
+inline void StartTransfer(const uint8_t* data, int size) {
+#if HAL_DMA_PRINTF_ENABLE_BENCHMARK
+  // Restart latency: completion callback entry to the next transfer start
+  if (g_benchmark.active && g_benchmark.complete_cycles != 0) {
+    g_benchmark.restart_cycles +=
+        GetCycleCount() - g_benchmark.complete_cycles;
+    ++g_benchmark.restart_count;
+    g_benchmark.complete_cycles = 0;
+  }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+  if (data >= g_tx_buffer && data < g_tx_buffer + HAL_DMA_PRINTF_BUFFER_SIZE) {
+    CheckResponseStart(static_cast<int>(data - g_tx_buffer), size);
+  }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_LL_TX
+  StartLowLevelTransmit(data, size);
+#else
+  HAL_UART_Transmit_DMA(g_huart, data, size);
+#endif
+}
+
+/**
+ * @brief Hand a contiguous part of TX buffer (or a class queue) to the DMA
+ * @param data Start of the data
+ * @param size Number of bytes
+ * @param dma_size Counter the caller added @p size to; released once sent
+ * @details With HAL_DMA_PRINTF_ENABLE_DEFERRED the chunk is only prepared;
+ * the completion interrupt of the running transfer starts it.
+ */
+inline void TransmitDma(const uint8_t* data, int size,
+                        [[maybe_unused]] volatile int& dma_size) {
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED
+  g_tx_next = {data, size, &dma_size};
+#else
+  StartTransfer(data, size);
+#endif
+}
+
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+/**
+ * @brief Number of bytes queued in an output class
+ * @param class_id Class index
+ * @return Bytes not yet handed to the DMA
+ */
+inline int GetClassQueuedBytes(int class_id) {
+  if (class_id == 0) { return GetTxAvailableBytes(); }
+  const ClassQueue& queue = g_class_queues[class_id - 1];
+  return static_cast<int>(queue.write_total - queue.dispatch_total);
+}
+
+/**
+ * @brief Time the oldest queued message of a class was queued
+ * @param class_id Class index (must have queued bytes)
+ * @return HAL_GetTick() value
+ */
+inline uint32_t GetClassOldestTick(int class_id) {
+  if (class_id == 0) { return g_tx_queued_tick; }
+  const ClassQueue& queue = g_class_queues[class_id - 1];
+  return queue.messages[queue.message_head].tick;
+}
+
+/**
+ * @brief Bytes a class is credited per round
+ * @param tx_class Class state
+ * @return Quantum in bytes
+ */
+inline int32_t GetClassQuantum(const TxClass& tx_class) {
+  const int32_t weight =
+      (tx_class.config.weight > 0) ? tx_class.config.weight : 1;
+  return weight * HAL_DMA_PRINTF_CLASS_QUANTUM;
+}
+
+/**
+ * @brief Choose the class that gets the next DMA transfer
+ * @return Class index, or -1 if nothing is queued
+ * @details A class whose oldest message has waited its max_latency_ms goes
+ * first (the most overdue one if several). Otherwise deficit round-robin:
+ * classes with credit left are served in turn, and once none has any, every
+ * backlogged class is credited its quantum for as many rounds as it takes
+ * to give one of them credit again. A transfer may overdraw the credit;
+ * the class then sits out until later rounds have paid it back.
+ */
+int SelectClass() {
+  if (g_class_continue >= 0) { return g_class_continue; }
+
+  const uint32_t now = HAL_GetTick();
+  int overdue_class = -1;
+  uint32_t most_overdue = 0;
+  bool backlogged = false;
+  for (int c = 0; c < HAL_DMA_PRINTF_CLASS_COUNT; ++c) {
+    TxClass& tx_class = g_classes[c];
+    if (GetClassQueuedBytes(c) == 0) {
+      // An idle class does not save up credit (debt is kept)
+      if (tx_class.deficit > 0) { tx_class.deficit = 0; }
+      continue;
+    }
+    backlogged = true;
+
+    const uint32_t limit = tx_class.config.max_latency_ms;
+    const uint32_t waited = now - GetClassOldestTick(c);
+    if (limit != 0 && waited >= limit &&
+        (overdue_class < 0 || waited - limit > most_overdue)) {
+      overdue_class = c;
+      most_overdue = waited - limit;
+    }
+  }
+  if (!backlogged) { return -1; }
+  if (overdue_class >= 0) {
+    ++g_classes[overdue_class].stats.deadline_boosts;
+    return overdue_class;
+  }
+
+  for (;;) {
+    for (int i = 0; i < HAL_DMA_PRINTF_CLASS_COUNT; ++i) {
+      const int c = (g_class_turn + i) % HAL_DMA_PRINTF_CLASS_COUNT;
+      if (g_classes[c].deficit > 0 && GetClassQueuedBytes(c) > 0) {
+        return c;
+      }
+    }
+
+    int32_t rounds = INT32_MAX;
+    for (int c = 0; c < HAL_DMA_PRINTF_CLASS_COUNT; ++c) {
+      if (GetClassQueuedBytes(c) == 0) { continue; }
+      const int32_t quantum = GetClassQuantum(g_classes[c]);
+      const int32_t needed = (quantum - g_classes[c].deficit) / quantum;
+      if (needed < rounds) { rounds = needed; }
+    }
+    for (int c = 0; c < HAL_DMA_PRINTF_CLASS_COUNT; ++c) {
+      if (GetClassQueuedBytes(c) == 0) { continue; }
+      g_classes[c].deficit += rounds * GetClassQuantum(g_classes[c]);
+    }
+  }
+}
+
+/**
+ * @brief Account a transfer to a class and advance the round-robin turn
+ * @param class_id Class index
+ * @param size Bytes handed to the DMA
+ */
+void ChargeClass(int class_id, int size) {
+  TxClass& tx_class = g_classes[class_id];
+  tx_class.deficit -= size;
+  tx_class.stats.sent_bytes += size;
+  ++tx_class.stats.transfers;
+  g_class_turn = (tx_class.deficit > 0)
+                     ? class_id
+                     : (class_id + 1) % HAL_DMA_PRINTF_CLASS_COUNT;
+}
+
+/**
+ * @brief Record the queueing delay of a message that is being sent
+ * @param tx_class Class state
+ * @param queued_tick HAL_GetTick() when the message was queued
+ */
+inline void RecordClassLatency(TxClass& tx_class, uint32_t queued_tick) {
+  const uint32_t latency = HAL_GetTick() - queued_tick;
+  if (latency > tx_class.stats.max_latency_ms) {
+    tx_class.stats.max_latency_ms = latency;
+  }
+}
+
+/**
+ * @brief Hand whole messages of a class queue to the DMA
+ * @param class_id Class index (1 and up)
+ * @return Number of bytes handed to the DMA
+ * @details Messages go while they are contiguous in the ring and within
+ * the class's credit; the first one always goes. A message wrapping around
+ * the ring end is sent in two transfers back to back, so output of another
+ * class never lands inside it.
+ */
+int StartClassTransmit(int class_id) {
+  ClassQueue& queue = g_class_queues[class_id - 1];
+  TxClass& tx_class = g_classes[class_id];
+  const int contiguous = (queue.write_idx >= queue.read_idx)
+                             ? queue.write_idx - queue.read_idx
+                             : HAL_DMA_PRINTF_CLASS_BUFFER_SIZE -
+                                   queue.read_idx;
+
+  int size = 0;
+  g_class_continue = -1;
+  while (queue.message_count > 0) {
+    const ClassMessage& message = queue.messages[queue.message_head];
+    const int end = static_cast<int>(message.end - queue.dispatch_total);
+    if (end > contiguous) {
+      if (size == 0) {
+        size = contiguous;
+        g_class_continue = class_id;
+      }
+      break;
+    }
+    if (size > 0 && end > tx_class.deficit) { break; }
+
+    size = end;
+    RecordClassLatency(tx_class, message.tick);
+    queue.message_head =
+        (queue.message_head + 1) % HAL_DMA_PRINTF_CLASS_MAX_MESSAGES;
+    --queue.message_count;
+  }
+
+  const uint8_t* data = &queue.buffer[queue.read_idx];
+  queue.dma_size += size;
+  queue.dispatch_total += size;
+  queue.read_idx = (queue.read_idx + size) % HAL_DMA_PRINTF_CLASS_BUFFER_SIZE;
+  g_class_dma = &queue;
+  TransmitDma(data, size, queue.dma_size);
+  return size;
+}
+#endif
+
+/**
+ * @brief Check whether any output waits for the DMA
+ * @return true if TX buffer (or a class queue) holds unsent bytes
+ */
+inline bool IsTxDataQueued() {
+  if (g_tx_read_idx != g_tx_write_idx) { return true; }
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+  for (const ClassQueue& queue : g_class_queues) {
+    if (queue.write_total != queue.dispatch_total) { return true; }
+  }
+#endif
+  return false;
+}
+
+/**
+ * @brief Start DMA transmission for pending data
+ * @details Handles ring buffer wraparound by transmitting in two parts if
+ * needed
+ */
+void StartDmaTransmit() {
+#if HAL_DMA_PRINTF_ENABLE_STRIPING
+  if (IsStriped()) {
+    StartStripedTransmit();
+    return;
+  }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+  const int class_id = SelectClass();
+  if (class_id > 0) {
+    ChargeClass(class_id, StartClassTransmit(class_id));
+    return;
+  }
+  if (class_id == 0) { RecordClassLatency(g_classes[0], g_tx_queued_tick); }
+  g_class_continue = -1;
+  const uint32_t dispatch_start = g_tx_dispatch_total;
+#endif
+
+  if (g_tx_write_idx < g_tx_read_idx) {
+    // Wraparound case: transmit from read position to end of buffer
+    const int first_part_size = HAL_DMA_PRINTF_BUFFER_SIZE - g_tx_read_idx;
+    g_tx_dma_size += first_part_size;
+    g_tx_dispatch_total += first_part_size;
+    TransmitDma(&g_tx_buffer[g_tx_read_idx], first_part_size, g_tx_dma_size);
+    g_tx_read_idx = 0;
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+    // The rest goes next, so other classes never land inside a message
+    if (class_id == 0 && g_tx_write_idx > 0) { g_class_continue = 0; }
+#endif
+  } else {
+    // Normal case: transmit from read to write position
+    const int transmit_size = g_tx_write_idx - g_tx_read_idx;
+    g_tx_dma_size += transmit_size;
+    g_tx_dispatch_total += transmit_size;
+    TransmitDma(&g_tx_buffer[g_tx_read_idx], transmit_size, g_tx_dma_size);
+    g_tx_read_idx = g_tx_write_idx;
+  }
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+  // TX buffer has no message boundaries; class 0 sends what is contiguous,
+  // a continuation past the ring end included
+  if (class_id == 0) {
+    ChargeClass(0, static_cast<int>(g_tx_dispatch_total - dispatch_start));
+  }
+#endif
+}
+
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED
+/**
+ * @brief Start the prepared chunk if the DMA is idle
+ * @details Called with interrupts disabled (or from the completion
+ * interrupt).
+ */
+inline void LaunchNextChunk() {
+  if (g_tx_inflight.size != 0 || g_tx_next.size == 0) { return; }
+  g_tx_inflight = g_tx_next;
+  g_tx_next = {};
+  StartTransfer(g_tx_inflight.data, g_tx_inflight.size);
+}
+
+/**
+ * @brief Keep one chunk prepared, and start it if the DMA is idle
+ * @details The deferred half of transfer completion; also run by writers.
+ */
+void PrepareNextChunk() {
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (g_tx_next.size == 0 && IsTxDataQueued()) { StartDmaTransmit(); }
+  LaunchNextChunk();
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Update count, total and maximum of a cycle measurement
+ * @param cycles Cycles of this run
+ * @param count Number of runs
+ * @param total Sum of cycles
+ * @param max Largest single run
+ */
+inline void RecordCycles(uint32_t cycles, uint32_t& count, uint32_t& total,
+                         uint32_t& max) {
+  ++count;
+  total += cycles;
+  if (cycles > max) { max = cycles; }
+}
+
+/**
+ * @brief Interrupt half of transfer completion
+ * @details Restarts the DMA on the chunk prepared while the finished one
+ * was running, releases the finished chunk's space and requests the
+ * deferred half. Nothing here depends on how many features are enabled.
+ */
+void CompleteTransferInIsr() {
+  const uint32_t start_cycles = GetCycleCount();
+
+  const TxChunk done = g_tx_inflight;
+  g_tx_inflight = {};
+  if (g_tx_next.size == 0 && IsTxDataQueued()) {
+    // Link stays idle until the deferred half runs
+    ++g_deferred_stats.prepare_misses;
+  }
+  LaunchNextChunk();
+  if (done.dma_size != nullptr) { *done.dma_size -= done.size; }
+  if (g_deferred_trigger != nullptr) { g_deferred_trigger(); }
+
+  RecordCycles(GetCycleCount() - start_cycles, g_deferred_stats.isr_count,
+               g_deferred_stats.isr_cycles_total,
+               g_deferred_stats.isr_cycles_max);
+}
+#endif
+
+/**
+ * @brief DMA transmit complete callback
+ * @param huart UART handle (unused in this implementation)
+ */
+void OnDmaTransmitComplete([[maybe_unused]] UART_HandleTypeDef* huart) {
+#if HAL_DMA_PRINTF_ENABLE_BENCHMARK
+  const uint32_t entry_cycles = g_benchmark.active ? GetCycleCount() : 0;
+  g_benchmark.complete_cycles = entry_cycles;
+#endif
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED
+  CompleteTransferInIsr();
+#else
+  g_tx_dma_size = 0;
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+  if (g_class_dma != nullptr) {
+    g_class_dma->dma_size = 0;
+    g_class_dma = nullptr;
+  }
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_STRIPING
+  if (IsStriped()) {
+    for (StripeLink& link : g_stripe_links) {
+      if (link.huart == huart) { link.busy = false; }
+    }
+    StartStripedTransmit();
+    return;
+  }
+#endif
+
+  // If there's more data to send, start next transmission
+  if (IsTxDataQueued()) { StartDmaTransmit(); }
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_BENCHMARK
+  if (entry_cycles != 0) {
+    g_benchmark.isr_cycles += GetCycleCount() - entry_cycles;
+    ++g_benchmark.isr_count;
+  }
+#endif
+}
+
+/**
+ * @brief Start DMA transmission if a UART is idle
+ */
+inline void KickDmaTransmit() {
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED
+  // Also gives the completion interrupt a chunk to continue with
+  PrepareNextChunk();
+#else
+#if HAL_DMA_PRINTF_ENABLE_STRIPING
+  // Each link is checked under the lock inside StartStripedTransmit
+  if (IsStriped()) {
+    StartStripedTransmit();
+    return;
+  }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_LL_TX
+  // HAL state is not used; a transfer is in flight while g_tx_dma_size != 0
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+  if (g_tx_dma_size == 0 && g_class_dma == nullptr) { StartDmaTransmit(); }
+#else
+  if (g_tx_dma_size == 0) { StartDmaTransmit(); }
+#endif
+#else
+  if (g_huart->gState == HAL_UART_STATE_READY) { StartDmaTransmit(); }
+#endif
+#endif
+}
+
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+/**
+ * @brief Look up the output class of a file descriptor
+ * @param file File descriptor passed to _write
+ * @return Class index (0 for descriptors outside the table)
+ */
+inline int GetFdClass(int file) {
+  if (file < 0 || file >= HAL_DMA_PRINTF_MAX_FDS) { return 0; }
+  return g_fd_classes[file];
+}
+
+/**
+ * @brief Queue a message in the ring of an output class
+ * @param class_id Class index (1 and up)
+ * @param ptr Pointer to the message
+ * @param len Length of the message
+ * @return true if queued, false if the class queue is full
+ * @details The bytes are copied first and published afterwards, so the
+ * completion interrupt never sees a partly written message. When the
+ * message table is full the message joins the newest queued one.
+ */
+bool QueueClassMessage(int class_id, const char* ptr, int len) {
+  ClassQueue& queue = g_class_queues[class_id - 1];
+  const int free_bytes =
+      HAL_DMA_PRINTF_CLASS_BUFFER_SIZE - 1 -
+      static_cast<int>(queue.write_total - queue.dispatch_total) -
+      queue.dma_size;
+  if (len > free_bytes) { return false; }
+
+  const int space_at_end = HAL_DMA_PRINTF_CLASS_BUFFER_SIZE - queue.write_idx;
+  if (space_at_end > len) {
+    memcpy(&queue.buffer[queue.write_idx], ptr, len);
+  } else {
+    memcpy(&queue.buffer[queue.write_idx], ptr, space_at_end);
+    memcpy(queue.buffer, ptr + space_at_end, len - space_at_end);
+  }
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  queue.write_idx = (queue.write_idx + len) % HAL_DMA_PRINTF_CLASS_BUFFER_SIZE;
+  queue.write_total += len;
+  if (queue.message_count < HAL_DMA_PRINTF_CLASS_MAX_MESSAGES) {
+    const int tail = (queue.message_head + queue.message_count) %
+                     HAL_DMA_PRINTF_CLASS_MAX_MESSAGES;
+    queue.messages[tail] = {queue.write_total, HAL_GetTick()};
+    ++queue.message_count;
+  } else {
+    const int newest = (queue.message_head + queue.message_count - 1) %
+                       HAL_DMA_PRINTF_CLASS_MAX_MESSAGES;
+    queue.messages[newest].end = queue.write_total;
+  }
+  __set_PRIMASK(primask);
+  return true;
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_SPILL
+static_assert(HAL_DMA_PRINTF_SPILL_BLOCK_SIZE *
+                      (HAL_DMA_PRINTF_ENABLE_DICTIONARY ? 2 : 1) <
+                  HAL_DMA_PRINTF_BUFFER_SIZE,
+              "HAL_DMA_PRINTF_SPILL_BLOCK_SIZE must fit into TX buffer");
+
+/**
+ * @brief Check whether spilled text is waiting to be sent
+ * @return true if the spill device or the RAM block holds data
+ */
+inline bool IsSpillPending() {
+  return g_spill_count > 0 || g_spill_block_fill > 0;
+}
+
+/**
+ * @brief Append a message to the spill store
+ * @param ptr Pointer to text
+ * @param len Length of text
+ * @return true if stored, false if no device is set or it is full
+ * @details Full blocks are written to the device as soon as they fill up. A
+ * block the device fails to write is lost and counted in lost_bytes.
+ */
+bool SpillText(const char* ptr, int len) {
+  if (g_spill_device.write_block == nullptr) { return false; }
+
+  const uint32_t free_blocks = g_spill_device.block_count - g_spill_count;
+  const uint32_t capacity =
+      free_blocks * HAL_DMA_PRINTF_SPILL_BLOCK_SIZE - g_spill_block_fill;
+  if (static_cast<uint32_t>(len) > capacity) { return false; }
+
+  while (len > 0) {
+    int chunk = HAL_DMA_PRINTF_SPILL_BLOCK_SIZE - g_spill_block_fill;
+    if (chunk > len) { chunk = len; }
+    memcpy(&g_spill_block[g_spill_block_fill], ptr, chunk);
+    g_spill_block_fill += chunk;
+    ptr += chunk;
+    len -= chunk;
+
+    if (g_spill_block_fill == HAL_DMA_PRINTF_SPILL_BLOCK_SIZE) {
+      const uint32_t block =
+          (g_spill_head + g_spill_count) % g_spill_device.block_count;
+      if (g_spill_device.write_block(g_spill_device.context, block,
+                                     g_spill_block) == 0) {
+        ++g_spill_count;
+      } else {
+        g_stats.lost_bytes += HAL_DMA_PRINTF_SPILL_BLOCK_SIZE;
+      }
+      g_spill_block_fill = 0;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Queue text taken out of the spill store
+ * @param data Pointer to text
+ * @param len Length of text (free space has been checked by the caller)
+ */
+inline void QueueSpilledText(const uint8_t* data, int len) {
+  QueueText(reinterpret_cast<const char*>(data), len);
+  g_stats.spilled_bytes += len;
+}
+
+/**
+ * @brief Move spilled text into TX buffer, oldest first, while it fits
+ * @details Reads whole blocks, so the device is read at full rate as soon
+ * as TX buffer has room for one. Not for interrupt context: device reads
+ * may block.
+ */
+void DrainSpill() {
+  bool queued = false;
+  while (g_spill_count > 0) {
+    if (GetTxFreeBytes() <
+        GetTxRequiredBytes(HAL_DMA_PRINTF_SPILL_BLOCK_SIZE)) {
+      break;
+    }
+    if (g_spill_device.read_block(g_spill_device.context, g_spill_head,
+                                  g_spill_read_block) == 0) {
+      QueueSpilledText(g_spill_read_block, HAL_DMA_PRINTF_SPILL_BLOCK_SIZE);
+      queued = true;
+    } else {
+      g_stats.lost_bytes += HAL_DMA_PRINTF_SPILL_BLOCK_SIZE;
+    }
+    g_spill_head = (g_spill_head + 1) % g_spill_device.block_count;
+    --g_spill_count;
+  }
+
+  if (g_spill_count == 0 && g_spill_block_fill > 0 &&
+      GetTxFreeBytes() >= GetTxRequiredBytes(g_spill_block_fill)) {
+    QueueSpilledText(g_spill_block, g_spill_block_fill);
+    g_spill_block_fill = 0;
+    queued = true;
+  }
+
+  if (queued) { KickDmaTransmit(); }
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+/**
+ * @brief Fill the policy table with the defaults
+ * @details Every descriptor sends immediately and drops new messages on
+ * overflow; stderr has ERROR priority, all others INFO (as without
+ * HAL_DMA_PRINTF_ENABLE_FD_POLICY).
+ */
+void InitFdStates() {
+  for (int fd = 0; fd < HAL_DMA_PRINTF_MAX_FDS; ++fd) {
+    g_fd_states[fd] = {};
+    g_fd_states[fd].policy = {
+        HAL_DMA_PRINTF_FLUSH_IMMEDIATE, 0, HAL_DMA_PRINTF_OVERFLOW_DROP_NEW,
+        (fd == STDERR_FILENO) ? HAL_DMA_PRINTF_SEVERITY_ERROR
+                              : HAL_DMA_PRINTF_SEVERITY_INFO};
+  }
+  g_fd_states_ready = true;
+}
+
+/**
+ * @brief Look up the state of a file descriptor
+ * @param file File descriptor passed to _write
+ * @return Its entry, or stdout's for descriptors outside the table
+ */
+FdState& GetFdState(int file) {
+  if (!g_fd_states_ready) { InitFdStates(); }
+  if (file < 0 || file >= HAL_DMA_PRINTF_MAX_FDS) {
+    return g_fd_states[STDOUT_FILENO];
+  }
+  return g_fd_states[file];
+}
+
+/**
+ * @brief Wait for the DMA to free enough space (HAL_DMA_PRINTF_OVERFLOW_BLOCK)
+ * @param required Number of free bytes needed
+ * @param severity Severity of the message
+ * @return true if the message fits
+ * @details Interrupt handlers, code running with interrupts disabled and
+ * code before setup cannot wait for the DMA; they fall back to the default
+ * overflow handling.
+ */
+bool WaitForTxSpace(int required, HalDmaPrintfSeverity severity) {
+  if (GetTxFreeBytes() >= required) { return true; }
+  if (g_huart == nullptr || __get_IPSR() != 0 || __get_PRIMASK() != 0 ||
+      required > HAL_DMA_PRINTF_BUFFER_SIZE - 1) {
+    return MakeTxSpace(required, severity);
+  }
+
+  const uint32_t start_tick = HAL_GetTick();
+  while (GetTxFreeBytes() < required) {
+    KickDmaTransmit();
+    if (HAL_GetTick() - start_tick > kBlockTimeoutMs) { return false; }
+  }
+  return true;
+}
+
+/**
+ * @brief Make sure TX buffer can take a message, following the fd's policy
+ * @param required Number of free bytes needed
+ * @param severity Severity of the message
+ * @param overflow Overflow policy of the descriptor
+ * @return true if the message fits
+ */
+bool MakeFdTxSpace(int required, HalDmaPrintfSeverity severity,
+                   HalDmaPrintfOverflowPolicy overflow) {
+  switch (overflow) {
+    case HAL_DMA_PRINTF_OVERFLOW_BLOCK:
+      return WaitForTxSpace(required, severity);
+#if HAL_DMA_PRINTF_ENABLE_EVICTION
+    case HAL_DMA_PRINTF_OVERFLOW_DROP_OLDEST:
+      if (GetTxFreeBytes() >= required) { return true; }
+      return EvictOldestTxRecords(required, severity);
+#endif
+    default:
+      return MakeTxSpace(required, severity);
+  }
+}
+
+/**
+ * @brief Overwrite the fd's previous message if it is still queued
+ * @param state Descriptor state
+ * @param ptr Pointer to the new message
+ * @param len Length of the new message
+ * @return true if the new message replaced the old one
+ * @details HAL_DMA_PRINTF_OVERFLOW_LAST_VALUE: only a message of the same
+ * length that has not been handed to the DMA yet can be replaced.
+ */
+bool ReplaceLastValue(FdState& state, const char* ptr, int len) {
+  // Encoded lengths differ between values, so nothing is replaced
+  if (IsEncodingActive(HAL_DMA_PRINTF_ENCODING_DICTIONARY)) { return false; }
+  if (state.last_size != len) { return false; }
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  // A message whose start was already handed to the DMA has a negative
+  // offset, even when its tail is still queued past the ring end
+  const int32_t offset =
+      static_cast<int32_t>(state.last_start - g_tx_dispatch_total);
+  const int32_t queued =
+      static_cast<int32_t>(g_tx_write_total - g_tx_dispatch_total);
+  const bool replaceable = offset >= 0 && offset + len <= queued;
+  if (replaceable) {
+    int idx = (g_tx_read_idx + static_cast<int>(offset)) %
+              HAL_DMA_PRINTF_BUFFER_SIZE;
+    for (int i = 0; i < len; ++i) {
+      g_tx_buffer[idx] = static_cast<uint8_t>(ptr[i]);
+      idx = (idx + 1) % HAL_DMA_PRINTF_BUFFER_SIZE;
+    }
+    ++g_stats.coalesced_updates;
+  }
+  __set_PRIMASK(primask);
+  return replaceable;
+}
+#endif
+
+/**
+ * @brief Queue one binary frame, whatever the current encoding
+ * @param type Frame type (kFrameType*)
+ * @param segments Payload pieces, concatenated in order
+ * @param count Number of payload pieces
+ * @return HAL_DMA_PRINTF_OK, or HAL_DMA_PRINTF_ERROR_NO_SPACE if the whole
+ * frame does not fit (nothing is queued in that case)
+ */
+int QueueFrame(uint8_t type,
+               const hal_dma_printf_internal::FrameSegment* segments,
+               int count) {
+  using hal_dma_printf_internal::kFrameOverhead;
+
+  int payload_size = 0;
+  for (int i = 0; i < count; ++i) { payload_size += segments[i].size; }
+  if (payload_size > UINT16_MAX ||
+      GetTxFreeBytes() < payload_size + kFrameOverhead) {
+    return HAL_DMA_PRINTF_ERROR_NO_SPACE;
+  }
+
+  const uint8_t header[] = {hal_dma_printf_internal::kFrameSync, type,
+                            static_cast<uint8_t>(payload_size & 0xFF),
+                            static_cast<uint8_t>(payload_size >> 8)};
+  uint8_t sum = header[1] + header[2] + header[3];
+  CopyToTxBuffer(header, sizeof(header));
+  for (int i = 0; i < count; ++i) {
+    const uint8_t* data = static_cast<const uint8_t*>(segments[i].data);
+    for (int j = 0; j < segments[i].size; ++j) { sum += data[j]; }
+    CopyToTxBuffer(data, segments[i].size);
+  }
+  const uint8_t checksum = static_cast<uint8_t>(-sum);
+  CopyToTxBuffer(&checksum, 1);
+
+  KickDmaTransmit();
+  return HAL_DMA_PRINTF_OK;
+}
+
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+/**
+ * @brief Result of feeding one byte to a HelloParser
+ */
+enum class HelloMatch {
+  kNone,     // Ordinary input
+  kPartial,  // Part of what may be a hello
+  kComplete  // Last byte of a valid hello
+};
+
+/**
+ * @brief Feed one received byte to a hello parser
+ * @param parser Parser state
+ * @param byte Received byte
+ * @return Whether the byte belongs to a hello
+ */
+HelloMatch FeedHello(HelloParser& parser, uint8_t byte) {
+  using hal_dma_printf_internal::kFrameSync;
+  using hal_dma_printf_internal::kFrameTypeEncoding;
+
+  // Sync, type and a payload length of 1
+  static constexpr uint8_t kHeader[] = {kFrameSync, kFrameTypeEncoding, 1, 0};
+  if (parser.pos < static_cast<int>(sizeof(kHeader))) {
+    if (byte == kHeader[parser.pos]) {
+      ++parser.pos;
+      return HelloMatch::kPartial;
+    }
+    // A NUL may start the next frame (gating heartbeats are single NULs)
+    parser.pos = (byte == kFrameSync) ? 1 : 0;
+    return (parser.pos != 0) ? HelloMatch::kPartial : HelloMatch::kNone;
+  }
+  if (parser.pos == sizeof(kHeader)) {
+    parser.flags = byte;
+    ++parser.pos;
+    return HelloMatch::kPartial;
+  }
+
+  parser.pos = 0;
+  const uint8_t sum = kFrameTypeEncoding + 1 + parser.flags + byte;
+  return (sum == 0) ? HelloMatch::kComplete : HelloMatch::kNone;
+}
+
+/**
+ * @brief Follow host hellos received since the last call
+ * @details Scans RX buffer behind the DMA without consuming it; _read drops
+ * the hellos on its own. Every hello is answered with a reply frame holding
+ * the encodings granted, and a new choice takes effect only once that reply
+ * is queued, so the host switches decoding at the same point in the stream.
+ * Does nothing in interrupts, so the encoding never changes between an
+ * interrupted write's space check and its copy.
+ */
+void UpdateEncoding() {
+  using hal_dma_printf_internal::FrameSegment;
+
+  if (__get_IPSR() != 0) { return; }
+
+  const uint32_t now = HAL_GetTick();
+  const int dma_write_idx =
+      HAL_DMA_PRINTF_BUFFER_SIZE - g_huart->hdmarx->Instance->NDTR;
+  while (g_hello_scan_idx != dma_write_idx) {
+    const uint8_t byte = g_rx_buffer[g_hello_scan_idx];
+    g_hello_scan_idx = (g_hello_scan_idx + 1) % HAL_DMA_PRINTF_BUFFER_SIZE;
+    if (FeedHello(g_hello_scan, byte) == HelloMatch::kComplete) {
+      g_pending_encoding = g_hello_scan.flags & kSupportedEncoding;
+      g_last_hello_tick = now;
+    }
+  }
+
+  uint8_t encoding = g_encoding;
+  if (g_pending_encoding >= 0) {
+    const uint8_t granted = static_cast<uint8_t>(g_pending_encoding);
+    const FrameSegment segment = {&granted, 1};
+    if (QueueFrame(hal_dma_printf_internal::kFrameTypeEncoding, &segment, 1) ==
+        HAL_DMA_PRINTF_OK) {
+      encoding = granted;
+      g_pending_encoding = -1;
+    }
+  } else if (now - g_last_hello_tick >=
+             HAL_DMA_PRINTF_NEGOTIATION_TIMEOUT_MS) {
+    // The host is gone; whoever looks next may be a plain terminal
+    encoding = HAL_DMA_PRINTF_ENCODING_TEXT;
+  }
+
+  if (encoding == g_encoding) { return; }
+  g_encoding = encoding;
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+  // A queued value in the old encoding cannot be replaced by one in the new
+  for (FdState& state : g_fd_states) { state.last_size = 0; }
+#endif
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_RX_POOL
+/**
+ * @brief Start RX DMA into a free pool block
+ * @details Runs in the RX interrupt or with interrupts disabled. Leaves
+ * reception stopped while every block is queued or held.
+ */
+void StartRxBlock() {
+  if (g_rx_free_blocks == 0) {
+    g_rx_dma_block = -1;
+    ++g_stats.rx_pool_stalls;
+    return;
+  }
+
+  const int block = __builtin_ctz(g_rx_free_blocks);
+  if (HAL_UARTEx_ReceiveToIdle_DMA(g_huart, g_rx_blocks[block],
+                                   HAL_DMA_PRINTF_RX_BLOCK_SIZE) != HAL_OK) {
+    g_rx_dma_block = -1;
+    return;
+  }
+  g_rx_free_blocks &= ~(1U << block);
+  g_rx_dma_block = block;
+}
+
+/**
+ * @brief RX event callback: the block is full or the line went idle
+ * @param huart UART handle
+ * @param size Bytes received into the block
+ * @details Half-transfer events come while reception goes on (RxState
+ * still busy) and are ignored. The block is queued for
+ * HalDmaPrintfRxAcquire and reception restarts in the next free block at
+ * once, within the one character the UART data register holds.
+ */
+void OnRxBlockEvent(UART_HandleTypeDef* huart, uint16_t size) {
+  if (huart->RxState != HAL_UART_STATE_READY || g_rx_dma_block < 0) {
+    return;
+  }
+
+  const int block = g_rx_dma_block;
+  if (size == 0) {
+    g_rx_free_blocks |= 1U << block;
+  } else {
+    g_rx_block_sizes[block] = size;
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+    g_rx_block_times[block] = hal_dma_printf_internal::GetLatencyTime();
+#endif
+    g_rx_ready[(g_rx_ready_head + g_rx_ready_count) %
+               HAL_DMA_PRINTF_RX_BLOCK_COUNT] = static_cast<uint8_t>(block);
+    ++g_rx_ready_count;
+    g_rx_pool_received += size;
+  }
+  StartRxBlock();
+}
+#endif
+
+/**
+ * @brief Initialize UART handler and DMA for printf/scanf
+ * @param huart Pointer to UART handle
+ * @return Error code
+ */
+int SetupUartHandler(UART_HandleTypeDef* huart) {
+#if (USE_HAL_UART_REGISTER_CALLBACKS == 0)
+  const uint8_t error_msg[] =
+      "[HalDmaPrintf] Error: USE_HAL_UART_REGISTER_CALLBACKS is disabled.\r\n"
+      "Enable it in stm32f4xx_hal_conf.h\r\n";
+  HAL_UART_Transmit(huart, error_msg, sizeof(error_msg) - 1, 100);
+  return HAL_DMA_PRINTF_ERROR_NO_CALLBACK;
+#endif
+
+  if (huart == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+
+  if (huart->hdmatx == nullptr) {
+    const uint8_t error_msg[] =
+        "[HalDmaPrintf] Error: TX DMA not initialized for UART.\r\n"
+        "Configure TX DMA in CubeMX.\r\n";
+    HAL_UART_Transmit(huart, error_msg, sizeof(error_msg) - 1, 100);
+    return HAL_DMA_PRINTF_ERROR_NO_DMA_TX;
+  }
+
+  if (huart->hdmarx == nullptr) {
+    const uint8_t error_msg[] =
+        "[HalDmaPrintf] Error: RX DMA not initialized for UART.\r\n"
+        "Configure RX DMA in CubeMX.\r\n";
+    HAL_UART_Transmit(huart, error_msg, sizeof(error_msg) - 1, 100);
+    return HAL_DMA_PRINTF_ERROR_NO_DMA_RX;
+  }
+
+#if HAL_DMA_PRINTF_ENABLE_RX_POOL
+  if (huart->hdmarx->Init.Mode != DMA_NORMAL) {
+    const uint8_t error_msg[] =
+        "[HalDmaPrintf] Error: RX DMA must be in Normal mode for the RX "
+        "block pool.\r\n"
+        "Set the RX DMA mode to Normal in CubeMX.\r\n";
+    HAL_UART_Transmit(huart, error_msg, sizeof(error_msg) - 1, 100);
+    return HAL_DMA_PRINTF_ERROR_DMA_MODE;
+  }
+#endif
+
+  // Initialize global state. On the first setup TX buffer is kept: it holds
+  // whatever was printed before setup and is sent below.
+  if (g_huart != nullptr) {
+    g_tx_read_idx = 0;
+    g_tx_write_idx = 0;
+    g_tx_dma_size = 0;
+    g_tx_write_total = 0;
+    g_tx_dispatch_total = 0;
+#if HAL_DMA_PRINTF_ENABLE_STATUS
+    for (StatusSlot& slot : g_status_slots) { slot = {}; }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+    for (FdState& state : g_fd_states) { state.last_size = 0; }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED
+    g_tx_inflight = {};
+    g_tx_next = {};
+#endif
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+    for (ClassQueue& queue : g_class_queues) { queue = {}; }
+    for (TxClass& tx_class : g_classes) { tx_class.deficit = 0; }
+    g_class_continue = -1;
+    g_class_dma = nullptr;
+#endif
+  }
+  g_huart = huart;
+#if HAL_DMA_PRINTF_ENABLE_RX_POOL
+  g_rx_free_blocks = kRxAllBlocks;
+  g_rx_held_blocks = 0;
+  g_rx_dma_block = -1;
+  g_rx_ready_head = 0;
+  g_rx_ready_count = 0;
+  g_rx_read_block = nullptr;
+#else
+  g_rx_read_idx = 0;
+#endif
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+  g_latency_tx_idx = -1;
+#endif
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+  // Plain text until a host asks for more
+  g_encoding = HAL_DMA_PRINTF_ENCODING_TEXT;
+  g_pending_encoding = -1;
+  g_hello_scan_idx = 0;
+  g_hello_scan = {};
+  g_hello_read = {};
+#endif
+#if HAL_DMA_PRINTF_ENABLE_STRIPING
+  g_stripe_links[0] = {};
+  g_stripe_links[0].huart = huart;
+  g_stripe_links[1] = {};
+  g_stripe_sequence = 0;
+#endif
+
+  // Register callbacks
+  g_huart->TxCpltCallback = OnDmaTransmitComplete;
+  g_huart->AbortTransmitCpltCallback = OnDmaTransmitComplete;
+
+#if HAL_DMA_PRINTF_ENABLE_RX_POOL
+  // Continuous reception, one pool block at a time
+  HAL_UART_RegisterRxEventCallback(g_huart, OnRxBlockEvent);
+  StartRxBlock();
+#else
+  // Start continuous DMA reception
+  HAL_UART_Receive_DMA(g_huart, g_rx_buffer, HAL_DMA_PRINTF_BUFFER_SIZE);
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_LL_TX
+  SetupLowLevelTransmit();
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED && defined(DWT_CTRL_CYCCNTENA_Msk)
+  // Cycle counts of both completion halves
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+  // Flush output captured before setup
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED
+  KickDmaTransmit();
+#else
+  if (IsTxDataQueued()) { StartDmaTransmit(); }
+#endif
+
+  return HAL_DMA_PRINTF_OK;
+}
+
+}  // anonymous namespace
+
+// ============================================================================
+// Public C API Implementation
+// ============================================================================
+
+extern "C" int HalDmaPrintfSetup(UART_HandleTypeDef* huart, bool enable_echo) {
+  const int result = SetupUartHandler(huart);
+  if (result == HAL_DMA_PRINTF_OK) {
+    // Disable buffering for immediate output
+    setvbuf(stdin, NULL, _IONBF, 0);
+    setvbuf(stdout, NULL, _IONBF, 0);
+    g_enable_echo = enable_echo;
+  }
+  return result;
+}
+
+#if HAL_DMA_PRINTF_ENABLE_STRIPING
+extern "C" int HalDmaPrintfSetupBonded(UART_HandleTypeDef* huart,
+                                       UART_HandleTypeDef* huart_secondary,
+                                       bool enable_echo) {
+  if (huart_secondary == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  if (huart_secondary->hdmatx == nullptr) {
+    return HAL_DMA_PRINTF_ERROR_NO_DMA_TX;
+  }
+
+  const int result = HalDmaPrintfSetup(huart, enable_echo);
+  if (result != HAL_DMA_PRINTF_OK) { return result; }
+
+  huart_secondary->TxCpltCallback = OnDmaTransmitComplete;
+  huart_secondary->AbortTransmitCpltCallback = OnDmaTransmitComplete;
+
+  // Output queued before bonding is still in flight on the primary
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_stripe_links[0].busy = (huart->gState != HAL_UART_STATE_READY);
+  g_stripe_links[1].huart = huart_secondary;
+  __set_PRIMASK(primask);
+  return HAL_DMA_PRINTF_OK;
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_LL_TX
+extern "C" void HalDmaPrintfTxDmaIrqHandler(void) {
+  if (g_huart == nullptr) { return; }
+
+  auto* dma =
+      reinterpret_cast<DmaBaseRegisters*>(g_huart->hdmatx->StreamBaseAddress);
+  const uint32_t shift = g_huart->hdmatx->StreamIndex;
+  const uint32_t flags = dma->ISR & (kDmaAllFlags << shift);
+  if (flags == 0) { return; }
+  dma->IFCR = flags;
+
+  // A transfer error also ends the transfer; its bytes are lost and
+  // transmission continues with the next data
+  if ((flags & ((DMA_FLAG_TCIF0_4 | DMA_FLAG_TEIF0_4) << shift)) != 0) {
+    if ((flags & (DMA_FLAG_TEIF0_4 << shift)) != 0) {
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED
+      g_stats.lost_bytes += g_tx_inflight.size;
+#else
+      g_stats.lost_bytes += g_tx_dma_size;
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+      if (g_class_dma != nullptr) {
+        g_stats.lost_bytes += g_class_dma->dma_size;
+      }
+#endif
+#endif
+    }
+    OnDmaTransmitComplete(g_huart);
+  }
+}
+#endif
+
+extern "C" void HalDmaPrintfEnableEcho(void) { g_enable_echo = true; }
+
+extern "C" void HalDmaPrintfDisableEcho(void) { g_enable_echo = false; }
+
+extern "C" size_t HalDmaPrintfGetBufferSize(void) {
+  return HAL_DMA_PRINTF_BUFFER_SIZE;
+}
+
+extern "C" int HalDmaPrintfLog(HalDmaPrintfSeverity severity,
+                               const char* format, ...) {
+  if (severity < HAL_DMA_PRINTF_SEVERITY_DEBUG ||
+      severity >= HAL_DMA_PRINTF_SEVERITY_COUNT) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+
+  // Skip formatting entirely while nobody is listening
+  if (g_huart != nullptr && !IsListenerConnected()) { return 0; }
+
+  // stdout is unbuffered, so the message reaches _write while the severity
+  // is still set
+  const HalDmaPrintfSeverity previous = g_severity;
+  g_severity = severity;
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+  g_log_active = true;
+#endif
+  va_list args;
+  va_start(args, format);
+  const int result = vprintf(format, args);
+  va_end(args);
+  g_severity = previous;
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+  g_log_active = false;
+#endif
+  return result;
+}
+
+#if HAL_DMA_PRINTF_ENABLE_GATING
+extern "C" int HalDmaPrintfSetGating(HalDmaPrintfGatingMode mode,
+                                     uint32_t timeout_ms,
+                                     bool (*is_connected)(void)) {
+  if (g_huart == nullptr) { return HAL_DMA_PRINTF_ERROR_NOT_READY; }
+  if (mode == HAL_DMA_PRINTF_GATING_CALLBACK && is_connected == nullptr) {
+    return HAL_DMA_PRINTF_ERROR_NULL_PTR;
+  }
+  if (mode == HAL_DMA_PRINTF_GATING_RX_ACTIVITY && timeout_ms == 0) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+
+  g_listener_callback = is_connected;
+  g_gating_timeout_ms = timeout_ms;
+  // Start out disconnected until the host shows a sign of life
+  g_last_rx_activity = GetRxActivity();
+  g_last_rx_tick = HAL_GetTick() - timeout_ms;
+  g_gating_mode = mode;
+  return HAL_DMA_PRINTF_OK;
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_STATUS
+extern "C" int HalDmaPrintfStatusUpdate(uint8_t key, const void* value,
+                                        uint16_t size) {
+  using hal_dma_printf_internal::FrameSegment;
+  using hal_dma_printf_internal::kFrameTypeStatus;
+
+  if (g_huart == nullptr) { return HAL_DMA_PRINTF_ERROR_NOT_READY; }
+  if (value == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  if (key >= HAL_DMA_PRINTF_STATUS_MAX_KEYS || size == 0 ||
+      size > UINT16_MAX - 1) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+  if (!IsListenerConnected()) { return HAL_DMA_PRINTF_OK; }
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+  UpdateEncoding();
+#endif
+  if (!IsEncodingActive(HAL_DMA_PRINTF_ENCODING_FRAMES)) {
+    return HAL_DMA_PRINTF_OK;
+  }
+
+  StatusSlot& slot = g_status_slots[key];
+  const uint8_t* bytes = static_cast<const uint8_t*>(value);
+
+  // The DMA takes bytes from the queue head in the completion interrupt, so
+  // check and overwrite with interrupts disabled
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  // Frame layout: sync, type, length (2), key, value, checksum
+  // A frame whose start was already handed to the DMA has a negative
+  // offset, even when its tail is still queued past the ring end
+  const int payload_size = size + 1;
+  const int32_t offset = static_cast<int32_t>(slot.start - g_tx_dispatch_total);
+  const int32_t queued =
+      static_cast<int32_t>(g_tx_write_total - g_tx_dispatch_total);
+  if (slot.size == size && offset >= 0 &&
+      offset + payload_size + hal_dma_printf_internal::kFrameOverhead <=
+          queued) {
+    uint8_t sum = kFrameTypeStatus + static_cast<uint8_t>(payload_size) +
+                  static_cast<uint8_t>(payload_size >> 8) + key;
+    int idx = (g_tx_read_idx + static_cast<int>(offset) + 5) %
+              HAL_DMA_PRINTF_BUFFER_SIZE;
+    for (int i = 0; i < size; ++i) {
+      g_tx_buffer[idx] = bytes[i];
+      sum += bytes[i];
+      idx = (idx + 1) % HAL_DMA_PRINTF_BUFFER_SIZE;
+    }
+    g_tx_buffer[idx] = static_cast<uint8_t>(-sum);
+    ++g_stats.coalesced_updates;
+    __set_PRIMASK(primask);
+    return HAL_DMA_PRINTF_OK;
+  }
+  __set_PRIMASK(primask);
+
+  const FrameSegment segments[] = {{&key, 1}, {value, size}};
+  const uint32_t start = g_tx_write_total;
+  const int result =
+      hal_dma_printf_internal::WriteFrame(kFrameTypeStatus, segments, 2);
+  if (result == HAL_DMA_PRINTF_OK) { slot = {start, size}; }
+  return result;
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_BENCHMARK
+namespace {
+
+// Frames sent by the benchmark; host tools skip this frame type
+constexpr int kBenchmarkPayloadSize = 64;
+constexpr uint32_t kBenchmarkTimeoutMs = 10000;
+
+/**
+ * @brief Wait until every queued byte has been sent
+ * @param start_tick HAL_GetTick() at the start of the benchmark
+ * @return true if TX drained before the timeout
+ */
+bool WaitForTxIdle(uint32_t start_tick) {
+  while (g_tx_dma_size != 0 || g_tx_read_idx != g_tx_write_idx) {
+    if (HAL_GetTick() - start_tick > kBenchmarkTimeoutMs) { return false; }
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+extern "C" int HalDmaPrintfRunBenchmark(uint32_t bytes,
+                                        HalDmaPrintfBenchmark* result) {
+  using hal_dma_printf_internal::FrameSegment;
+  using hal_dma_printf_internal::kFrameOverhead;
+
+  if (result == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  if (g_huart == nullptr) { return HAL_DMA_PRINTF_ERROR_NOT_READY; }
+  if (bytes == 0) { return HAL_DMA_PRINTF_ERROR_INVALID_ARG; }
+
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+  const uint32_t start_tick = HAL_GetTick();
+  if (!WaitForTxIdle(start_tick)) { return HAL_DMA_PRINTF_ERROR_TIMEOUT; }
+
+  uint8_t payload[kBenchmarkPayloadSize];
+  for (int i = 0; i < kBenchmarkPayloadSize; ++i) {
+    payload[i] = static_cast<uint8_t>(i);
+  }
+  const FrameSegment segment = {payload, sizeof(payload)};
+
+  g_benchmark = {};
+  g_benchmark.active = true;
+  uint32_t sent = 0;
+  uint32_t enqueue_cycles = 0;
+  uint32_t enqueue_count = 0;
+  const uint32_t start_cycles = GetCycleCount();
+  bool timed_out = false;
+
+  // Keep TX buffer topped up so the link never waits for the producer
+  while (sent < bytes) {
+    if (HAL_GetTick() - start_tick > kBenchmarkTimeoutMs) {
+      timed_out = true;
+      break;
+    }
+    if (GetTxFreeBytes() < kBenchmarkPayloadSize + kFrameOverhead) {
+      continue;
+    }
+    const uint32_t before = GetCycleCount();
+    QueueFrame(hal_dma_printf_internal::kFrameTypePadding, &segment, 1);
+    enqueue_cycles += GetCycleCount() - before;
+    ++enqueue_count;
+    sent += kBenchmarkPayloadSize + kFrameOverhead;
+  }
+  timed_out = timed_out || !WaitForTxIdle(start_tick);
+  const uint32_t elapsed_cycles = GetCycleCount() - start_cycles;
+  g_benchmark.active = false;
+
+  *result = {};
+  result->bytes = sent;
+  result->transfers = g_benchmark.isr_count;
+  if (elapsed_cycles != 0) {
+    result->bytes_per_second = static_cast<uint32_t>(
+        static_cast<uint64_t>(sent) * SystemCoreClock / elapsed_cycles);
+  }
+  if (enqueue_count != 0) {
+    result->enqueue_cycles = enqueue_cycles / enqueue_count;
+  }
+  if (g_benchmark.isr_count != 0) {
+    result->isr_cycles = g_benchmark.isr_cycles / g_benchmark.isr_count;
+  }
+  if (g_benchmark.restart_count != 0) {
+    result->restart_cycles =
+        g_benchmark.restart_cycles / g_benchmark.restart_count;
+  }
+  return timed_out ? HAL_DMA_PRINTF_ERROR_TIMEOUT : HAL_DMA_PRINTF_OK;
+}
+
+namespace {
+
+constexpr uint16_t kCopyBenchmarkSizes[HAL_DMA_PRINTF_COPY_BENCHMARK_SIZES] = {
+    4, 8, 16, 24, 32, 48, 64, 128};
+constexpr int kCopyBenchmarkMaxSize = 128;
+
+/**
+ * @brief Copy routine under test
+ */
+typedef void (*CopyFunction)(uint8_t* dst, const uint8_t* src, int len);
+
+/**
+ * @brief Library memcpy with the CopyFunction signature
+ */
+void CopyWithMemcpy(uint8_t* dst, const uint8_t* src, int len) {
+  memcpy(dst, src, len);
+}
+
+/**
+ * @brief Average cycles of one copy over all 16 alignment combinations
+ * @param copy Routine to measure (called through a volatile pointer so the
+ * compiler cannot specialise it for the size)
+ * @param len Bytes per copy
+ * @return Cycles per copy
+ */
+uint32_t MeasureCopy(CopyFunction volatile copy, int len) {
+  alignas(4) static uint8_t source[kCopyBenchmarkMaxSize + 4];
+  alignas(4) static uint8_t target[kCopyBenchmarkMaxSize + 4];
+  for (int i = 0; i < kCopyBenchmarkMaxSize + 4; ++i) {
+    source[i] = static_cast<uint8_t>(i);
+  }
+
+  // Cost of reading the cycle counter itself
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint32_t empty_start = GetCycleCount();
+  const uint32_t overhead = GetCycleCount() - empty_start;
+  __set_PRIMASK(primask);
+
+  uint32_t total = 0;
+  for (int src_offset = 0; src_offset < 4; ++src_offset) {
+    for (int dst_offset = 0; dst_offset < 4; ++dst_offset) {
+      primask = __get_PRIMASK();
+      __disable_irq();
+      const uint32_t start = GetCycleCount();
+      copy(&target[dst_offset], &source[src_offset], len);
+      const uint32_t cycles = GetCycleCount() - start;
+      __set_PRIMASK(primask);
+      total += (cycles > overhead) ? cycles - overhead : 0;
+    }
+  }
+  return total / 16;
+}
+
+}  // anonymous namespace
+
+extern "C" int HalDmaPrintfRunCopyBenchmark(
+    HalDmaPrintfCopyBenchmark* result) {
+  if (result == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+  for (int i = 0; i < HAL_DMA_PRINTF_COPY_BENCHMARK_SIZES; ++i) {
+    const int len = kCopyBenchmarkSizes[i];
+    result->size[i] = len;
+    result->memcpy_cycles[i] = MeasureCopy(CopyWithMemcpy, len);
+    result->ring_copy_cycles[i] = MeasureCopy(CopyToRing, len);
+  }
+  return HAL_DMA_PRINTF_OK;
+}
+#endif
+
+extern "C" bool HalDmaPrintfIsListenerConnected(void) {
+  return g_huart != nullptr && IsListenerConnected();
+}
 
-// Default buffer size (can be overridden by compiler flag)
-#ifndef HAL_DMA_PRINTF_BUFFER_SIZE
-#define HAL_DMA_PRINTF_BUFFER_SIZE 1024
+#if HAL_DMA_PRINTF_ENABLE_RX_POOL
+extern "C" uint8_t* HalDmaPrintfRxAcquire(size_t* size) {
+  if (size == nullptr) { return nullptr; }
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (g_rx_ready_count == 0) {
+    __set_PRIMASK(primask);
+    return nullptr;
+  }
+  const int block = g_rx_ready[g_rx_ready_head];
+  g_rx_ready_head = (g_rx_ready_head + 1) % HAL_DMA_PRINTF_RX_BLOCK_COUNT;
+  --g_rx_ready_count;
+  g_rx_held_blocks |= 1U << block;
+  __set_PRIMASK(primask);
+
+  *size = g_rx_block_sizes[block];
+  return g_rx_blocks[block];
+}
+
+extern "C" int HalDmaPrintfRxRelease(uint8_t* data) {
+  if (data == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+
+  const uintptr_t offset = reinterpret_cast<uintptr_t>(data) -
+                           reinterpret_cast<uintptr_t>(g_rx_blocks);
+  const uintptr_t block = offset / HAL_DMA_PRINTF_RX_BLOCK_SIZE;
+  if (offset % HAL_DMA_PRINTF_RX_BLOCK_SIZE != 0 ||
+      block >= HAL_DMA_PRINTF_RX_BLOCK_COUNT) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+
+  const uint32_t bit = 1U << block;
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if ((g_rx_held_blocks & bit) == 0) {
+    __set_PRIMASK(primask);
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+  g_rx_held_blocks &= ~bit;
+  g_rx_free_blocks |= bit;
+  // Reception stopped for lack of a block resumes here
+  if (g_rx_dma_block < 0 && g_huart != nullptr) { StartRxBlock(); }
+  __set_PRIMASK(primask);
+  return HAL_DMA_PRINTF_OK;
+}
 #endif
 
-namespace {
+extern "C" uint8_t HalDmaPrintfGetEncoding(void) {
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+  if (g_huart != nullptr) { UpdateEncoding(); }
+  return g_encoding;
+#else
+  return kSupportedEncoding;
+#endif
+}
 
-// Internal state (anonymous namespace for encapsulation)
-UART_HandleTypeDef* g_huart = nullptr;
-uint8_t g_tx_buffer[HAL_DMA_PRINTF_BUFFER_SIZE];
-uint8_t g_rx_buffer[HAL_DMA_PRINTF_BUFFER_SIZE];
-volatile int g_tx_read_idx = 0;
-volatile int g_tx_write_idx = 0;
-volatile int g_rx_read_idx = 0;
-bool g_enable_echo = false;
+#if HAL_DMA_PRINTF_ENABLE_SPILL
+extern "C" int HalDmaPrintfSetSpillDevice(
+    const HalDmaPrintfSpillDevice* device) {
+  if (device != nullptr &&
+      (device->write_block == nullptr || device->read_block == nullptr)) {
+    return HAL_DMA_PRINTF_ERROR_NULL_PTR;
+  }
+  if (device != nullptr && device->block_count == 0) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
 
-/**
- * @brief Calculate available data in TX buffer
- * @return Number of bytes available to transmit
- */
-inline int GetTxAvailableBytes() {
-  if (g_tx_write_idx >= g_tx_read_idx) {
-    return g_tx_write_idx - g_tx_read_idx;
+  g_spill_device = (device != nullptr) ? *device : HalDmaPrintfSpillDevice{};
+  g_spill_block_fill = 0;
+  g_spill_head = 0;
+  g_spill_count = 0;
+  return HAL_DMA_PRINTF_OK;
+}
+
+extern "C" void HalDmaPrintfSpillPoll(void) {
+  if (g_huart == nullptr || !IsSpillPending()) { return; }
+  if (IsListenerConnected()) { DrainSpill(); }
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+extern "C" int HalDmaPrintfSetFdPolicy(int file,
+                                       const HalDmaPrintfFdPolicy* policy) {
+  if (policy == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  if (file < 0 || file >= HAL_DMA_PRINTF_MAX_FDS ||
+      policy->priority < HAL_DMA_PRINTF_SEVERITY_DEBUG ||
+      policy->priority >= HAL_DMA_PRINTF_SEVERITY_COUNT) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
   }
-  return HAL_DMA_PRINTF_BUFFER_SIZE - g_tx_read_idx + g_tx_write_idx;
+#if !HAL_DMA_PRINTF_ENABLE_EVICTION
+  // Queued messages are only tracked with eviction enabled
+  if (policy->overflow == HAL_DMA_PRINTF_OVERFLOW_DROP_OLDEST) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+#endif
+
+  FdState& state = GetFdState(file);
+  state.policy = *policy;
+  state.last_size = 0;
+  return HAL_DMA_PRINTF_OK;
 }
 
-/**
- * @brief Start DMA transmission for pending data
- * @details Handles ring buffer wraparound by transmitting in two parts if
- * needed
- */
-void StartDmaTransmit() {
-  if (g_tx_write_idx < g_tx_read_idx) {
-    // Wraparound case: transmit from read position to end of buffer
-    const int first_part_size = HAL_DMA_PRINTF_BUFFER_SIZE - g_tx_read_idx;
-    HAL_UART_Transmit_DMA(g_huart, &g_tx_buffer[g_tx_read_idx],
-                          first_part_size);
-    g_tx_read_idx = 0;
+extern "C" void HalDmaPrintfFlush(void) {
+  if (g_huart != nullptr && GetTxAvailableBytes() > 0) { KickDmaTransmit(); }
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+extern "C" int HalDmaPrintfSetClassConfig(
+    int class_id, const HalDmaPrintfClassConfig* config) {
+  if (config == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  if (class_id < 0 || class_id >= HAL_DMA_PRINTF_CLASS_COUNT ||
+      config->weight == 0) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+
+  // The scheduler reads the configuration in the completion interrupt
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_classes[class_id].config = *config;
+  __set_PRIMASK(primask);
+  return HAL_DMA_PRINTF_OK;
+}
+
+extern "C" int HalDmaPrintfSetFdClass(int file, int class_id) {
+  if (file < 0 || file >= HAL_DMA_PRINTF_MAX_FDS || class_id < 0 ||
+      class_id >= HAL_DMA_PRINTF_CLASS_COUNT) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+  g_fd_classes[file] = static_cast<uint8_t>(class_id);
+  return HAL_DMA_PRINTF_OK;
+}
+
+extern "C" int HalDmaPrintfGetClassStats(int class_id,
+                                         HalDmaPrintfClassStats* stats) {
+  if (stats == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  if (class_id < 0 || class_id >= HAL_DMA_PRINTF_CLASS_COUNT) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = g_classes[class_id].stats;
+  stats->queued_bytes = static_cast<uint32_t>(GetClassQueuedBytes(class_id));
+  __set_PRIMASK(primask);
+  return HAL_DMA_PRINTF_OK;
+}
+#endif
+
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED
+extern "C" void HalDmaPrintfRunDeferred(void) {
+  if (g_huart == nullptr) { return; }
+
+  const uint32_t start_cycles = GetCycleCount();
+  PrepareNextChunk();
+  RecordCycles(GetCycleCount() - start_cycles,
+               g_deferred_stats.deferred_count,
+               g_deferred_stats.deferred_cycles_total,
+               g_deferred_stats.deferred_cycles_max);
+}
+
+extern "C" void HalDmaPrintfSetDeferredTrigger(void (*trigger)(void)) {
+  g_deferred_trigger = trigger;
+}
+
+extern "C" void HalDmaPrintfGetDeferredStats(
+    HalDmaPrintfDeferredStats* stats) {
+  if (stats != nullptr) { *stats = g_deferred_stats; }
+}
+#endif
+
+extern "C" void HalDmaPrintfGetStats(HalDmaPrintfStats* stats) {
+  if (stats != nullptr) { *stats = g_stats; }
+}
+
+extern "C" void HalDmaPrintfResetStats(void) {
+  g_stats = {};
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+  for (TxClass& tx_class : g_classes) { tx_class.stats = {}; }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_DEFERRED
+  g_deferred_stats = {};
+#endif
+}
+
+// ============================================================================
+// Internal API for optional modules
+// ============================================================================
+
+namespace hal_dma_printf_internal {
+
+bool IsInitialized() { return g_huart != nullptr; }
+
+int GetTxFreeBytes() { return ::GetTxFreeBytes(); }
+
+int WriteText(const char* data, int len) {
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+  if (g_huart != nullptr) { UpdateEncoding(); }
+#endif
+  const int free_bytes = ::GetTxFreeBytes();
+  int written = (len < free_bytes) ? len : free_bytes;
+#if HAL_DMA_PRINTF_ENABLE_DICTIONARY
+  if (IsEncodingActive(HAL_DMA_PRINTF_ENCODING_DICTIONARY)) {
+    written = WriteDictionaryEscaped(data, len, free_bytes);
   } else {
-    // Normal case: transmit from read to write position
-    const int transmit_size = g_tx_write_idx - g_tx_read_idx;
-    HAL_UART_Transmit_DMA(g_huart, &g_tx_buffer[g_tx_read_idx], transmit_size);
-    g_tx_read_idx = g_tx_write_idx;
+    CopyToTxBuffer(reinterpret_cast<const uint8_t*>(data), written);
   }
+#else
+  CopyToTxBuffer(reinterpret_cast<const uint8_t*>(data), written);
+#endif
+
+  if (written > 0) { KickDmaTransmit(); }
+  return written;
 }
 
-/**
- * @brief DMA transmit complete callback
- * @param huart UART handle (unused in this implementation)
- */
-void OnDmaTransmitComplete([[maybe_unused]] UART_HandleTypeDef* huart) {
-  // If there's more data to send, start next transmission
-  if (g_tx_read_idx != g_tx_write_idx) { StartDmaTransmit(); }
+int WriteFrame(uint8_t type, const FrameSegment* segments, int count) {
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+  if (g_huart != nullptr) { UpdateEncoding(); }
+#endif
+  // Discarded like output without a listener; a plain terminal is attached
+  if (!IsEncodingActive(HAL_DMA_PRINTF_ENCODING_FRAMES)) {
+    return HAL_DMA_PRINTF_OK;
+  }
+  return QueueFrame(type, segments, count);
 }
 
+}  // namespace hal_dma_printf_internal
+
+// ============================================================================
+// Syscall hooks for printf/scanf and C++ streams
+// ============================================================================
+
+namespace {
+
 /**
- * @brief Initialize UART handler and DMA for printf/scanf
- * @param huart Pointer to UART handle
- * @return Error code
+ * @brief Queue one message written through _write or _write_r
+ * @param file File descriptor (stderr is treated as ERROR severity)
+ * @param ptr Pointer to data to write (not NULL)
+ * @param len Length of data (positive)
+ * @return len if the message was queued, spilled or discarded for lack of a
+ * listener; HAL_DMA_PRINTF_ERROR_NO_SPACE if it was dropped
  */
-int SetupUartHandler(UART_HandleTypeDef* huart) {
-#if (USE_HAL_UART_REGISTER_CALLBACKS == 0)
-  const uint8_t error_msg[] =
-      "[HalDmaPrintf] Error: USE_HAL_UART_REGISTER_CALLBACKS is disabled.\r\n"
-      "Enable it in stm32f4xx_hal_conf.h\r\n";
-  HAL_UART_Transmit(huart, error_msg, sizeof(error_msg) - 1, 100);
-  return HAL_DMA_PRINTF_ERROR_NO_CALLBACK;
+int WriteMessage(int file, const char* ptr, int len) {
+#if HAL_DMA_PRINTF_ENABLE_TRACE
+  hal_dma_printf_internal::RecordWriteTrace(file, len);
 #endif
 
-  if (huart == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  const bool is_setup = (g_huart != nullptr);
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+  if (is_setup) { UpdateEncoding(); }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+  FdState& fd_state = GetFdState(file);
+  const HalDmaPrintfFdPolicy& policy = fd_state.policy;
+  const HalDmaPrintfSeverity severity =
+      g_log_active ? g_severity : policy.priority;
+#else
+  const HalDmaPrintfSeverity severity =
+      (file == STDERR_FILENO) ? HAL_DMA_PRINTF_SEVERITY_ERROR : g_severity;
+#endif
 
-  if (huart->hdmatx == nullptr) {
-    const uint8_t error_msg[] =
-        "[HalDmaPrintf] Error: TX DMA not initialized for UART.\r\n"
-        "Configure TX DMA in CubeMX.\r\n";
-    HAL_UART_Transmit(huart, error_msg, sizeof(error_msg) - 1, 100);
-    return HAL_DMA_PRINTF_ERROR_NO_DMA_TX;
+  if (is_setup && !IsListenerConnected()) {
+#if HAL_DMA_PRINTF_ENABLE_SPILL
+    // Keep output for the host that connects later
+    if (g_spill_device.write_block != nullptr && !SpillText(ptr, len)) {
+      CountDroppedMessage(severity, len);
+      return HAL_DMA_PRINTF_ERROR_NO_SPACE;
+    }
+#endif
+    return len;
   }
 
-  if (huart->hdmarx == nullptr) {
-    const uint8_t error_msg[] =
-        "[HalDmaPrintf] Error: RX DMA not initialized for UART.\r\n"
-        "Configure RX DMA in CubeMX.\r\n";
-    HAL_UART_Transmit(huart, error_msg, sizeof(error_msg) - 1, 100);
-    return HAL_DMA_PRINTF_ERROR_NO_DMA_RX;
+#if HAL_DMA_PRINTF_ENABLE_SPILL
+  // Spilled text goes out first; new output queues behind it. Device reads
+  // may block, so interrupts and critical sections leave the draining to
+  // the next write from thread context (or HalDmaPrintfSpillPoll).
+  if (is_setup && IsSpillPending() && __get_IPSR() == 0 &&
+      __get_PRIMASK() == 0) {
+    DrainSpill();
+  }
+  if (IsSpillPending()) {
+    if (!SpillText(ptr, len)) {
+      CountDroppedMessage(severity, len);
+      return HAL_DMA_PRINTF_ERROR_NO_SPACE;
+    }
+    return len;
   }
+#endif
 
-  // Initialize global state
-  g_huart = huart;
-  g_tx_read_idx = 0;
-  g_tx_write_idx = 0;
-  g_rx_read_idx = 0;
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+  const int class_id = GetFdClass(file);
+  if (class_id != 0) {
+    if (!QueueClassMessage(class_id, ptr, len)) {
+      CountDroppedMessage(severity, len);
+      g_classes[class_id].stats.dropped_bytes += len;
+      return HAL_DMA_PRINTF_ERROR_NO_SPACE;
+    }
+    if (is_setup) { KickDmaTransmit(); }
+    return len;
+  }
+#endif
 
-  // Register callbacks
-  g_huart->TxCpltCallback = OnDmaTransmitComplete;
-  g_huart->AbortTransmitCpltCallback = OnDmaTransmitComplete;
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+  if (policy.overflow == HAL_DMA_PRINTF_OVERFLOW_LAST_VALUE &&
+      ReplaceLastValue(fd_state, ptr, len)) {
+    return len;
+  }
+  const bool has_space = MakeFdTxSpace(GetMessageRequiredBytes(ptr, len),
+                                       severity, policy.overflow);
+#else
+  const bool has_space =
+      MakeTxSpace(GetMessageRequiredBytes(ptr, len), severity);
+#endif
+  if (!has_space) {
+#if HAL_DMA_PRINTF_ENABLE_SPILL
+    if (SpillText(ptr, len)) { return len; }
+#endif
+    CountDroppedMessage(severity, len);
+#if HAL_DMA_PRINTF_ENABLE_SCHEDULER
+    g_classes[0].stats.dropped_bytes += len;
+#endif
+    return HAL_DMA_PRINTF_ERROR_NO_SPACE;
+  }
 
-  // Start continuous DMA reception
-  HAL_UART_Receive_DMA(g_huart, g_rx_buffer, HAL_DMA_PRINTF_BUFFER_SIZE);
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+  if (hal_dma_printf_internal::IsResponsePending()) {
+    g_latency_tx_idx = g_tx_write_idx;
+    hal_dma_printf_internal::RecordResponseQueued();
+  }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_EVICTION
+  const uint32_t record_start = g_tx_write_total;
+#endif
+#if HAL_DMA_PRINTF_ENABLE_SEQUENCE
+  if (IsEncodingActive(HAL_DMA_PRINTF_ENCODING_FRAMES)) { WriteSequenceTag(); }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+  const uint32_t text_start = g_tx_write_total;
+#endif
 
-  return HAL_DMA_PRINTF_OK;
-}
+  QueueText(ptr, len);
 
-}  // anonymous namespace
+#if HAL_DMA_PRINTF_ENABLE_EVICTION
+  AddTxRecord(record_start, severity);
+#endif
 
-// ============================================================================
-// Public C API Implementation
-// ============================================================================
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+  if (policy.overflow == HAL_DMA_PRINTF_OVERFLOW_LAST_VALUE) {
+    fd_state.last_start = text_start;
+    fd_state.last_size = len;
+  }
 
-extern "C" int HalDmaPrintfSetup(UART_HandleTypeDef* huart, bool enable_echo) {
-  const int result = SetupUartHandler(huart);
-  if (result == HAL_DMA_PRINTF_OK) {
-    // Disable buffering for immediate output
-    setvbuf(stdin, NULL, _IONBF, 0);
-    setvbuf(stdout, NULL, _IONBF, 0);
-    g_enable_echo = enable_echo;
+  // Coalescing descriptors wait until enough is queued (or a transfer that
+  // is already running picks their data up when it completes)
+  if (policy.flush == HAL_DMA_PRINTF_FLUSH_COALESCE &&
+      GetTxAvailableBytes() < policy.coalesce_bytes) {
+    return len;
+  }
+#endif
+
+  // Trigger DMA transmission if UART is ready
+  if (is_setup) { KickDmaTransmit(); }
+
+  return len;
+}
+
+#if HAL_DMA_PRINTF_ENABLE_LOCK_STUBS
+/**
+ * @brief Queue one message with interrupts disabled
+ * @param file File descriptor
+ * @param ptr Pointer to data to write (not NULL)
+ * @param len Length of data (positive)
+ * @return As WriteMessage
+ * @details With newlib's FILE locks stubbed out, this keeps messages of
+ * different tasks and interrupts from interleaving. A BLOCK descriptor
+ * waits for space beforehand, since the DMA cannot free any while
+ * interrupts are disabled.
+ */
+int WriteMessageAtomic(int file, const char* ptr, int len) {
+#if HAL_DMA_PRINTF_ENABLE_FD_POLICY
+  const HalDmaPrintfFdPolicy& policy = GetFdState(file).policy;
+  if (policy.overflow == HAL_DMA_PRINTF_OVERFLOW_BLOCK) {
+    WaitForTxSpace(GetMessageRequiredBytes(ptr, len), policy.priority);
   }
+#endif
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const int result = WriteMessage(file, ptr, len);
+  __set_PRIMASK(primask);
   return result;
 }
+#endif
 
-extern "C" void HalDmaPrintfEnableEcho(void) { g_enable_echo = true; }
+/**
+ * @brief Queue one message, atomically if newlib's locks are stubbed out
+ * @param file File descriptor
+ * @param ptr Pointer to data to write (not NULL)
+ * @param len Length of data (positive)
+ * @return As WriteMessage
+ */
+inline int QueueWrite(int file, const char* ptr, int len) {
+#if HAL_DMA_PRINTF_ENABLE_LOCK_STUBS
+  return WriteMessageAtomic(file, ptr, len);
+#else
+  return WriteMessage(file, ptr, len);
+#endif
+}
 
-extern "C" void HalDmaPrintfDisableEcho(void) { g_enable_echo = false; }
+/**
+ * @brief Take the next received byte, if one is available
+ * @param[out] ch Received byte
+ * @return true if a byte was taken
+ */
+bool ReadRxByte(char* ch) {
+#if HAL_DMA_PRINTF_ENABLE_RX_POOL
+  if (g_rx_read_block == nullptr) {
+    g_rx_read_block = HalDmaPrintfRxAcquire(&g_rx_read_size);
+    if (g_rx_read_block == nullptr) { return false; }
+    g_rx_read_offset = 0;
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+    g_rx_read_time = g_rx_block_times[(g_rx_read_block - g_rx_blocks[0]) /
+                                      HAL_DMA_PRINTF_RX_BLOCK_SIZE];
+#endif
+  }
+  *ch = static_cast<char>(g_rx_read_block[g_rx_read_offset++]);
+  if (g_rx_read_offset == g_rx_read_size) {
+    HalDmaPrintfRxRelease(g_rx_read_block);
+    g_rx_read_block = nullptr;
+  }
+  return true;
+#else
+  // Get current DMA position
+  const int dma_write_idx =
+      HAL_DMA_PRINTF_BUFFER_SIZE - g_huart->hdmarx->Instance->NDTR;
+  if (dma_write_idx == g_rx_read_idx) { return false; }
+  *ch = static_cast<char>(g_rx_buffer[g_rx_read_idx]);
+  g_rx_read_idx = (g_rx_read_idx + 1) % HAL_DMA_PRINTF_BUFFER_SIZE;
+  return true;
+#endif
+}
 
-extern "C" size_t HalDmaPrintfGetBufferSize(void) {
-  return HAL_DMA_PRINTF_BUFFER_SIZE;
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+/**
+ * @brief Start the latency measurement of a line whose ending _read returns
+ * @details The line ending arrived before its block's RX event by the
+ * characters received after it, plus one idle frame if the line went idle.
+ */
+void RecordLineRead() {
+  const UART_InitTypeDef& init = g_huart->Init;
+  uint32_t rx_us = 0;
+  if (init.BaudRate != 0) {
+    uint32_t chars = static_cast<uint32_t>(g_rx_read_size - g_rx_read_offset);
+    if (g_rx_read_size < HAL_DMA_PRINTF_RX_BLOCK_SIZE) { ++chars; }
+    const uint32_t bits = ((init.WordLength == UART_WORDLENGTH_9B) ? 10U : 9U) +
+                          ((init.StopBits == UART_STOPBITS_2) ? 2U : 1U);
+    rx_us = static_cast<uint32_t>(static_cast<uint64_t>(chars) * bits *
+                                  1000000U / init.BaudRate);
+  }
+  g_latency_tx_idx = -1;
+  hal_dma_printf_internal::RecordCommandRead(g_rx_read_time, rx_us);
 }
+#endif
 
-// ============================================================================
-// Syscall hooks for printf/scanf and C++ streams
-// ============================================================================
+}  // anonymous namespace
 
 /**
  * @brief Write syscall hook for printf() and std::cout
- * @param file File descriptor (unused)
+ * @param file File descriptor (stderr is treated as ERROR severity)
  * @param ptr Pointer to data to write
  * @param len Length of data
  * @return Number of bytes written
+ * @details A message that does not fit into TX buffer is dropped as a whole
+ * (and counted in the statistics) rather than overwriting queued data, and
+ * still reported as written. Before HalDmaPrintfSetup, data is only queued;
+ * setup sends it.
  */
-extern "C" int _write([[maybe_unused]] int file, char* ptr, int len) {
-  if (g_huart == nullptr || ptr == nullptr || len <= 0) { return 0; }
-
-  const int space_at_end = HAL_DMA_PRINTF_BUFFER_SIZE - g_tx_write_idx;
+extern "C" int _write(int file, char* ptr, int len) {
+  if (ptr == nullptr || len <= 0) { return 0; }
+  QueueWrite(file, ptr, len);
+  return len;
+}
 
-  if (space_at_end >= len) {
-    // Enough space without wraparound
-    memcpy(&g_tx_buffer[g_tx_write_idx], ptr, len);
-    g_tx_write_idx = (g_tx_write_idx + len) % HAL_DMA_PRINTF_BUFFER_SIZE;
-  } else {
-    // Need to wrap around
-    memcpy(&g_tx_buffer[g_tx_write_idx], ptr, space_at_end);
-    const int remaining = len - space_at_end;
-    const int to_copy = (remaining > HAL_DMA_PRINTF_BUFFER_SIZE)
-                            ? HAL_DMA_PRINTF_BUFFER_SIZE
-                            : remaining;
-    memcpy(g_tx_buffer, ptr + space_at_end, to_copy);
-    g_tx_write_idx = to_copy;
+#if HAL_DMA_PRINTF_ENABLE_REENT
+/**
+ * @brief Reentrant write hook, called by newlib's stdio in place of _write
+ * @param reent Calling thread's reentrancy structure (receives errno)
+ * @param file File descriptor
+ * @param ptr Pointer to data to write
+ * @param len Length of data
+ * @return Number of bytes written, or -1 with errno set
+ * @details Replaces newlib's wrapper around _write, which clears and copies
+ * the global errno on every call. A dropped message fails with EAGAIN
+ * instead of being reported as written. Writes longer than INT_MAX are
+ * short writes: the count is returned and errno is left alone, as POSIX
+ * requires.
+ */
+extern "C" _ssize_t _write_r(struct _reent* reent, int file, const void* ptr,
+                             size_t len) {
+  if (ptr == nullptr) {
+    reent->_errno = EFAULT;
+    return -1;
   }
+  if (len == 0) { return 0; }
 
-  // Trigger DMA transmission if UART is ready
-  if (g_huart->gState == HAL_UART_STATE_READY) { StartDmaTransmit(); }
-
-  return len;
+  const int size = (len > INT_MAX) ? INT_MAX : static_cast<int>(len);
+  if (QueueWrite(file, static_cast<const char*>(ptr), size) < 0) {
+    reent->_errno = EAGAIN;
+    return -1;
+  }
+  return size;
 }
+#endif
 
 /**
  * @brief Read syscall hook for scanf() and std::cin
@@ -191,26 +3166,63 @@ extern "C" int _read([[maybe_unused]] int file, char* ptr, int len) {
   int rx_count = 0;
 
   while (rx_count < len) {
-    // Get current DMA position
-    const volatile int dma_write_idx =
-        HAL_DMA_PRINTF_BUFFER_SIZE - g_huart->hdmarx->Instance->NDTR;
-    // Check if new data is available
-    if (dma_write_idx != g_rx_read_idx) {
-      char ch = static_cast<char>(g_rx_buffer[g_rx_read_idx]);
-      g_rx_read_idx = (g_rx_read_idx + 1) % HAL_DMA_PRINTF_BUFFER_SIZE;
-
-      // Handle line endings
-      if (ch == '\n' || ch == '\r') {
-        ptr[rx_count] = '\n';
-        if (g_enable_echo) { _write(1, &ptr[rx_count], 1); }
-        return rx_count + 1;
-      }
+    // Wait for new data
+    char ch;
+    if (!ReadRxByte(&ch)) { continue; }
+
+#if HAL_DMA_PRINTF_ENABLE_GATING
+    if (ch == kHeartbeatByte) { continue; }
+#endif
+#if HAL_DMA_PRINTF_ENABLE_NEGOTIATION
+    if (FeedHello(g_hello_read, static_cast<uint8_t>(ch)) !=
+        HelloMatch::kNone) {
+      continue;
+    }
+#endif
 
-      ptr[rx_count] = ch;
+    // Handle line endings
+    if (ch == '\n' || ch == '\r') {
+      ptr[rx_count] = '\n';
       if (g_enable_echo) { _write(1, &ptr[rx_count], 1); }
-      ++rx_count;
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+      RecordLineRead();
+#endif
+      return rx_count + 1;
     }
+
+    ptr[rx_count] = ch;
+    if (g_enable_echo) { _write(1, &ptr[rx_count], 1); }
+#if HAL_DMA_PRINTF_ENABLE_LATENCY
+    hal_dma_printf_internal::RecordLineChar(ch);
+#endif
+    ++rx_count;
   }
 
   return rx_count;
-}
\ No newline at end of file
+}
+
+#if HAL_DMA_PRINTF_ENABLE_REENT
+/**
+ * @brief Reentrant read hook, called by newlib's stdio in place of _read
+ * @param reent Calling thread's reentrancy structure (receives errno)
+ * @param file File descriptor (unused)
+ * @param ptr Pointer to buffer for received data
+ * @param len Maximum number of bytes to read
+ * @return Number of bytes read, or -1 with errno set (EAGAIN before
+ * HalDmaPrintfSetup)
+ */
+extern "C" _ssize_t _read_r(struct _reent* reent, int file, void* ptr,
+                            size_t len) {
+  if (ptr == nullptr) {
+    reent->_errno = EFAULT;
+    return -1;
+  }
+  if (g_huart == nullptr) {
+    reent->_errno = EAGAIN;
+    return -1;
+  }
+
+  const int size = (len > INT_MAX) ? INT_MAX : static_cast<int>(len);
+  return _read(file, static_cast<char*>(ptr), size);
+}
+#endif
\ No newline at end of file
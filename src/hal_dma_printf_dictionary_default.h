@@ -0,0 +1,83 @@
+/**
+ * @file hal_dma_printf_dictionary_default.h
+ * @brief Static dictionary for hal-dma-printf text compression
+ *
+ * @details
+ * Generated by tools/hal_dma_printf_tool.py gen-dict from dictionary_corpus_sample.log.
+ * Do not edit by hand.
+ */
+
+#ifndef HAL_DMA_PRINTF_DICTIONARY_DEFAULT_H
+#define HAL_DMA_PRINTF_DICTIONARY_DEFAULT_H
+
+#include <stdint.h>
+
+namespace hal_dma_printf_dictionary {
+
+constexpr int kEntryCount = 32;
+
+constexpr const char* kEntries[] = {
+    "\n[WARNING]",
+    "\n[DEBUG]",
+    "\n[ERROR]",
+    " Battery voltage",
+    " initialization",
+    " speed target",
+    " ADC channel",
+    " IMU accel",
+    " Loop time",
+    " 1500 rpm",
+    " IMU gyro",
+    " RUNNING",
+    " value: ",
+    " IDLE",
+    " rpm",
+    " ->",
+    " 0.",
+    " us",
+    " x:",
+    ", current:",
+    "00 ",
+    "01 ",
+    "02 ",
+    ": 12.",
+    ": -0",
+    "Motor",
+    "Parameter updated:",
+    "State changed:",
+    "Sensor",
+    "[INFO] ",
+    "max: 1052",
+    "z: 9",
+};
+
+constexpr uint8_t kEntryLengths[] = {
+    10, 8, 8, 16, 15, 13, 12, 10, 10, 9, 9, 8, 8, 5, 4, 3,
+    3, 3, 3, 10, 3, 3, 3, 5, 4, 5, 18, 14, 6, 7, 9, 4,
+};
+
+// Entries starting with byte c are kEntries[kFirstEntry[c]] up to
+// kEntries[kFirstEntry[c + 1]], longest first.
+constexpr uint8_t kFirstEntry[257] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 20, 20, 20,
+    20, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 25, 25, 25, 25, 25,
+    25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 26, 26,
+    26, 27, 27, 27, 29, 29, 29, 29, 29, 29, 29, 29, 30, 30, 30, 30,
+    30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 31, 31,
+    31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32,
+};
+
+}  // namespace hal_dma_printf_dictionary
+
+#endif  // HAL_DMA_PRINTF_DICTIONARY_DEFAULT_H
@@ -0,0 +1,142 @@
+/**
+ * @file hal_dma_printf_internal.h
+ * @brief Internal TX buffer access shared by optional hal-dma-printf modules
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @note Not part of the public API. Only sources in src/ include this header.
+ */
+
+#ifndef HAL_DMA_PRINTF_INTERNAL_H
+#define HAL_DMA_PRINTF_INTERNAL_H
+
+#include <stdint.h>
+
+namespace hal_dma_printf_internal {
+
+/**
+ * @defgroup HAL_DMA_PRINTF_Frame_Format Binary Frame Format
+ * @{
+ * Binary records share the TX stream with text. Each record is
+ * `kFrameSync, type, length (uint16 LE), payload, checksum`, where the
+ * checksum makes the 8-bit sum of type, length, payload and checksum zero.
+ * Decoded by tools/hal_dma_printf_tool.py.
+ */
+constexpr uint8_t kFrameSync = 0x00;
+constexpr int kFrameOverhead = 5;
+
+constexpr uint8_t kFrameTypeWatchSample = 0x01; /**< Variable watch sample */
+constexpr uint8_t kFrameTypeWatchLayout = 0x02; /**< Variable watch layout */
+constexpr uint8_t kFrameTypeStripe = 0x03;      /**< Bonded link chunk */
+constexpr uint8_t kFrameTypeProfile = 0x04;     /**< Profiler PC samples */
+constexpr uint8_t kFrameTypeWriteTrace = 0x05;  /**< _write call records */
+constexpr uint8_t kFrameTypeStatus = 0x06;      /**< Status channel value */
+constexpr uint8_t kFrameTypePadding = 0x07;     /**< Filler, ignored */
+constexpr uint8_t kFrameTypeSequence = 0x08;    /**< Message sequence tag */
+constexpr uint8_t kFrameTypeEncoding = 0x09;    /**< Encoding hello/switch */
+constexpr uint8_t kFrameTypeLatency = 0x0A;     /**< Command latency */
+/** @} */
+
+/**
+ * @brief One contiguous piece of a frame payload
+ */
+struct FrameSegment {
+  const void* data;
+  int size;
+};
+
+/**
+ * @brief Check whether HalDmaPrintfSetup has completed
+ * @return true if the TX path is ready
+ */
+bool IsInitialized();
+
+/**
+ * @brief Calculate free space in TX buffer
+ * @return Number of bytes that can be queued without overwriting pending or
+ * in-flight data
+ */
+int GetTxFreeBytes();
+
+/**
+ * @brief Queue as much text as currently fits
+ * @param data Pointer to text
+ * @param len Length of text
+ * @return Number of bytes of text consumed (0 to len)
+ * @details Unlike _write, text may be split across calls, so output such as a
+ * serialized document can be larger than TX buffer itself. Not tracked as a
+ * message for eviction.
+ */
+int WriteText(const char* data, int len);
+
+/**
+ * @brief Queue one binary frame for transmission
+ * @param type Frame type (kFrameType*)
+ * @param segments Payload pieces, concatenated in order
+ * @param count Number of payload pieces
+ * @return HAL_DMA_PRINTF_OK, or HAL_DMA_PRINTF_ERROR_NO_SPACE if the whole
+ * frame does not fit (nothing is queued in that case)
+ */
+int WriteFrame(uint8_t type, const FrameSegment* segments, int count);
+
+/**
+ * @brief Record one _write call for workload capture
+ * @param file File descriptor passed to _write
+ * @param len Length passed to _write
+ * @details Implemented by src/hal_dma_printf_trace.cc; called by _write when
+ * HAL_DMA_PRINTF_ENABLE_TRACE is set.
+ */
+void RecordWriteTrace(int file, int len);
+
+/**
+ * @defgroup HAL_DMA_PRINTF_Latency_Hooks Command Latency Hooks
+ * @{
+ * Implemented by src/hal_dma_printf_latency.cc; called by the core when
+ * HAL_DMA_PRINTF_ENABLE_LATENCY is set.
+ */
+
+/**
+ * @brief Read the latency time base
+ * @return DWT cycle count, or HAL_GetTick() on cores without DWT
+ */
+uint32_t GetLatencyTime();
+
+/**
+ * @brief Collect a character of the line being read
+ * @param ch Character returned by _read (not the line ending)
+ * @details A line may span many _read calls; newlib reads unbuffered stdin
+ * one byte at a time.
+ */
+void RecordLineChar(char ch);
+
+/**
+ * @brief Start measuring the command of the line just completed
+ * @param event_time GetLatencyTime() at the RX event that delivered the line
+ * ending
+ * @param rx_us Time from the line ending's arrival to that event
+ * @details The command is the first word of the characters collected by
+ * RecordLineChar since the previous line ending.
+ */
+void RecordCommandRead(uint32_t event_time, uint32_t rx_us);
+
+/**
+ * @brief Check whether the next _write is a command response
+ * @return true if a command was read and nothing written since
+ */
+bool IsResponsePending();
+
+/**
+ * @brief Mark the first response byte as queued in TX buffer
+ */
+void RecordResponseQueued();
+
+/**
+ * @brief Mark the DMA transfer with the first response byte as started
+ * @details May run in the DMA completion interrupt.
+ */
+void RecordResponseSent();
+/** @} */
+
+}  // namespace hal_dma_printf_internal
+
+#endif  // HAL_DMA_PRINTF_INTERNAL_H
@@ -0,0 +1,270 @@
+/**
+ * @file hal_dma_printf_latency.cc
+ * @brief Implementation of console command latency measurement
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf/hal_dma_printf_latency.h"
+
+#include <string.h>
+
+#include "hal_dma_printf_internal.h"
+#include "usart.h"
+
+// Number of distinct commands tracked (can be overridden by compiler flag)
+#ifndef HAL_DMA_PRINTF_LATENCY_MAX_COMMANDS
+#define HAL_DMA_PRINTF_LATENCY_MAX_COMMANDS 8
+#endif
+
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+#define HAL_DMA_PRINTF_LATENCY_HAS_CYCCNT 1
+#else
+#define HAL_DMA_PRINTF_LATENCY_HAS_CYCCNT 0
+#endif
+
+namespace {
+
+using hal_dma_printf_internal::FrameSegment;
+
+static_assert(HAL_DMA_PRINTF_LATENCY_MAX_COMMANDS >= 1 &&
+                  HAL_DMA_PRINTF_LATENCY_MAX_COMMANDS <= 64,
+              "Invalid HAL_DMA_PRINTF_LATENCY_MAX_COMMANDS");
+
+constexpr int kStageCount = HAL_DMA_PRINTF_LATENCY_STAGE_COUNT;
+constexpr int kBucketCount = HAL_DMA_PRINTF_LATENCY_BUCKETS;
+constexpr int kNameSize = HAL_DMA_PRINTF_LATENCY_NAME_SIZE;
+constexpr int kLineSize = 32;  // Start of a line kept to find its command
+
+/**
+ * @brief Histograms of one command, sent as is (little-endian target)
+ */
+struct CommandEntry {
+  char name[kNameSize];  // Zero padded, not terminated
+  uint32_t count;
+  uint32_t max_us[kStageCount];
+  uint16_t histogram[kStageCount][kBucketCount];
+};
+static_assert(sizeof(CommandEntry) == 192, "CommandEntry must be packed");
+
+/**
+ * @brief Where the command being measured is in its round trip
+ */
+enum class Phase : uint8_t {
+  kIdle,     // Nothing measured
+  kHandler,  // _read returned; waiting for the first _write
+  kQueued,   // Response queued; waiting for its DMA transfer
+};
+
+CommandEntry g_commands[HAL_DMA_PRINTF_LATENCY_MAX_COMMANDS];
+int g_command_count = 0;
+volatile bool g_running = false;
+
+// Line being read; with unbuffered stdin, _read returns one byte per call
+char g_line[kLineSize];
+int g_line_len = 0;
+
+// Command being measured
+volatile Phase g_phase = Phase::kIdle;
+int g_command = 0;
+uint32_t g_rx_us = 0;
+uint32_t g_event_time = 0;
+uint32_t g_read_time = 0;
+uint32_t g_queued_time = 0;
+
+/**
+ * @brief Convert a difference of GetLatencyTime values
+ * @param time Elapsed counter value
+ * @return Microseconds
+ */
+inline uint32_t ToMicroseconds(uint32_t time) {
+#if HAL_DMA_PRINTF_LATENCY_HAS_CYCCNT
+  return time / (SystemCoreClock / 1000000U);
+#else
+  return time * 1000U;
+#endif
+}
+
+/**
+ * @brief Find or add the entry of a command line
+ * @param line Line without its line ending
+ * @param len Length of line
+ * @return Entry index, or -1 if the line has no word
+ * @details Once the table is full, other commands share the last entry.
+ */
+int FindCommand(const char* line, int len) {
+  int start = 0;
+  while (start < len && (line[start] == ' ' || line[start] == '\t')) {
+    ++start;
+  }
+  int end = start;
+  while (end < len && line[end] != ' ' && line[end] != '\t') { ++end; }
+  if (end == start) { return -1; }
+
+  char name[kNameSize] = {};
+  memcpy(name, &line[start],
+         (end - start < kNameSize) ? end - start : kNameSize);
+  for (int i = 0; i < g_command_count; ++i) {
+    if (memcmp(g_commands[i].name, name, kNameSize) == 0) { return i; }
+  }
+
+  if (g_command_count == HAL_DMA_PRINTF_LATENCY_MAX_COMMANDS) {
+    CommandEntry& other = g_commands[HAL_DMA_PRINTF_LATENCY_MAX_COMMANDS - 1];
+    memset(other.name, 0, kNameSize);
+    other.name[0] = '*';
+    return HAL_DMA_PRINTF_LATENCY_MAX_COMMANDS - 1;
+  }
+  CommandEntry& entry = g_commands[g_command_count];
+  memset(&entry, 0, sizeof(entry));
+  memcpy(entry.name, name, kNameSize);
+  return g_command_count++;
+}
+
+/**
+ * @brief Count one stage time
+ * @param entry Command
+ * @param stage Stage index
+ * @param us Stage time in microseconds
+ */
+void AddStage(CommandEntry& entry, int stage, uint32_t us) {
+  int bucket = 0;
+  while (bucket < kBucketCount - 1 && us >= (16U << bucket)) { ++bucket; }
+  uint16_t& slot = entry.histogram[stage][bucket];
+  if (slot != UINT16_MAX) { ++slot; }
+  if (us > entry.max_us[stage]) { entry.max_us[stage] = us; }
+}
+
+}  // anonymous namespace
+
+// ============================================================================
+// Internal API
+// ============================================================================
+
+namespace hal_dma_printf_internal {
+
+uint32_t GetLatencyTime() {
+#if HAL_DMA_PRINTF_LATENCY_HAS_CYCCNT
+  return DWT->CYCCNT;
+#else
+  return HAL_GetTick();
+#endif
+}
+
+void RecordLineChar(char ch) {
+  if (g_line_len < kLineSize) { g_line[g_line_len++] = ch; }
+}
+
+void RecordCommandRead(uint32_t event_time, uint32_t rx_us) {
+  const int len = g_line_len;
+  g_line_len = 0;
+  if (!g_running) { return; }
+
+  // A bare line ending (the \n of \r\n) keeps the measurement going
+  const int command = FindCommand(g_line, len);
+  if (command < 0) { return; }
+
+  // The previous command's response may be starting in the DMA completion
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_command = command;
+  g_rx_us = rx_us;
+  g_event_time = event_time;
+  g_read_time = GetLatencyTime();
+  g_phase = Phase::kHandler;
+  __set_PRIMASK(primask);
+}
+
+bool IsResponsePending() { return g_phase == Phase::kHandler; }
+
+void RecordResponseQueued() {
+  g_queued_time = GetLatencyTime();
+  g_phase = Phase::kQueued;
+}
+
+void RecordResponseSent() {
+  if (g_phase != Phase::kQueued) { return; }
+  g_phase = Phase::kIdle;
+
+  const uint32_t sent_time = GetLatencyTime();
+  const uint32_t read_us = ToMicroseconds(g_read_time - g_event_time);
+  const uint32_t handler_us = ToMicroseconds(g_queued_time - g_read_time);
+  const uint32_t tx_us = ToMicroseconds(sent_time - g_queued_time);
+
+  CommandEntry& entry = g_commands[g_command];
+  ++entry.count;
+  AddStage(entry, HAL_DMA_PRINTF_LATENCY_STAGE_RX, g_rx_us);
+  AddStage(entry, HAL_DMA_PRINTF_LATENCY_STAGE_READ, read_us);
+  AddStage(entry, HAL_DMA_PRINTF_LATENCY_STAGE_HANDLER, handler_us);
+  AddStage(entry, HAL_DMA_PRINTF_LATENCY_STAGE_TX, tx_us);
+  AddStage(entry, HAL_DMA_PRINTF_LATENCY_STAGE_TOTAL,
+           g_rx_us + read_us + handler_us + tx_us);
+}
+
+}  // namespace hal_dma_printf_internal
+
+// ============================================================================
+// Public C API Implementation
+// ============================================================================
+
+extern "C" int HalDmaPrintfLatencyStart(void) {
+  if (!hal_dma_printf_internal::IsInitialized()) {
+    return HAL_DMA_PRINTF_ERROR_NOT_READY;
+  }
+
+#if HAL_DMA_PRINTF_LATENCY_HAS_CYCCNT
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+  g_running = true;
+  return HAL_DMA_PRINTF_OK;
+}
+
+extern "C" void HalDmaPrintfLatencyStop(void) {
+  g_running = false;
+  g_phase = Phase::kIdle;
+}
+
+extern "C" void HalDmaPrintfLatencyReset(void) {
+  // The DMA completion may be finishing a measurement
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_phase = Phase::kIdle;
+  g_command_count = 0;
+  __set_PRIMASK(primask);
+}
+
+extern "C" int HalDmaPrintfLatencyGet(int index,
+                                      HalDmaPrintfLatencyReport* report) {
+  if (report == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  if (index < 0 || index >= g_command_count) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const CommandEntry& entry = g_commands[index];
+  memcpy(report->name, entry.name, kNameSize);
+  report->name[kNameSize] = '\0';
+  report->count = entry.count;
+  memcpy(report->max_us, entry.max_us, sizeof(report->max_us));
+  memcpy(report->histogram, entry.histogram, sizeof(report->histogram));
+  __set_PRIMASK(primask);
+  return HAL_DMA_PRINTF_OK;
+}
+
+extern "C" int HalDmaPrintfLatencySend(void) {
+  for (int i = 0; i < g_command_count; ++i) {
+    // Snapshot, so a measurement finishing meanwhile cannot tear the frame
+    CommandEntry entry;
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    entry = g_commands[i];
+    __set_PRIMASK(primask);
+
+    const FrameSegment segment = {&entry, sizeof(entry)};
+    const int result = hal_dma_printf_internal::WriteFrame(
+        hal_dma_printf_internal::kFrameTypeLatency, &segment, 1);
+    if (result != HAL_DMA_PRINTF_OK) { return result; }
+  }
+  return HAL_DMA_PRINTF_OK;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file hal_dma_printf_locks.cc
+ * @brief newlib retargetable lock stubs for single-core targets
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * Replaces newlib's lock functions (and an RTOS's implementation of them).
+ * FILE locks become free: with HAL_DMA_PRINTF_ENABLE_LOCK_STUBS, _write
+ * queues each message with interrupts disabled, and stdout/stderr are
+ * unbuffered, so every printf reaches TX buffer as one atomic write.
+ * newlib's static locks (malloc, environment, stream list, atexit, ...)
+ * still exclude each other, by disabling interrupts while held.
+ *
+ * @note Only for single-core targets whose FILE objects are not shared
+ *       between tasks except through this library.
+ */
+
+#include <sys/lock.h>
+
+#include "usart.h"
+
+/**
+ * @brief newlib lock object
+ * @details Static locks nest with interrupts disabled. Locks created at run
+ * time (FILE locks) all point at one object that is never taken.
+ */
+struct __lock {
+  uint32_t primask;  // Interrupt state restored on the outermost release
+  uint32_t depth;
+};
+
+namespace {
+
+__lock g_file_lock = {};
+
+/**
+ * @brief Take a static lock
+ * @param lock Lock to take
+ */
+void Acquire(_LOCK_T lock) {
+  if (lock == &g_file_lock) { return; }
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (lock->depth++ == 0) { lock->primask = primask; }
+}
+
+/**
+ * @brief Release a static lock
+ * @param lock Lock to release
+ */
+void Release(_LOCK_T lock) {
+  if (lock == &g_file_lock) { return; }
+
+  if (--lock->depth == 0) { __set_PRIMASK(lock->primask); }
+}
+
+}  // anonymous namespace
+
+extern "C" {
+
+// Static locks newlib refers to by name
+struct __lock __lock___sinit_recursive_mutex;
+struct __lock __lock___sfp_recursive_mutex;
+struct __lock __lock___atexit_recursive_mutex;
+struct __lock __lock___at_quick_exit_mutex;
+struct __lock __lock___malloc_recursive_mutex;
+struct __lock __lock___env_recursive_mutex;
+struct __lock __lock___tz_mutex;
+struct __lock __lock___dd_hash_mutex;
+struct __lock __lock___arc4random_mutex;
+
+void __retarget_lock_init(_LOCK_T* lock) { *lock = &g_file_lock; }
+
+void __retarget_lock_init_recursive(_LOCK_T* lock) { *lock = &g_file_lock; }
+
+void __retarget_lock_close(_LOCK_T) {}
+
+void __retarget_lock_close_recursive(_LOCK_T) {}
+
+void __retarget_lock_acquire(_LOCK_T lock) { Acquire(lock); }
+
+void __retarget_lock_acquire_recursive(_LOCK_T lock) { Acquire(lock); }
+
+// Never contended on a single core with interrupts disabled; 0 = acquired
+int __retarget_lock_try_acquire(_LOCK_T lock) {
+  Acquire(lock);
+  return 0;
+}
+
+int __retarget_lock_try_acquire_recursive(_LOCK_T lock) {
+  Acquire(lock);
+  return 0;
+}
+
+void __retarget_lock_release(_LOCK_T lock) { Release(lock); }
+
+void __retarget_lock_release_recursive(_LOCK_T lock) { Release(lock); }
+
+}  // extern "C"
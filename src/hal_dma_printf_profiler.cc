@@ -0,0 +1,142 @@
+/**
+ * @file hal_dma_printf_profiler.cc
+ * @brief Implementation of the sampling profiler
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf/hal_dma_printf_profiler.h"
+
+#include "hal_dma_printf_internal.h"
+#include "usart.h"
+
+// Size of the sample ring (can be overridden by compiler flag)
+#ifndef HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES
+#define HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES 64
+#endif
+
+// The DWT cycle counter is used for overhead accounting where the core has it
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+#define HAL_DMA_PRINTF_PROFILER_HAS_CYCCNT 1
+#else
+#define HAL_DMA_PRINTF_PROFILER_HAS_CYCCNT 0
+#endif
+
+namespace {
+
+using hal_dma_printf_internal::FrameSegment;
+
+static_assert(HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES >= 2 &&
+                  HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES <= 1024,
+              "Invalid HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES");
+
+// Samples are sent in batches of half the ring, so the interrupt can keep
+// filling the other half while a batch waits for TX buffer space
+constexpr int kBatchSize = HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES / 2;
+
+uint32_t g_samples[HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES];
+volatile int g_sample_write_idx = 0;  // Advanced by the interrupt only
+volatile int g_sample_read_idx = 0;   // Advanced by Poll only
+
+void (*g_acknowledge)(void) = nullptr;
+volatile bool g_running = false;
+
+// Running totals reported in every frame; the host takes differences
+volatile uint32_t g_sample_total = 0;
+volatile uint32_t g_dropped_total = 0;
+volatile uint32_t g_record_cycles_total = 0;
+
+/**
+ * @brief Store a value in little-endian byte order
+ * @param dst Destination (4 bytes)
+ * @param value Value to store
+ */
+void PutUint32(uint8_t* dst, uint32_t value) {
+  dst[0] = static_cast<uint8_t>(value);
+  dst[1] = static_cast<uint8_t>(value >> 8);
+  dst[2] = static_cast<uint8_t>(value >> 16);
+  dst[3] = static_cast<uint8_t>(value >> 24);
+}
+
+/**
+ * @brief Number of samples waiting to be sent
+ * @return Sample count
+ */
+inline int GetQueuedSamples() {
+  const int count = g_sample_write_idx - g_sample_read_idx;
+  return (count >= 0) ? count : count + HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES;
+}
+
+}  // anonymous namespace
+
+// ============================================================================
+// Public C API Implementation
+// ============================================================================
+
+extern "C" int HalDmaPrintfProfilerStart(void (*acknowledge)(void)) {
+  if (!hal_dma_printf_internal::IsInitialized()) {
+    return HAL_DMA_PRINTF_ERROR_NOT_READY;
+  }
+
+#if HAL_DMA_PRINTF_PROFILER_HAS_CYCCNT
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+  g_acknowledge = acknowledge;
+  g_running = true;
+  return HAL_DMA_PRINTF_OK;
+}
+
+extern "C" void HalDmaPrintfProfilerStop(void) { g_running = false; }
+
+extern "C" void HalDmaPrintfProfilerRecord(uint32_t pc) {
+#if HAL_DMA_PRINTF_PROFILER_HAS_CYCCNT
+  const uint32_t start_cycles = DWT->CYCCNT;
+#endif
+  if (g_acknowledge != nullptr) { g_acknowledge(); }
+  if (!g_running) { return; }
+
+  ++g_sample_total;
+  const int next =
+      (g_sample_write_idx + 1) % HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES;
+  if (next == g_sample_read_idx) {
+    ++g_dropped_total;
+  } else {
+    g_samples[g_sample_write_idx] = pc;
+    g_sample_write_idx = next;
+  }
+
+#if HAL_DMA_PRINTF_PROFILER_HAS_CYCCNT
+  g_record_cycles_total += DWT->CYCCNT - start_cycles;
+#endif
+}
+
+extern "C" void HalDmaPrintfProfilerPoll(void) {
+  const int count = GetQueuedSamples();
+  if (count < kBatchSize) { return; }
+
+  // Header: tick, samples taken, samples dropped, cycles spent recording
+  uint8_t header[16];
+  PutUint32(&header[0], HAL_GetTick());
+  PutUint32(&header[4], g_sample_total);
+  PutUint32(&header[8], g_dropped_total);
+  PutUint32(&header[12], g_record_cycles_total);
+
+  // Samples may wrap around the end of the ring
+  const int read_idx = g_sample_read_idx;
+  int first_part = HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES - read_idx;
+  if (first_part > count) { first_part = count; }
+  const FrameSegment segments[] = {
+      {header, sizeof(header)},
+      {&g_samples[read_idx], first_part * 4},
+      {&g_samples[0], (count - first_part) * 4},
+  };
+
+  // Samples are stored in native (little-endian) order
+  if (hal_dma_printf_internal::WriteFrame(
+          hal_dma_printf_internal::kFrameTypeProfile, segments, 3) ==
+      HAL_DMA_PRINTF_OK) {
+    g_sample_read_idx =
+        (read_idx + count) % HAL_DMA_PRINTF_PROFILER_MAX_SAMPLES;
+  }
+}
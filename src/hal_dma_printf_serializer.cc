@@ -0,0 +1,359 @@
+/**
+ * @file hal_dma_printf_serializer.cc
+ * @brief Implementation of streaming JSON/CSV serializer
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf/hal_dma_printf_serializer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "hal_dma_printf_internal.h"
+
+namespace {
+
+/**
+ * @brief Writes the output of one serializer call into TX buffer
+ * @details Output is regenerated from the start on every attempt. The first
+ * resume_offset bytes were already queued by the interrupted attempt and are
+ * skipped, so a retried call continues exactly where it stopped.
+ */
+class Emitter {
+ public:
+  explicit Emitter(const HalDmaPrintfWriter* writer)
+      : skip_(writer->resume_offset) {}
+
+  void Put(const char* data, uint32_t len) {
+    if (stalled_) { return; }
+    if (skip_ >= len) {
+      skip_ -= len;
+      produced_ += len;
+      return;
+    }
+    data += skip_;
+    len -= skip_;
+    produced_ += skip_;
+    skip_ = 0;
+
+    const int written =
+        hal_dma_printf_internal::WriteText(data, static_cast<int>(len));
+    produced_ += written;
+    if (static_cast<uint32_t>(written) < len) { stalled_ = true; }
+  }
+
+  void Put(char ch) { Put(&ch, 1); }
+
+  /**
+   * @brief Record progress of the call
+   * @return true if everything was queued
+   */
+  bool Finish(HalDmaPrintfWriter* writer) {
+    writer->resume_offset = stalled_ ? produced_ : 0;
+    return !stalled_;
+  }
+
+ private:
+  uint32_t skip_;
+  uint32_t produced_ = 0;
+  bool stalled_ = false;
+};
+
+inline uint32_t LevelBit(const HalDmaPrintfWriter* writer) {
+  return 1u << (writer->depth - 1);
+}
+
+inline bool InObject(const HalDmaPrintfWriter* writer) {
+  return writer->depth > 0 && (writer->object_bits & LevelBit(writer));
+}
+
+inline bool HasItem(const HalDmaPrintfWriter* writer) {
+  return writer->depth > 0 && (writer->has_item_bits & LevelBit(writer));
+}
+
+/**
+ * @brief Common argument and state checks
+ * @return Error code
+ */
+int CheckWriter(const HalDmaPrintfWriter* writer) {
+  if (writer == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  if (!hal_dma_printf_internal::IsInitialized()) {
+    return HAL_DMA_PRINTF_ERROR_NOT_READY;
+  }
+  return HAL_DMA_PRINTF_OK;
+}
+
+/**
+ * @brief Check that a JSON value may be written now
+ * @return Error code
+ */
+int CheckJsonValue(const HalDmaPrintfWriter* writer) {
+  const int result = CheckWriter(writer);
+  if (result != HAL_DMA_PRINTF_OK) { return result; }
+  // Object members need a key first
+  if (InObject(writer) && !writer->after_key) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+  return HAL_DMA_PRINTF_OK;
+}
+
+void EmitJsonSeparator(Emitter& out, const HalDmaPrintfWriter* writer) {
+  if (!writer->after_key && HasItem(writer)) { out.Put(','); }
+}
+
+void CommitJsonValue(HalDmaPrintfWriter* writer) {
+  if (writer->depth > 0) { writer->has_item_bits |= LevelBit(writer); }
+  writer->after_key = false;
+}
+
+void EmitJsonString(Emitter& out, const char* value) {
+  static const char kHex[] = "0123456789abcdef";
+
+  out.Put('"');
+  const char* run = value;
+  for (const char* p = value; *p != '\0'; ++p) {
+    const unsigned char ch = static_cast<unsigned char>(*p);
+    if (ch >= 0x20 && ch != '"' && ch != '\\') { continue; }
+
+    // Queue the run of plain characters, then the escape
+    out.Put(run, static_cast<uint32_t>(p - run));
+    run = p + 1;
+    switch (ch) {
+      case '"': out.Put("\\\"", 2); break;
+      case '\\': out.Put("\\\\", 2); break;
+      case '\n': out.Put("\\n", 2); break;
+      case '\r': out.Put("\\r", 2); break;
+      case '\t': out.Put("\\t", 2); break;
+      default: {
+        const char escape[] = {'\\', 'u', '0', '0', kHex[ch >> 4],
+                               kHex[ch & 0xF]};
+        out.Put(escape, sizeof(escape));
+        break;
+      }
+    }
+  }
+  out.Put(run, static_cast<uint32_t>(strlen(run)));
+  out.Put('"');
+}
+
+int WriteJsonScalar(HalDmaPrintfWriter* writer, const char* text,
+                    uint32_t len) {
+  const int result = CheckJsonValue(writer);
+  if (result != HAL_DMA_PRINTF_OK) { return result; }
+
+  Emitter out(writer);
+  EmitJsonSeparator(out, writer);
+  out.Put(text, len);
+  if (!out.Finish(writer)) { return HAL_DMA_PRINTF_ERROR_NO_SPACE; }
+  CommitJsonValue(writer);
+  return HAL_DMA_PRINTF_OK;
+}
+
+int BeginJsonContainer(HalDmaPrintfWriter* writer, bool is_object) {
+  const int result = CheckJsonValue(writer);
+  if (result != HAL_DMA_PRINTF_OK) { return result; }
+  if (writer->depth >= HAL_DMA_PRINTF_WRITER_MAX_DEPTH) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+
+  Emitter out(writer);
+  EmitJsonSeparator(out, writer);
+  out.Put(is_object ? '{' : '[');
+  if (!out.Finish(writer)) { return HAL_DMA_PRINTF_ERROR_NO_SPACE; }
+  CommitJsonValue(writer);
+
+  ++writer->depth;
+  if (is_object) {
+    writer->object_bits |= LevelBit(writer);
+  } else {
+    writer->object_bits &= ~LevelBit(writer);
+  }
+  writer->has_item_bits &= ~LevelBit(writer);
+  return HAL_DMA_PRINTF_OK;
+}
+
+int EndJsonContainer(HalDmaPrintfWriter* writer, bool is_object) {
+  const int result = CheckWriter(writer);
+  if (result != HAL_DMA_PRINTF_OK) { return result; }
+  if (writer->depth == 0 || InObject(writer) != is_object ||
+      writer->after_key) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+
+  Emitter out(writer);
+  out.Put(is_object ? '}' : ']');
+  if (!out.Finish(writer)) { return HAL_DMA_PRINTF_ERROR_NO_SPACE; }
+  --writer->depth;
+  return HAL_DMA_PRINTF_OK;
+}
+
+/**
+ * @brief Format a float the same way for JSON and CSV
+ * @return Number of characters in text (0 for NaN and infinity)
+ */
+int FormatFloat(float value, char* text, int size) {
+  if (!std::isfinite(value)) { return 0; }
+  return snprintf(text, size, "%.7g", static_cast<double>(value));
+}
+
+int WriteCsvField(HalDmaPrintfWriter* writer, const char* text,
+                  uint32_t len, bool quote) {
+  const int result = CheckWriter(writer);
+  if (result != HAL_DMA_PRINTF_OK) { return result; }
+
+  Emitter out(writer);
+  if (writer->has_item_bits & 1u) { out.Put(','); }
+  if (quote) {
+    // Quotes inside a quoted field are doubled
+    out.Put('"');
+    const char* run = text;
+    for (const char* p = text; p < text + len; ++p) {
+      if (*p != '"') { continue; }
+      out.Put(run, static_cast<uint32_t>(p + 1 - run));
+      out.Put('"');
+      run = p + 1;
+    }
+    out.Put(run, static_cast<uint32_t>(text + len - run));
+    out.Put('"');
+  } else {
+    out.Put(text, len);
+  }
+  if (!out.Finish(writer)) { return HAL_DMA_PRINTF_ERROR_NO_SPACE; }
+  writer->has_item_bits |= 1u;
+  return HAL_DMA_PRINTF_OK;
+}
+
+}  // anonymous namespace
+
+// ============================================================================
+// Public C API Implementation
+// ============================================================================
+
+extern "C" void HalDmaPrintfWriterInit(HalDmaPrintfWriter* writer) {
+  if (writer != nullptr) { *writer = {}; }
+}
+
+extern "C" int HalDmaPrintfJsonBeginObject(HalDmaPrintfWriter* writer) {
+  return BeginJsonContainer(writer, true);
+}
+
+extern "C" int HalDmaPrintfJsonEndObject(HalDmaPrintfWriter* writer) {
+  return EndJsonContainer(writer, true);
+}
+
+extern "C" int HalDmaPrintfJsonBeginArray(HalDmaPrintfWriter* writer) {
+  return BeginJsonContainer(writer, false);
+}
+
+extern "C" int HalDmaPrintfJsonEndArray(HalDmaPrintfWriter* writer) {
+  return EndJsonContainer(writer, false);
+}
+
+extern "C" int HalDmaPrintfJsonKey(HalDmaPrintfWriter* writer,
+                                   const char* key) {
+  const int result = CheckWriter(writer);
+  if (result != HAL_DMA_PRINTF_OK) { return result; }
+  if (key == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  if (!InObject(writer) || writer->after_key) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+
+  Emitter out(writer);
+  EmitJsonSeparator(out, writer);
+  EmitJsonString(out, key);
+  out.Put(':');
+  if (!out.Finish(writer)) { return HAL_DMA_PRINTF_ERROR_NO_SPACE; }
+  writer->has_item_bits |= LevelBit(writer);
+  writer->after_key = true;
+  return HAL_DMA_PRINTF_OK;
+}
+
+extern "C" int HalDmaPrintfJsonString(HalDmaPrintfWriter* writer,
+                                      const char* value) {
+  if (value == nullptr) { return HalDmaPrintfJsonNull(writer); }
+  const int result = CheckJsonValue(writer);
+  if (result != HAL_DMA_PRINTF_OK) { return result; }
+
+  Emitter out(writer);
+  EmitJsonSeparator(out, writer);
+  EmitJsonString(out, value);
+  if (!out.Finish(writer)) { return HAL_DMA_PRINTF_ERROR_NO_SPACE; }
+  CommitJsonValue(writer);
+  return HAL_DMA_PRINTF_OK;
+}
+
+extern "C" int HalDmaPrintfJsonInt(HalDmaPrintfWriter* writer,
+                                   int32_t value) {
+  char text[12];
+  const int len =
+      snprintf(text, sizeof(text), "%ld", static_cast<long>(value));
+  return WriteJsonScalar(writer, text, len);
+}
+
+extern "C" int HalDmaPrintfJsonUint(HalDmaPrintfWriter* writer,
+                                    uint32_t value) {
+  char text[11];
+  const int len = snprintf(text, sizeof(text), "%lu",
+                           static_cast<unsigned long>(value));
+  return WriteJsonScalar(writer, text, len);
+}
+
+extern "C" int HalDmaPrintfJsonFloat(HalDmaPrintfWriter* writer,
+                                     float value) {
+  char text[16];
+  const int len = FormatFloat(value, text, sizeof(text));
+  // JSON has no NaN or infinity
+  if (len == 0) { return HalDmaPrintfJsonNull(writer); }
+  return WriteJsonScalar(writer, text, len);
+}
+
+extern "C" int HalDmaPrintfJsonBool(HalDmaPrintfWriter* writer, bool value) {
+  return value ? WriteJsonScalar(writer, "true", 4)
+               : WriteJsonScalar(writer, "false", 5);
+}
+
+extern "C" int HalDmaPrintfJsonNull(HalDmaPrintfWriter* writer) {
+  return WriteJsonScalar(writer, "null", 4);
+}
+
+extern "C" int HalDmaPrintfCsvString(HalDmaPrintfWriter* writer,
+                                     const char* value) {
+  if (value == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  const uint32_t len = static_cast<uint32_t>(strlen(value));
+  const bool quote = strpbrk(value, ",\"\r\n") != nullptr;
+  return WriteCsvField(writer, value, len, quote);
+}
+
+extern "C" int HalDmaPrintfCsvInt(HalDmaPrintfWriter* writer, int32_t value) {
+  char text[12];
+  const int len =
+      snprintf(text, sizeof(text), "%ld", static_cast<long>(value));
+  return WriteCsvField(writer, text, len, false);
+}
+
+extern "C" int HalDmaPrintfCsvUint(HalDmaPrintfWriter* writer,
+                                   uint32_t value) {
+  char text[11];
+  const int len = snprintf(text, sizeof(text), "%lu",
+                           static_cast<unsigned long>(value));
+  return WriteCsvField(writer, text, len, false);
+}
+
+extern "C" int HalDmaPrintfCsvFloat(HalDmaPrintfWriter* writer, float value) {
+  char text[16];
+  const int len = FormatFloat(value, text, sizeof(text));
+  return WriteCsvField(writer, text, len, false);
+}
+
+extern "C" int HalDmaPrintfCsvEndRow(HalDmaPrintfWriter* writer) {
+  const int result = CheckWriter(writer);
+  if (result != HAL_DMA_PRINTF_OK) { return result; }
+
+  Emitter out(writer);
+  out.Put("\r\n", 2);
+  if (!out.Finish(writer)) { return HAL_DMA_PRINTF_ERROR_NO_SPACE; }
+  writer->has_item_bits &= ~1u;
+  return HAL_DMA_PRINTF_OK;
+}
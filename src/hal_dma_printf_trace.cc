@@ -0,0 +1,183 @@
+/**
+ * @file hal_dma_printf_trace.cc
+ * @brief Implementation of _write workload capture
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf/hal_dma_printf_trace.h"
+
+#include "hal_dma_printf_internal.h"
+#include "usart.h"
+
+// Size of the record ring (can be overridden by compiler flag)
+#ifndef HAL_DMA_PRINTF_TRACE_MAX_RECORDS
+#define HAL_DMA_PRINTF_TRACE_MAX_RECORDS 64
+#endif
+
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+#define HAL_DMA_PRINTF_TRACE_HAS_CYCCNT 1
+#else
+#define HAL_DMA_PRINTF_TRACE_HAS_CYCCNT 0
+#endif
+
+namespace {
+
+using hal_dma_printf_internal::FrameSegment;
+
+static_assert(HAL_DMA_PRINTF_TRACE_MAX_RECORDS >= 2 &&
+                  HAL_DMA_PRINTF_TRACE_MAX_RECORDS <= 1024,
+              "Invalid HAL_DMA_PRINTF_TRACE_MAX_RECORDS");
+
+constexpr int kBatchSize = HAL_DMA_PRINTF_TRACE_MAX_RECORDS / 2;
+
+/**
+ * @brief One _write call, sent as is (little-endian target)
+ */
+struct TraceRecord {
+  uint32_t time_us;
+  uint16_t length;
+  uint8_t file;
+  uint8_t reserved;
+};
+static_assert(sizeof(TraceRecord) == 8, "TraceRecord must be packed");
+
+TraceRecord g_records[HAL_DMA_PRINTF_TRACE_MAX_RECORDS];
+volatile int g_record_write_idx = 0;
+volatile int g_record_read_idx = 0;
+volatile bool g_running = false;
+volatile uint32_t g_lost_total = 0;
+
+#if HAL_DMA_PRINTF_TRACE_HAS_CYCCNT
+// Microsecond clock built from CYCCNT deltas
+uint32_t g_clock_cycles = 0;  // CYCCNT when the clock was last advanced
+uint32_t g_clock_rest = 0;    // Cycles short of the next microsecond
+uint32_t g_clock_us = 0;
+#endif
+
+/**
+ * @brief Current time for a record
+ * @return Microseconds (wraps after 2^32 us, as the host tool expects)
+ * @details CYCCNT itself wraps within seconds at typical core clocks, which
+ * is not a whole number of microseconds; the elapsed cycles are added up
+ * instead. Must be called at least once per CYCCNT period (every record
+ * and HalDmaPrintfTracePoll do) and with interrupts disabled.
+ */
+inline uint32_t GetTimeUs() {
+#if HAL_DMA_PRINTF_TRACE_HAS_CYCCNT
+  const uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+  const uint32_t now = DWT->CYCCNT;
+  const uint32_t elapsed = now - g_clock_cycles;
+  g_clock_cycles = now;
+  g_clock_us += elapsed / cycles_per_us;
+  g_clock_rest += elapsed % cycles_per_us;
+  if (g_clock_rest >= cycles_per_us) {
+    g_clock_rest -= cycles_per_us;
+    ++g_clock_us;
+  }
+  return g_clock_us;
+#else
+  return HAL_GetTick() * 1000U;
+#endif
+}
+
+/**
+ * @brief Number of records waiting to be sent
+ * @return Record count
+ */
+inline int GetQueuedRecords() {
+  const int count = g_record_write_idx - g_record_read_idx;
+  return (count >= 0) ? count : count + HAL_DMA_PRINTF_TRACE_MAX_RECORDS;
+}
+
+}  // anonymous namespace
+
+// ============================================================================
+// Internal API
+// ============================================================================
+
+namespace hal_dma_printf_internal {
+
+void RecordWriteTrace(int file, int len) {
+  if (!g_running) { return; }
+
+  // _write may run in interrupts as well as in the main loop
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const int next = (g_record_write_idx + 1) % HAL_DMA_PRINTF_TRACE_MAX_RECORDS;
+  if (next == g_record_read_idx) {
+    ++g_lost_total;
+  } else {
+    TraceRecord& record = g_records[g_record_write_idx];
+    record.time_us = GetTimeUs();
+    record.length = static_cast<uint16_t>((len > UINT16_MAX) ? UINT16_MAX
+                                                             : len);
+    record.file = static_cast<uint8_t>(file);
+    record.reserved = 0;
+    g_record_write_idx = next;
+  }
+  __set_PRIMASK(primask);
+}
+
+}  // namespace hal_dma_printf_internal
+
+// ============================================================================
+// Public C API Implementation
+// ============================================================================
+
+extern "C" int HalDmaPrintfTraceStart(void) {
+  if (!hal_dma_printf_internal::IsInitialized()) {
+    return HAL_DMA_PRINTF_ERROR_NOT_READY;
+  }
+
+#if HAL_DMA_PRINTF_TRACE_HAS_CYCCNT
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_clock_cycles = DWT->CYCCNT;
+  __set_PRIMASK(primask);
+#endif
+  g_running = true;
+  return HAL_DMA_PRINTF_OK;
+}
+
+extern "C" void HalDmaPrintfTraceStop(void) { g_running = false; }
+
+extern "C" void HalDmaPrintfTracePoll(void) {
+#if HAL_DMA_PRINTF_TRACE_HAS_CYCCNT
+  // Keeps the clock going through stretches without _write calls
+  if (g_running) {
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    GetTimeUs();
+    __set_PRIMASK(primask);
+  }
+#endif
+
+  const int count = GetQueuedRecords();
+  if (count < kBatchSize) { return; }
+
+  uint8_t header[4];
+  const uint32_t lost = g_lost_total;
+  for (int i = 0; i < 4; ++i) {
+    header[i] = static_cast<uint8_t>(lost >> (8 * i));
+  }
+
+  const int read_idx = g_record_read_idx;
+  int first_part = HAL_DMA_PRINTF_TRACE_MAX_RECORDS - read_idx;
+  if (first_part > count) { first_part = count; }
+  const FrameSegment segments[] = {
+      {header, sizeof(header)},
+      {&g_records[read_idx],
+       first_part * static_cast<int>(sizeof(TraceRecord))},
+      {&g_records[0],
+       (count - first_part) * static_cast<int>(sizeof(TraceRecord))},
+  };
+
+  if (hal_dma_printf_internal::WriteFrame(
+          hal_dma_printf_internal::kFrameTypeWriteTrace, segments, 3) ==
+      HAL_DMA_PRINTF_OK) {
+    g_record_read_idx = (read_idx + count) % HAL_DMA_PRINTF_TRACE_MAX_RECORDS;
+  }
+}
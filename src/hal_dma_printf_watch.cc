@@ -0,0 +1,135 @@
+/**
+ * @file hal_dma_printf_watch.cc
+ * @brief Implementation of variable watch streaming
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf/hal_dma_printf_watch.h"
+
+#include "hal_dma_printf_internal.h"
+#include "usart.h"
+
+// Default number of watch slots (can be overridden by compiler flag)
+#ifndef HAL_DMA_PRINTF_WATCH_MAX_VARIABLES
+#define HAL_DMA_PRINTF_WATCH_MAX_VARIABLES 8
+#endif
+
+namespace {
+
+using hal_dma_printf_internal::FrameSegment;
+
+// The layout is re-sent periodically so a host attached later can decode
+constexpr uint32_t kLayoutInterval = 32;
+
+// Each slot contributes a data segment; the sample timestamp is one more
+constexpr int kMaxSampleSegments = HAL_DMA_PRINTF_WATCH_MAX_VARIABLES + 1;
+
+struct WatchSlot {
+  const volatile void* address;
+  uint8_t size;
+};
+
+WatchSlot g_slots[HAL_DMA_PRINTF_WATCH_MAX_VARIABLES];
+int g_slot_count = 0;
+uint32_t g_period_ms = 0;
+uint32_t g_last_snapshot_tick = 0;
+uint32_t g_snapshots_since_layout = kLayoutInterval;
+
+/**
+ * @brief Store a value in little-endian byte order
+ * @param dst Destination (4 bytes)
+ * @param value Value to store
+ */
+void PutUint32(uint8_t* dst, uint32_t value) {
+  dst[0] = static_cast<uint8_t>(value);
+  dst[1] = static_cast<uint8_t>(value >> 8);
+  dst[2] = static_cast<uint8_t>(value >> 16);
+  dst[3] = static_cast<uint8_t>(value >> 24);
+}
+
+/**
+ * @brief Send the address and size of every slot
+ * @return Error code
+ */
+int SendLayout() {
+  // Per slot: address (uint32 LE) and size (uint8)
+  uint8_t layout[HAL_DMA_PRINTF_WATCH_MAX_VARIABLES * 5];
+  for (int i = 0; i < g_slot_count; ++i) {
+    PutUint32(&layout[i * 5],
+              static_cast<uint32_t>(
+                  reinterpret_cast<uintptr_t>(g_slots[i].address)));
+    layout[i * 5 + 4] = g_slots[i].size;
+  }
+  const FrameSegment segment = {layout, g_slot_count * 5};
+  return hal_dma_printf_internal::WriteFrame(
+      hal_dma_printf_internal::kFrameTypeWatchLayout, &segment, 1);
+}
+
+}  // anonymous namespace
+
+// ============================================================================
+// Public C API Implementation
+// ============================================================================
+
+extern "C" int HalDmaPrintfWatchAdd(const volatile void* address,
+                                    uint16_t size) {
+  if (address == nullptr) { return HAL_DMA_PRINTF_ERROR_NULL_PTR; }
+  if (size == 0 || size > UINT8_MAX) {
+    return HAL_DMA_PRINTF_ERROR_INVALID_ARG;
+  }
+  if (g_slot_count >= HAL_DMA_PRINTF_WATCH_MAX_VARIABLES) {
+    return HAL_DMA_PRINTF_ERROR_NO_SPACE;
+  }
+
+  g_slots[g_slot_count] = {address, static_cast<uint8_t>(size)};
+  g_snapshots_since_layout = kLayoutInterval;
+  return g_slot_count++;
+}
+
+extern "C" void HalDmaPrintfWatchClear(void) {
+  g_slot_count = 0;
+  g_snapshots_since_layout = kLayoutInterval;
+}
+
+extern "C" void HalDmaPrintfWatchSetPeriod(uint32_t period_ms) {
+  g_period_ms = period_ms;
+}
+
+extern "C" int HalDmaPrintfWatchSnapshot(void) {
+  if (!hal_dma_printf_internal::IsInitialized()) {
+    return HAL_DMA_PRINTF_ERROR_NOT_READY;
+  }
+
+  if (g_snapshots_since_layout >= kLayoutInterval) {
+    const int result = SendLayout();
+    if (result != HAL_DMA_PRINTF_OK) { return result; }
+    g_snapshots_since_layout = 0;
+  }
+
+  // Variables are copied straight from their own memory into the TX buffer;
+  // the copy is what keeps the DMA from sending a half-updated value.
+  uint8_t timestamp[4];
+  PutUint32(timestamp, HAL_GetTick());
+  FrameSegment segments[kMaxSampleSegments];
+  segments[0] = {timestamp, sizeof(timestamp)};
+  for (int i = 0; i < g_slot_count; ++i) {
+    segments[i + 1] = {const_cast<const void*>(g_slots[i].address),
+                       g_slots[i].size};
+  }
+
+  const int result = hal_dma_printf_internal::WriteFrame(
+      hal_dma_printf_internal::kFrameTypeWatchSample, segments,
+      g_slot_count + 1);
+  if (result == HAL_DMA_PRINTF_OK) { ++g_snapshots_since_layout; }
+  return result;
+}
+
+extern "C" void HalDmaPrintfWatchPoll(void) {
+  if (g_period_ms == 0) { return; }
+
+  const uint32_t now = HAL_GetTick();
+  if (now - g_last_snapshot_tick < g_period_ms) { return; }
+  g_last_snapshot_tick = now;
+  HalDmaPrintfWatchSnapshot();
+}
@@ -0,0 +1,170 @@
+/**
+ * @file deferred_test.cc
+ * @brief Split transfer completion tests (HAL_DMA_PRINTF_ENABLE_DEFERRED)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf_internal.h"
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+int g_deferred_requests = 0;
+bool g_deferred_pending = false;
+
+// Stands in for PendSV: the request is served after the interrupt returns
+void RequestDeferred() {
+  ++g_deferred_requests;
+  g_deferred_pending = true;
+}
+
+void Setup() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+  HalDmaPrintfSetDeferredTrigger(RequestDeferred);
+}
+
+std::string Line(char ch, size_t size) {
+  return std::string(size - 2, ch) + "\r\n";
+}
+
+/**
+ * @brief Advance time, running the deferred half whenever it is requested
+ * @param us Microseconds to advance
+ */
+void RunFor(uint32_t us) {
+  constexpr uint32_t kStepUs = 100;
+  for (uint32_t elapsed = 0; elapsed < us; elapsed += kStepUs) {
+    HalDmaPrintfHostAdvance(kStepUs);
+    if (g_deferred_pending) {
+      g_deferred_pending = false;
+      HalDmaPrintfRunDeferred();
+    }
+  }
+}
+
+std::string ReadOutput() {
+  std::string output;
+  uint8_t buffer[256];
+  size_t n;
+  while ((n = HalDmaPrintfHostReadOutput(&huart1, buffer, sizeof(buffer))) >
+         0) {
+    output.append(reinterpret_cast<const char*>(buffer), n);
+  }
+  return output;
+}
+
+HalDmaPrintfDeferredStats GetDeferredStats() {
+  HalDmaPrintfDeferredStats stats;
+  HalDmaPrintfGetDeferredStats(&stats);
+  return stats;
+}
+
+void TestPreparedChunk() {
+  Setup();
+  const std::string first = Line('a', 100);
+  const std::string second = Line('b', 100);
+  const std::string third = Line('c', 50);
+
+  // The writer starts the first chunk and prepares the second; both hold
+  // their space until sent
+  WriteText(1, first);
+  WriteText(1, second);
+  CHECK(hal_dma_printf_internal::GetTxFreeBytes() == 55);
+  WriteText(1, third);
+  CHECK(hal_dma_printf_internal::GetTxFreeBytes() == 5);
+
+  // 100 bytes take 8.7 ms at 115200 baud. The interrupt alone moves the
+  // prepared chunk in flight and frees the finished one.
+  HalDmaPrintfHostAdvance(9000);
+  HalDmaPrintfDeferredStats stats = GetDeferredStats();
+  CHECK(stats.isr_count == 1);
+  CHECK(stats.deferred_count == 0);
+  CHECK(stats.prepare_misses == 0);
+  CHECK(g_deferred_requests == 1);
+  CHECK(hal_dma_printf_internal::GetTxFreeBytes() == 105);
+  CHECK(ReadOutput() == first);
+
+  // The deferred half prepares the third chunk behind the one in flight
+  g_deferred_pending = false;
+  HalDmaPrintfRunDeferred();
+  CHECK(hal_dma_printf_internal::GetTxFreeBytes() == 105);
+  RunFor(20000);
+  CHECK(ReadOutput() == second + third);
+  CHECK(hal_dma_printf_internal::GetTxFreeBytes() ==
+        HAL_DMA_PRINTF_BUFFER_SIZE - 1);
+
+  stats = GetDeferredStats();
+  CHECK(stats.isr_count == 3);
+  CHECK(stats.prepare_misses == 0);
+}
+
+void TestPrepareMiss() {
+  Setup();
+  const std::string first = Line('a', 60);
+  const std::string second = Line('b', 60);
+  const std::string third = Line('c', 60);
+  WriteText(1, first);
+  WriteText(1, second);
+  WriteText(1, third);
+
+  // Nothing runs the deferred half: after the prepared chunk, the link
+  // idles with the third message queued
+  HalDmaPrintfHostAdvance(20000);
+  CHECK(ReadOutput() == first + second);
+  HalDmaPrintfDeferredStats stats = GetDeferredStats();
+  CHECK(stats.isr_count == 2);
+  CHECK(stats.prepare_misses == 1);
+
+  g_deferred_pending = false;
+  HalDmaPrintfRunDeferred();
+  RunFor(10000);
+  CHECK(ReadOutput() == third);
+  stats = GetDeferredStats();
+  CHECK(stats.isr_count == 3);
+  CHECK(stats.deferred_count == 2);
+  CHECK(stats.prepare_misses == 1);
+  CHECK(hal_dma_printf_internal::GetTxFreeBytes() ==
+        HAL_DMA_PRINTF_BUFFER_SIZE - 1);
+}
+
+void TestLostBytes() {
+  Setup();
+  const std::string first = Line('a', 100);
+  const std::string second = Line('b', 100);
+  const std::string third = Line('c', 100);
+
+  // In flight and prepared bytes are not free: the third message is lost
+  WriteText(1, first);
+  WriteText(1, second);
+  WriteText(1, third);
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  CHECK(stats.dropped_messages[HAL_DMA_PRINTF_SEVERITY_INFO] == 1);
+  CHECK(stats.lost_bytes == 100);
+
+  // Once both chunks are sent, all of TX buffer is free again
+  RunFor(20000);
+  CHECK(ReadOutput() == first + second);
+  CHECK(hal_dma_printf_internal::GetTxFreeBytes() ==
+        HAL_DMA_PRINTF_BUFFER_SIZE - 1);
+  WriteText(1, third);
+  WriteText(1, third);
+  RunFor(20000);
+  CHECK(ReadOutput() == third + third);
+  HalDmaPrintfGetStats(&stats);
+  CHECK(stats.lost_bytes == 100);
+}
+
+const TestCase kCases[] = {
+    {"prepared_chunk", TestPreparedChunk},
+    {"prepare_miss", TestPrepareMiss},
+    {"lost_bytes", TestLostBytes},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
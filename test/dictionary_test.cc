@@ -0,0 +1,93 @@
+/**
+ * @file dictionary_test.cc
+ * @brief Static dictionary compression tests
+ * (HAL_DMA_PRINTF_ENABLE_DICTIONARY)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf_dictionary_default.h"
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+void Setup() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+}
+
+/**
+ * @brief Decode output as tools/hal_dma_printf_tool.py does
+ * @param encoded Captured output
+ * @return Original text
+ */
+std::string Decode(const std::string& encoded) {
+  namespace dict = hal_dma_printf_dictionary;
+  std::string text;
+  for (size_t i = 0; i < encoded.size(); ++i) {
+    const uint8_t byte = static_cast<uint8_t>(encoded[i]);
+    if (byte == 0x7F) {
+      CHECK(++i < encoded.size());
+      text += static_cast<char>(encoded[i] ^ 0x40);
+    } else if (byte >= 0x80) {
+      CHECK(byte - 0x80 < dict::kEntryCount);
+      text += dict::kEntries[byte - 0x80];
+    } else {
+      text += static_cast<char>(byte);
+    }
+  }
+  return text;
+}
+
+void TestRoundTrip() {
+  Setup();
+  const std::string text =
+      "\n[WARNING] Battery voltage low, value: 3.1\xB0 \x7F\r\n";
+  WriteText(1, text);
+  const std::string encoded = DrainOutput(&huart1);
+  CHECK(encoded.size() < text.size());
+  CHECK(Decode(encoded) == text);
+}
+
+void TestLargeMessage() {
+  Setup();
+  // Longer than half of TX buffer; reserving an escape per byte would
+  // have dropped it
+  std::string text;
+  while (text.size() < 200) { text += "Loop time 12 us, speed target 42\r\n"; }
+  text.resize(200);
+  CHECK(WriteText(1, text) == 200);
+
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  CHECK(stats.dropped_messages[HAL_DMA_PRINTF_SEVERITY_INFO] == 0);
+  CHECK(Decode(DrainOutput(&huart1)) == text);
+}
+
+void TestLargeEscapedMessage() {
+  Setup();
+  const std::string fits(120, '\xFF');
+  const std::string too_large(130, '\xFF');
+
+  // Every byte is escaped: 240 bytes fit, 260 do not
+  WriteText(1, fits);
+  CHECK(Decode(DrainOutput(&huart1)) == fits);
+  WriteText(1, too_large);
+  CHECK(DrainOutput(&huart1).empty());
+
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  CHECK(stats.dropped_messages[HAL_DMA_PRINTF_SEVERITY_INFO] == 1);
+}
+
+const TestCase kCases[] = {
+    {"round_trip", TestRoundTrip},
+    {"large_message", TestLargeMessage},
+    {"large_escaped_message", TestLargeEscapedMessage},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file eviction_test.cc
+ * @brief Severity-aware eviction tests (HAL_DMA_PRINTF_ENABLE_EVICTION)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+void Setup() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+}
+
+std::string Line(char ch, size_t size) {
+  return std::string(size - 2, ch) + "\r\n";
+}
+
+// The host C library does not route HalDmaPrintfLog through _write; stdout
+// carries INFO and stderr ERROR messages
+constexpr int kInfoFile = 1;
+constexpr int kErrorFile = 2;
+
+void TestEvictForError() {
+  Setup();
+  const std::string in_flight = Line('0', 40);
+  const std::string info1 = Line('1', 50);
+  const std::string info2 = Line('2', 50);
+  const std::string info3 = Line('3', 50);
+  const std::string info4 = Line('4', 50);
+  const std::string error = Line('E', 60);
+
+  WriteText(kInfoFile, in_flight);
+  WriteText(kInfoFile, info1);
+  WriteText(kInfoFile, info2);
+  WriteText(kInfoFile, info3);
+  WriteText(kInfoFile, info4);
+
+  // 15 bytes free: INFO is dropped, ERROR evicts the oldest queued message
+  WriteText(kInfoFile, info1);
+  WriteText(kErrorFile, error);
+
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  CHECK(stats.dropped_messages[HAL_DMA_PRINTF_SEVERITY_INFO] == 1);
+  CHECK(stats.dropped_messages[HAL_DMA_PRINTF_SEVERITY_ERROR] == 0);
+  CHECK(stats.evicted_messages[HAL_DMA_PRINTF_SEVERITY_INFO] == 1);
+  CHECK(stats.lost_bytes == 100);
+
+  // The message in flight is never evicted
+  CHECK(DrainOutput(&huart1) == in_flight + info2 + info3 + info4 + error);
+}
+
+void TestEvictSeveral() {
+  Setup();
+  const std::string in_flight = Line('0', 40);
+  const std::string info1 = Line('1', 70);
+  const std::string info2 = Line('2', 70);
+  const std::string info3 = Line('3', 70);
+  const std::string error = Line('E', 120);
+
+  WriteText(kInfoFile, in_flight);
+  WriteText(kInfoFile, info1);
+  WriteText(kInfoFile, info2);
+  WriteText(kInfoFile, info3);
+
+  // 5 bytes free: the two oldest queued messages make room
+  WriteText(kErrorFile, error);
+
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  CHECK(stats.evicted_messages[HAL_DMA_PRINTF_SEVERITY_INFO] == 2);
+  CHECK(stats.lost_bytes == 140);
+  CHECK(DrainOutput(&huart1) == in_flight + info3 + error);
+}
+
+void TestNoEvictionForInfo() {
+  Setup();
+  const std::string in_flight = Line('0', 100);
+  const std::string info1 = Line('1', 150);
+  const std::string info2 = Line('2', 100);
+
+  WriteText(kInfoFile, in_flight);
+  WriteText(kInfoFile, info1);
+  WriteText(kInfoFile, info2);
+
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  CHECK(stats.dropped_messages[HAL_DMA_PRINTF_SEVERITY_INFO] == 1);
+  CHECK(stats.evicted_messages[HAL_DMA_PRINTF_SEVERITY_INFO] == 0);
+  CHECK(DrainOutput(&huart1) == in_flight + info1);
+}
+
+const TestCase kCases[] = {
+    {"evict_for_error", TestEvictForError},
+    {"evict_several", TestEvictSeveral},
+    {"no_eviction_for_info", TestNoEvictionForInfo},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
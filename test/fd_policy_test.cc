@@ -0,0 +1,126 @@
+/**
+ * @file fd_policy_test.cc
+ * @brief Per-descriptor flush and overflow policy tests
+ * (HAL_DMA_PRINTF_ENABLE_FD_POLICY)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+constexpr int kPolicyFile = 3;
+
+void Setup(HalDmaPrintfFlushPolicy flush, uint16_t coalesce_bytes,
+           HalDmaPrintfOverflowPolicy overflow) {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+  const HalDmaPrintfFdPolicy policy = {flush, coalesce_bytes, overflow,
+                                       HAL_DMA_PRINTF_SEVERITY_INFO};
+  CHECK(HalDmaPrintfSetFdPolicy(kPolicyFile, &policy) == HAL_DMA_PRINTF_OK);
+}
+
+std::string Line(char ch, size_t size) {
+  return std::string(size - 2, ch) + "\r\n";
+}
+
+HalDmaPrintfStats GetStats() {
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  return stats;
+}
+
+void TestDropNew() {
+  Setup(HAL_DMA_PRINTF_FLUSH_IMMEDIATE, 0, HAL_DMA_PRINTF_OVERFLOW_DROP_NEW);
+  const std::string first = Line('a', 100);
+  const std::string second = Line('b', 100);
+  WriteText(kPolicyFile, first);
+  WriteText(kPolicyFile, second);
+  WriteText(kPolicyFile, Line('c', 100));
+  CHECK(DrainOutput(&huart1) == first + second);
+  CHECK(GetStats().dropped_messages[HAL_DMA_PRINTF_SEVERITY_INFO] == 1);
+  CHECK(GetStats().lost_bytes == 100);
+}
+
+void TestCoalesce() {
+  Setup(HAL_DMA_PRINTF_FLUSH_COALESCE, 64, HAL_DMA_PRINTF_OVERFLOW_DROP_NEW);
+  const std::string first = Line('a', 40);
+  const std::string second = Line('b', 40);
+
+  // Held back until 64 bytes are queued
+  WriteText(kPolicyFile, first);
+  CHECK(DrainOutput(&huart1).empty());
+  WriteText(kPolicyFile, second);
+  CHECK(DrainOutput(&huart1) == first + second);
+
+  WriteText(kPolicyFile, first);
+  HalDmaPrintfFlush();
+  CHECK(DrainOutput(&huart1) == first);
+}
+
+void TestLastValue() {
+  Setup(HAL_DMA_PRINTF_FLUSH_IMMEDIATE, 0, HAL_DMA_PRINTF_OVERFLOW_LAST_VALUE);
+  const std::string in_flight = Line('0', 100);
+  WriteText(1, in_flight);
+
+  // Same length and still queued: replaced in place
+  WriteText(kPolicyFile, "speed=01\r\n");
+  WriteText(kPolicyFile, "speed=02\r\n");
+  CHECK(GetStats().coalesced_updates == 1);
+  WriteText(kPolicyFile, "speed=3\r\n");
+  CHECK(DrainOutput(&huart1) == in_flight + "speed=02\r\nspeed=3\r\n");
+
+  // Already sent: appended
+  WriteText(kPolicyFile, "speed=4\r\n");
+  CHECK(GetStats().coalesced_updates == 1);
+  CHECK(DrainOutput(&huart1) == "speed=4\r\n");
+}
+
+void TestLastValueRingEnd() {
+  Setup(HAL_DMA_PRINTF_FLUSH_IMMEDIATE, 0, HAL_DMA_PRINTF_OVERFLOW_LAST_VALUE);
+  WriteText(1, Line('0', 200));
+  DrainOutput(&huart1);
+
+  // The value runs from 250 past the ring end to 4
+  const std::string in_flight = Line('1', 50);
+  WriteText(1, in_flight);
+  WriteText(kPolicyFile, "speed=01\r\n");
+
+  // 50 bytes take 4.3 ms at 115200 baud; then the 6 bytes up to the ring
+  // end go out while the rest of the value is still queued
+  HalDmaPrintfHostAdvance(4500);
+  WriteText(kPolicyFile, "speed=02\r\n");
+  CHECK(GetStats().coalesced_updates == 0);
+  CHECK(DrainOutput(&huart1) == in_flight + "speed=01\r\nspeed=02\r\n");
+}
+
+void TestBlock() {
+  Setup(HAL_DMA_PRINTF_FLUSH_IMMEDIATE, 0, HAL_DMA_PRINTF_OVERFLOW_BLOCK);
+  const std::string first = Line('a', 100);
+  const std::string second = Line('b', 100);
+  const std::string third = Line('c', 100);
+  WriteText(kPolicyFile, first);
+  WriteText(kPolicyFile, second);
+
+  // Waits for the first transfer to free its space
+  const uint64_t start_us = HalDmaPrintfHostGetTimeUs();
+  CHECK(WriteText(kPolicyFile, third) == 100);
+  CHECK(HalDmaPrintfHostGetTimeUs() - start_us >= 8000);
+  CHECK(DrainOutput(&huart1) == first + second + third);
+  CHECK(GetStats().lost_bytes == 0);
+}
+
+const TestCase kCases[] = {
+    {"drop_new", TestDropNew},
+    {"coalesce", TestCoalesce},
+    {"last_value", TestLastValue},
+    {"last_value_ring_end", TestLastValueRingEnd},
+    {"block", TestBlock},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
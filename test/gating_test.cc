@@ -0,0 +1,99 @@
+/**
+ * @file gating_test.cc
+ * @brief Listener-aware output gating tests (HAL_DMA_PRINTF_ENABLE_GATING)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+constexpr uint32_t kTimeoutMs = 100;
+
+bool g_connected = false;
+
+bool IsConnected() { return g_connected; }
+
+void Setup(HalDmaPrintfGatingMode mode) {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+  CHECK(HalDmaPrintfSetGating(mode, kTimeoutMs, IsConnected) ==
+        HAL_DMA_PRINTF_OK);
+}
+
+void SendHeartbeat() {
+  const uint8_t heartbeat = 0;
+  CHECK(HalDmaPrintfHostInjectRx(&huart1, &heartbeat, 1) == 1);
+}
+
+void TestRxActivity() {
+  Setup(HAL_DMA_PRINTF_GATING_RX_ACTIVITY);
+
+  // Nobody has sent anything yet
+  WriteText(1, "dropped\r\n");
+  CHECK(DrainOutput(&huart1).empty());
+
+  SendHeartbeat();
+  WriteText(1, "sent\r\n");
+  CHECK(DrainOutput(&huart1) == "sent\r\n");
+
+  // The listener is gone after kTimeoutMs of RX silence
+  HalDmaPrintfHostAdvance((kTimeoutMs + 10) * 1000);
+  WriteText(1, "dropped\r\n");
+  CHECK(DrainOutput(&huart1).empty());
+
+  // Gated output does not take TX buffer space or count as lost
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  CHECK(stats.lost_bytes == 0);
+}
+
+void TestHeartbeatNotRead() {
+  Setup(HAL_DMA_PRINTF_GATING_RX_ACTIVITY);
+  const uint8_t input[] = {0, 'o', 'k', 0, '\r'};
+  CHECK(HalDmaPrintfHostInjectRx(&huart1, input, sizeof(input)) ==
+        sizeof(input));
+
+  char line[16];
+  CHECK(_read(0, line, sizeof(line)) == 3);
+  CHECK(memcmp(line, "ok\n", 3) == 0);
+}
+
+void TestCallback() {
+  Setup(HAL_DMA_PRINTF_GATING_CALLBACK);
+  WriteText(1, "dropped\r\n");
+  CHECK(DrainOutput(&huart1).empty());
+
+  g_connected = true;
+  WriteText(1, "sent\r\n");
+  CHECK(DrainOutput(&huart1) == "sent\r\n");
+
+  g_connected = false;
+  WriteText(1, "dropped\r\n");
+  CHECK(DrainOutput(&huart1).empty());
+}
+
+void TestInvalidArgs() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetGating(HAL_DMA_PRINTF_GATING_OFF, 0, nullptr) ==
+        HAL_DMA_PRINTF_ERROR_NOT_READY);
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+  CHECK(HalDmaPrintfSetGating(HAL_DMA_PRINTF_GATING_CALLBACK, 0, nullptr) ==
+        HAL_DMA_PRINTF_ERROR_NULL_PTR);
+  CHECK(HalDmaPrintfSetGating(HAL_DMA_PRINTF_GATING_RX_ACTIVITY, 0,
+                              nullptr) == HAL_DMA_PRINTF_ERROR_INVALID_ARG);
+}
+
+const TestCase kCases[] = {
+    {"rx_activity", TestRxActivity},
+    {"heartbeat_not_read", TestHeartbeatNotRead},
+    {"callback", TestCallback},
+    {"invalid_args", TestInvalidArgs},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
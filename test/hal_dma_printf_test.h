@@ -0,0 +1,145 @@
+/**
+ * @file hal_dma_printf_test.h
+ * @brief Checks and case runner shared by the host tests
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * The library keeps its state in globals and has no teardown, so every
+ * case runs in a process of its own: ctest passes the case name as the
+ * only argument.
+ */
+
+#ifndef HAL_DMA_PRINTF_TEST_H
+#define HAL_DMA_PRINTF_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "hal_dma_printf/hal_dma_printf.h"
+#include "hal_dma_printf/hal_dma_printf_host.h"
+
+// Library I/O hooks (src/hal_dma_printf.cc)
+extern "C" int _write(int file, char* ptr, int len);
+extern "C" int _read(int file, char* ptr, int len);
+
+/**
+ * @brief Stop the case with a message if a condition does not hold
+ */
+#define CHECK(condition)                                              \
+  do {                                                                \
+    if (!(condition)) {                                               \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, \
+              #condition);                                            \
+      exit(EXIT_FAILURE);                                             \
+    }                                                                 \
+  } while (0)
+
+/**
+ * @brief One named test case
+ */
+struct TestCase {
+  const char* name;
+  void (*run)();
+};
+
+/**
+ * @brief Run the case named on the command line
+ * @param cases Cases of the executable
+ * @param count Number of cases
+ * @param argc Argument count of main
+ * @param argv Arguments of main
+ * @return Exit status for main
+ */
+inline int RunTestCase(const TestCase* cases, size_t count, int argc,
+                       char** argv) {
+  if (argc == 2) {
+    for (size_t i = 0; i < count; ++i) {
+      if (strcmp(cases[i].name, argv[1]) == 0) {
+        cases[i].run();
+        return EXIT_SUCCESS;
+      }
+    }
+  }
+  fprintf(stderr, "usage: %s <case>\ncases:", argv[0]);
+  for (size_t i = 0; i < count; ++i) { fprintf(stderr, " %s", cases[i].name); }
+  fprintf(stderr, "\n");
+  return EXIT_FAILURE;
+}
+
+/**
+ * @brief Write a string through _write
+ * @param file File descriptor
+ * @param text Text to write
+ * @return Value returned by _write
+ */
+inline int WriteText(int file, const std::string& text) {
+  return _write(file, const_cast<char*>(text.data()),
+                static_cast<int>(text.size()));
+}
+
+/**
+ * @brief Send everything queued and take the captured output
+ * @param huart UART handle
+ * @return Bytes sent since the last call
+ */
+inline std::string DrainOutput(UART_HandleTypeDef* huart) {
+  CHECK(HalDmaPrintfHostRunUntilIdle(10000000));
+  std::string output;
+  uint8_t buffer[256];
+  size_t n;
+  while ((n = HalDmaPrintfHostReadOutput(huart, buffer, sizeof(buffer))) > 0) {
+    output.append(reinterpret_cast<const char*>(buffer), n);
+  }
+  return output;
+}
+
+/**
+ * @brief Build a binary frame as the library sends it
+ * @param type Frame type
+ * @param payload Frame payload
+ * @return Sync byte, type, length, payload and checksum
+ */
+inline std::string EncodeFrame(uint8_t type, const std::string& payload) {
+  const size_t size = payload.size();
+  std::string frame = {'\0', static_cast<char>(type),
+                       static_cast<char>(size & 0xFF),
+                       static_cast<char>(size >> 8)};
+  frame += payload;
+  uint8_t sum = 0;
+  for (size_t i = 1; i < frame.size(); ++i) {
+    sum += static_cast<uint8_t>(frame[i]);
+  }
+  frame += static_cast<char>(-sum);
+  return frame;
+}
+
+/**
+ * @brief Take one binary frame, checking sync byte, length and checksum
+ * @param data Captured output
+ * @param[in,out] pos Start of the frame; moved past it
+ * @param[out] type Frame type
+ * @return Frame payload
+ */
+inline std::string DecodeFrame(const std::string& data, size_t* pos,
+                               uint8_t* type) {
+  CHECK(*pos + 5 <= data.size());
+  CHECK(data[*pos] == '\0');
+  const size_t size = static_cast<uint8_t>(data[*pos + 2]) |
+                      (static_cast<uint8_t>(data[*pos + 3]) << 8);
+  CHECK(*pos + 5 + size <= data.size());
+  const std::string frame = data.substr(*pos, 5 + size);
+  uint8_t sum = 0;
+  for (size_t i = 1; i < frame.size(); ++i) {
+    sum += static_cast<uint8_t>(frame[i]);
+  }
+  CHECK(sum == 0);
+  *type = static_cast<uint8_t>(frame[1]);
+  *pos += frame.size();
+  return frame.substr(4, size);
+}
+
+#endif  // HAL_DMA_PRINTF_TEST_H
@@ -0,0 +1,61 @@
+/**
+ * @file host_test.cc
+ * @brief Tests of the simulated UART itself
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+int g_half_events = 0;
+int g_complete_events = 0;
+
+void OnRxHalf(UART_HandleTypeDef*) { ++g_half_events; }
+void OnRxComplete(UART_HandleTypeDef*) { ++g_complete_events; }
+
+void Setup() {
+  MX_USART2_UART_Init();
+  CHECK(HAL_UART_RegisterCallback(&huart2, HAL_UART_RX_HALFCOMPLETE_CB_ID,
+                                  OnRxHalf) == HAL_OK);
+  CHECK(HAL_UART_RegisterCallback(&huart2, HAL_UART_RX_COMPLETE_CB_ID,
+                                  OnRxComplete) == HAL_OK);
+}
+
+void TestRxEvents() {
+  Setup();
+  uint8_t buffer[4] = {};
+  CHECK(HAL_UART_Receive_DMA(&huart2, buffer, sizeof(buffer)) == HAL_OK);
+
+  const uint8_t input[] = {'a', 'b', 'c', 'd'};
+  HalDmaPrintfHostInjectRx(&huart2, input, 2);
+  CHECK(g_half_events == 1 && g_complete_events == 0);
+  HalDmaPrintfHostInjectRx(&huart2, input + 2, 2);
+  CHECK(g_half_events == 1 && g_complete_events == 1);
+  CHECK(memcmp(buffer, input, sizeof(input)) == 0);
+}
+
+void TestRxSingleByte() {
+  Setup();
+  uint8_t byte = 0;
+  CHECK(HAL_UART_Receive_DMA(&huart2, &byte, 1) == HAL_OK);
+
+  // Completion only; there is no half of one byte
+  const uint8_t input = 'x';
+  CHECK(HalDmaPrintfHostInjectRx(&huart2, &input, 1) == 1);
+  CHECK(g_half_events == 0);
+  CHECK(g_complete_events == 1);
+  CHECK(byte == 'x');
+}
+
+const TestCase kCases[] = {
+    {"rx_events", TestRxEvents},
+    {"rx_single_byte", TestRxSingleByte},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
@@ -0,0 +1,91 @@
+/**
+ * @file latency_test.cc
+ * @brief Command round-trip latency tests (HAL_DMA_PRINTF_ENABLE_LATENCY)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf/hal_dma_printf_latency.h"
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+void Setup() {
+  MX_USART1_UART_Init();
+  // The RX block pool needs the RX DMA stream in Normal mode
+  huart1.hdmarx->Init.Mode = DMA_NORMAL;
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+  CHECK(HalDmaPrintfLatencyStart() == HAL_DMA_PRINTF_OK);
+}
+
+void Inject(const std::string& text) {
+  HalDmaPrintfHostInjectRx(&huart1,
+                           reinterpret_cast<const uint8_t*>(text.data()),
+                           text.size());
+}
+
+/**
+ * @brief Read one line the way newlib does with unbuffered stdin
+ * @return Line including its ending
+ */
+std::string ReadLineByteByByte() {
+  std::string line;
+  char ch = 0;
+  while (ch != '\n') {
+    CHECK(_read(0, &ch, 1) == 1);
+    line += ch;
+  }
+  return line;
+}
+
+void Respond() {
+  WriteText(1, "ok\r\n");
+  CHECK(DrainOutput(&huart1) == "ok\r\n");
+}
+
+void TestByteByByte() {
+  Setup();
+  Inject("led on\r\n");
+  CHECK(ReadLineByteByByte() == "led on\n");
+  // The \n of \r\n is a bare line ending and keeps the measurement going
+  CHECK(ReadLineByteByByte() == "\n");
+  Respond();
+
+  Inject("  status\r");
+  CHECK(ReadLineByteByByte() == "  status\n");
+  Respond();
+
+  HalDmaPrintfLatencyReport report;
+  CHECK(HalDmaPrintfLatencyGet(0, &report) == HAL_DMA_PRINTF_OK);
+  CHECK(strcmp(report.name, "led") == 0);
+  CHECK(report.count == 1);
+  CHECK(HalDmaPrintfLatencyGet(1, &report) == HAL_DMA_PRINTF_OK);
+  CHECK(strcmp(report.name, "status") == 0);
+  CHECK(report.count == 1);
+  CHECK(HalDmaPrintfLatencyGet(2, &report) ==
+        HAL_DMA_PRINTF_ERROR_INVALID_ARG);
+}
+
+void TestWholeLine() {
+  Setup();
+  Inject("led off\r");
+  char line[32];
+  CHECK(_read(0, line, sizeof(line)) == 8);
+  Respond();
+
+  HalDmaPrintfLatencyReport report;
+  CHECK(HalDmaPrintfLatencyGet(0, &report) == HAL_DMA_PRINTF_OK);
+  CHECK(strcmp(report.name, "led") == 0);
+  CHECK(report.count == 1);
+}
+
+const TestCase kCases[] = {
+    {"byte_by_byte", TestByteByByte},
+    {"whole_line", TestWholeLine},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
@@ -0,0 +1,126 @@
+/**
+ * @file negotiation_test.cc
+ * @brief Output encoding negotiation tests
+ * (HAL_DMA_PRINTF_ENABLE_NEGOTIATION)
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * Built with sequence tags, so the frames encoding shows in the output.
+ */
+
+#include "hal_dma_printf_internal.h"
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+using hal_dma_printf_internal::kFrameTypeEncoding;
+using hal_dma_printf_internal::kFrameTypeSequence;
+
+void Setup() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+}
+
+/**
+ * @brief Send a hello as `hal_dma_printf_tool.py --negotiate` does
+ * @param flags Requested HAL_DMA_PRINTF_ENCODING_* flags
+ */
+void SendHello(uint8_t flags) {
+  const std::string hello =
+      EncodeFrame(kFrameTypeEncoding, std::string(1, static_cast<char>(flags)));
+  CHECK(HalDmaPrintfHostInjectRx(
+            &huart1, reinterpret_cast<const uint8_t*>(hello.data()),
+            hello.size()) == hello.size());
+}
+
+std::string SequenceFrame(uint16_t sequence) {
+  const std::string payload = {static_cast<char>(sequence & 0xFF),
+                               static_cast<char>(sequence >> 8)};
+  return EncodeFrame(kFrameTypeSequence, payload);
+}
+
+void TestTextUntilHello() {
+  Setup();
+  CHECK(HalDmaPrintfGetEncoding() == HAL_DMA_PRINTF_ENCODING_TEXT);
+  WriteText(1, "plain\r\n");
+  CHECK(DrainOutput(&huart1) == "plain\r\n");
+
+  // The dictionary is not in this build: only frames are granted, and the
+  // reply marks where tagged output starts
+  SendHello(HAL_DMA_PRINTF_ENCODING_FRAMES |
+            HAL_DMA_PRINTF_ENCODING_DICTIONARY);
+  WriteText(1, "tagged\r\n");
+  const std::string output = DrainOutput(&huart1);
+  size_t pos = 0;
+  uint8_t type;
+  CHECK(DecodeFrame(output, &pos, &type) ==
+        std::string(1, HAL_DMA_PRINTF_ENCODING_FRAMES));
+  CHECK(type == kFrameTypeEncoding);
+  DecodeFrame(output, &pos, &type);
+  CHECK(type == kFrameTypeSequence);
+  CHECK(output.substr(pos) == "tagged\r\n");
+  CHECK(HalDmaPrintfGetEncoding() == HAL_DMA_PRINTF_ENCODING_FRAMES);
+
+  // Further hellos are answered without changing the encoding
+  SendHello(HAL_DMA_PRINTF_ENCODING_FRAMES);
+  WriteText(1, "again\r\n");
+  CHECK(DrainOutput(&huart1) ==
+        EncodeFrame(kFrameTypeEncoding,
+                    std::string(1, HAL_DMA_PRINTF_ENCODING_FRAMES)) +
+            SequenceFrame(1) + "again\r\n");
+}
+
+void TestSwitchBack() {
+  Setup();
+  SendHello(HAL_DMA_PRINTF_ENCODING_FRAMES);
+  CHECK(HalDmaPrintfGetEncoding() == HAL_DMA_PRINTF_ENCODING_FRAMES);
+  DrainOutput(&huart1);
+
+  SendHello(HAL_DMA_PRINTF_ENCODING_TEXT);
+  WriteText(1, "plain\r\n");
+  CHECK(DrainOutput(&huart1) ==
+        EncodeFrame(kFrameTypeEncoding,
+                    std::string(1, HAL_DMA_PRINTF_ENCODING_TEXT)) +
+            "plain\r\n");
+  CHECK(HalDmaPrintfGetEncoding() == HAL_DMA_PRINTF_ENCODING_TEXT);
+}
+
+void TestTimeout() {
+  Setup();
+  SendHello(HAL_DMA_PRINTF_ENCODING_FRAMES);
+  CHECK(HalDmaPrintfGetEncoding() == HAL_DMA_PRINTF_ENCODING_FRAMES);
+  DrainOutput(&huart1);
+
+  // Without hellos the host is considered gone: plain text again
+  HalDmaPrintfHostAdvance((HAL_DMA_PRINTF_NEGOTIATION_TIMEOUT_MS + 10) *
+                          1000);
+  WriteText(1, "plain\r\n");
+  CHECK(DrainOutput(&huart1) == "plain\r\n");
+  CHECK(HalDmaPrintfGetEncoding() == HAL_DMA_PRINTF_ENCODING_TEXT);
+}
+
+void TestHelloNotRead() {
+  Setup();
+  SendHello(HAL_DMA_PRINTF_ENCODING_FRAMES);
+  const uint8_t input[] = {'o', 'k', '\r'};
+  CHECK(HalDmaPrintfHostInjectRx(&huart1, input, sizeof(input)) ==
+        sizeof(input));
+
+  char line[16];
+  CHECK(_read(0, line, sizeof(line)) == 3);
+  CHECK(memcmp(line, "ok\n", 3) == 0);
+}
+
+const TestCase kCases[] = {
+    {"text_until_hello", TestTextUntilHello},
+    {"switch_back", TestSwitchBack},
+    {"timeout", TestTimeout},
+    {"hello_not_read", TestHelloNotRead},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
@@ -0,0 +1,137 @@
+/**
+ * @file scheduler_test.cc
+ * @brief Weighted fair output class tests (HAL_DMA_PRINTF_ENABLE_SCHEDULER)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include <vector>
+
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+void Setup() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+  CHECK(HalDmaPrintfSetFdClass(3, 1) == HAL_DMA_PRINTF_OK);
+  CHECK(HalDmaPrintfSetFdClass(4, 2) == HAL_DMA_PRINTF_OK);
+}
+
+std::string Line(char ch, size_t size) {
+  return std::string(size - 2, ch) + "\r\n";
+}
+
+/**
+ * @brief Split output into lines, checking each one is a whole message
+ * @param output Captured output
+ * @param size Length of every message
+ * @return First character of each message, in order of arrival
+ */
+std::string GetMessageOrder(const std::string& output, size_t size) {
+  CHECK(output.size() % size == 0);
+  std::string order;
+  for (size_t pos = 0; pos < output.size(); pos += size) {
+    const std::string line = output.substr(pos, size);
+    CHECK(line == Line(line[0], size));
+    order += line[0];
+  }
+  return order;
+}
+
+void TestWholeMessages() {
+  Setup();
+  for (int i = 0; i < 6; ++i) {
+    WriteText(3, Line(static_cast<char>('a' + i), 30));
+    WriteText(4, Line(static_cast<char>('A' + i), 30));
+    WriteText(1, Line(static_cast<char>('0' + i), 30));
+  }
+
+  const std::string order = GetMessageOrder(DrainOutput(&huart1), 30);
+  std::string classes[3];
+  for (const char ch : order) {
+    classes[(ch >= 'a') ? 1 : (ch >= 'A') ? 2 : 0] += ch;
+  }
+  CHECK(classes[0] == "012345");
+  CHECK(classes[1] == "abcdef");
+  CHECK(classes[2] == "ABCDEF");
+
+  for (int class_id = 0; class_id < 3; ++class_id) {
+    HalDmaPrintfClassStats stats;
+    CHECK(HalDmaPrintfGetClassStats(class_id, &stats) == HAL_DMA_PRINTF_OK);
+    CHECK(stats.sent_bytes == 180);
+    CHECK(stats.dropped_bytes == 0);
+    CHECK(stats.queued_bytes == 0);
+  }
+}
+
+void TestWeights() {
+  Setup();
+  const HalDmaPrintfClassConfig heavy = {3, 0};
+  const HalDmaPrintfClassConfig light = {1, 0};
+  CHECK(HalDmaPrintfSetClassConfig(1, &heavy) == HAL_DMA_PRINTF_OK);
+  CHECK(HalDmaPrintfSetClassConfig(2, &light) == HAL_DMA_PRINTF_OK);
+
+  // Keeps the DMA busy while both classes fill up
+  WriteText(1, Line('0', 32));
+  for (int i = 0; i < 7; ++i) {
+    WriteText(3, Line(static_cast<char>('a' + i), 32));
+    WriteText(4, Line(static_cast<char>('A' + i), 32));
+  }
+
+  // One round: 3 x 64 bytes of credit for class 1, 64 for class 2
+  const std::string order = GetMessageOrder(DrainOutput(&huart1), 32);
+  CHECK(order.substr(0, 9) == "0abcdefAB");
+  CHECK(order.size() == 15);
+}
+
+void TestQueueFull() {
+  Setup();
+  WriteText(1, Line('0', 32));
+  std::string expected = Line('0', 32);
+  for (int i = 0; i < 9; ++i) {
+    const std::string line = Line(static_cast<char>('a' + i), 30);
+    WriteText(3, line);
+    if (i < 8) { expected += line; }
+  }
+
+  // 255 bytes of queue: the ninth message is dropped
+  CHECK(DrainOutput(&huart1) == expected);
+  HalDmaPrintfClassStats stats;
+  CHECK(HalDmaPrintfGetClassStats(1, &stats) == HAL_DMA_PRINTF_OK);
+  CHECK(stats.dropped_bytes == 30);
+  CHECK(stats.sent_bytes == 240);
+}
+
+void TestClass0Wrap() {
+  Setup();
+  WriteText(1, Line('0', 100));
+  WriteText(1, Line('1', 100));
+  DrainOutput(&huart1);
+
+  // The class 0 message is cut at the ring end; its rest goes before the
+  // class 1 message queued meanwhile
+  const std::string wrapped = Line('2', 100);
+  const std::string other = Line('a', 100);
+  WriteText(1, wrapped);
+  WriteText(3, other);
+  CHECK(DrainOutput(&huart1) == wrapped + other);
+
+  HalDmaPrintfClassStats stats;
+  CHECK(HalDmaPrintfGetClassStats(0, &stats) == HAL_DMA_PRINTF_OK);
+  CHECK(stats.sent_bytes == 300);
+  CHECK(stats.transfers == 4);
+}
+
+const TestCase kCases[] = {
+    {"whole_messages", TestWholeMessages},
+    {"weights", TestWeights},
+    {"queue_full", TestQueueFull},
+    {"class0_wrap", TestClass0Wrap},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
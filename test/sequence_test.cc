@@ -0,0 +1,131 @@
+/**
+ * @file sequence_test.cc
+ * @brief Message sequence tag tests (HAL_DMA_PRINTF_ENABLE_SEQUENCE)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include <vector>
+
+#include "hal_dma_printf_internal.h"
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+void Setup() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+}
+
+std::string Line(char ch, size_t size) {
+  return std::string(size - 2, ch) + "\r\n";
+}
+
+/**
+ * @brief One tagged message as the host tool's check command sees it
+ */
+struct TaggedMessage {
+  uint16_t sequence;
+  int lost;  // -1 if the tag has no lost count
+  std::string text;
+};
+
+/**
+ * @brief Split output into sequence tags and the message after each
+ * @param output Captured output
+ * @return Messages in order of arrival
+ */
+std::vector<TaggedMessage> DecodeTags(const std::string& output) {
+  std::vector<TaggedMessage> messages;
+  size_t pos = 0;
+  while (pos < output.size()) {
+    uint8_t type;
+    const std::string payload = DecodeFrame(output, &pos, &type);
+    CHECK(type == hal_dma_printf_internal::kFrameTypeSequence);
+    CHECK(payload.size() == 2 || payload.size() == 4);
+
+    TaggedMessage message = {};
+    message.sequence = static_cast<uint8_t>(payload[0]) |
+                       (static_cast<uint8_t>(payload[1]) << 8);
+    message.lost = (payload.size() == 4)
+                       ? (static_cast<uint8_t>(payload[2]) |
+                          (static_cast<uint8_t>(payload[3]) << 8))
+                       : -1;
+    const size_t end = output.find('\0', pos);
+    message.text = output.substr(pos, end - pos);
+    pos = (end == std::string::npos) ? output.size() : end;
+    messages.push_back(message);
+  }
+  return messages;
+}
+
+void TestTags() {
+  Setup();
+  WriteText(1, "first\r\n");
+  WriteText(1, "second\r\n");
+  WriteText(1, "third\r\n");
+
+  // Message 0 carries the lost count, as every 64th does
+  const std::string output = DrainOutput(&huart1);
+  const std::string tag0 = {0, 0, 0, 0};
+  CHECK(output.substr(0, 9) ==
+        EncodeFrame(hal_dma_printf_internal::kFrameTypeSequence, tag0));
+  const std::vector<TaggedMessage> messages = DecodeTags(output);
+  CHECK(messages.size() == 3);
+  CHECK(messages[0].sequence == 0 && messages[0].lost == 0);
+  CHECK(messages[0].text == "first\r\n");
+  CHECK(messages[1].sequence == 1 && messages[1].lost == -1);
+  CHECK(messages[1].text == "second\r\n");
+  CHECK(messages[2].sequence == 2 && messages[2].lost == -1);
+  CHECK(messages[2].text == "third\r\n");
+}
+
+void TestDroppedMessage() {
+  Setup();
+  const std::string first = Line('a', 100);
+  const std::string second = Line('b', 100);
+  WriteText(1, first);
+  WriteText(1, second);
+  WriteText(1, Line('c', 100));
+
+  // The dropped message's number is skipped; the next tag explains the gap
+  const std::vector<TaggedMessage> messages = DecodeTags(DrainOutput(&huart1));
+  CHECK(messages.size() == 2);
+  CHECK(messages[0].sequence == 0 && messages[0].text == first);
+  CHECK(messages[1].sequence == 1 && messages[1].lost == -1);
+  CHECK(messages[1].text == second);
+
+  WriteText(1, "after\r\n");
+  const std::vector<TaggedMessage> after = DecodeTags(DrainOutput(&huart1));
+  CHECK(after.size() == 1);
+  CHECK(after[0].sequence == 3 && after[0].lost == 1);
+  CHECK(after[0].text == "after\r\n");
+}
+
+void TestLostInterval() {
+  Setup();
+  for (int i = 0; i < 64; ++i) {
+    WriteText(1, "x\r\n");
+    CHECK(!DrainOutput(&huart1).empty());
+  }
+
+  // Message 64 repeats the unchanged lost count
+  WriteText(1, "y\r\n");
+  WriteText(1, "z\r\n");
+  const std::vector<TaggedMessage> messages = DecodeTags(DrainOutput(&huart1));
+  CHECK(messages.size() == 2);
+  CHECK(messages[0].sequence == 64 && messages[0].lost == 0);
+  CHECK(messages[1].sequence == 65 && messages[1].lost == -1);
+}
+
+const TestCase kCases[] = {
+    {"tags", TestTags},
+    {"dropped_message", TestDroppedMessage},
+    {"lost_interval", TestLostInterval},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
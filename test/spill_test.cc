@@ -0,0 +1,91 @@
+/**
+ * @file spill_test.cc
+ * @brief Store-and-forward spill tests (HAL_DMA_PRINTF_ENABLE_SPILL)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+constexpr uint32_t kBlockSize = 64;
+constexpr uint32_t kBlockCount = 8;
+
+uint8_t g_blocks[kBlockCount][kBlockSize];
+int g_reads = 0;
+
+int WriteBlock(void*, uint32_t block, const uint8_t* data) {
+  memcpy(g_blocks[block], data, kBlockSize);
+  return 0;
+}
+
+int ReadBlock(void*, uint32_t block, uint8_t* data) {
+  memcpy(data, g_blocks[block], kBlockSize);
+  ++g_reads;
+  return 0;
+}
+
+void Setup() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+  const HalDmaPrintfSpillDevice device = {kBlockCount, WriteBlock, ReadBlock,
+                                          nullptr};
+  CHECK(HalDmaPrintfSetSpillDevice(&device) == HAL_DMA_PRINTF_OK);
+}
+
+void TestSpillInOrder() {
+  Setup();
+  const std::string first(200, 'a');
+  const std::string second(100, 'b');
+  const std::string third(20, 'c');
+
+  // The second message does not fit and is spilled; the third queues
+  // behind it
+  WriteText(1, first);
+  WriteText(1, second);
+  WriteText(1, third);
+  CHECK(DrainOutput(&huart1) == first);
+
+  HalDmaPrintfSpillPoll();
+  CHECK(DrainOutput(&huart1) == second + third);
+
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  CHECK(stats.spilled_bytes == 120);
+  CHECK(stats.lost_bytes == 0);
+}
+
+void TestNoDrainWithInterruptsDisabled() {
+  Setup();
+  const std::string first(200, 'a');
+  const std::string second(100, 'b');
+  const std::string masked(10, 'c');
+  const std::string thread(10, 'd');
+
+  WriteText(1, first);
+  WriteText(1, second);
+  CHECK(DrainOutput(&huart1) == first);
+
+  // TX buffer is empty, but device reads may block: nothing is drained
+  __disable_irq();
+  WriteText(1, masked);
+  __enable_irq();
+  CHECK(g_reads == 0);
+  CHECK(DrainOutput(&huart1).empty());
+
+  WriteText(1, thread);
+  CHECK(g_reads == 1);
+  CHECK(DrainOutput(&huart1) == second + masked + thread);
+}
+
+const TestCase kCases[] = {
+    {"spill_in_order", TestSpillInOrder},
+    {"no_drain_with_interrupts_disabled", TestNoDrainWithInterruptsDisabled},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
@@ -0,0 +1,115 @@
+/**
+ * @file status_test.cc
+ * @brief Last-value status channel tests (HAL_DMA_PRINTF_ENABLE_STATUS)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf_internal.h"
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+void Setup() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+}
+
+std::string Line(char ch, size_t size) {
+  return std::string(size - 2, ch) + "\r\n";
+}
+
+int Update(uint8_t key, const std::string& value) {
+  return HalDmaPrintfStatusUpdate(key, value.data(),
+                                  static_cast<uint16_t>(value.size()));
+}
+
+std::string StatusFrame(uint8_t key, const std::string& value) {
+  return EncodeFrame(hal_dma_printf_internal::kFrameTypeStatus,
+                     std::string(1, static_cast<char>(key)) + value);
+}
+
+uint32_t GetCoalescedUpdates() {
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  return stats.coalesced_updates;
+}
+
+void TestOverwrite() {
+  Setup();
+  const std::string in_flight = Line('0', 100);
+  WriteText(1, in_flight);
+
+  // Both updates land in the frame queued behind the transfer in flight
+  CHECK(Update(0, "t=21") == HAL_DMA_PRINTF_OK);
+  CHECK(Update(0, "t=22") == HAL_DMA_PRINTF_OK);
+  CHECK(GetCoalescedUpdates() == 1);
+  CHECK(DrainOutput(&huart1) == in_flight + StatusFrame(0, "t=22"));
+
+  // Once sent, the next update needs a frame of its own
+  CHECK(Update(0, "t=23") == HAL_DMA_PRINTF_OK);
+  CHECK(GetCoalescedUpdates() == 1);
+  CHECK(DrainOutput(&huart1) == StatusFrame(0, "t=23"));
+}
+
+void TestNewFrame() {
+  Setup();
+  const std::string in_flight = Line('0', 100);
+  WriteText(1, in_flight);
+
+  // Another key, or another size of the same key, is appended
+  CHECK(Update(0, "t=21") == HAL_DMA_PRINTF_OK);
+  CHECK(Update(1, "v=5") == HAL_DMA_PRINTF_OK);
+  CHECK(Update(0, "t=9") == HAL_DMA_PRINTF_OK);
+  CHECK(GetCoalescedUpdates() == 0);
+  CHECK(DrainOutput(&huart1) == in_flight + StatusFrame(0, "t=21") +
+                                    StatusFrame(1, "v=5") +
+                                    StatusFrame(0, "t=9"));
+}
+
+void TestTableFull() {
+  Setup();
+  CHECK(Update(HAL_DMA_PRINTF_STATUS_MAX_KEYS - 1, "x") == HAL_DMA_PRINTF_OK);
+  CHECK(Update(HAL_DMA_PRINTF_STATUS_MAX_KEYS, "x") ==
+        HAL_DMA_PRINTF_ERROR_INVALID_ARG);
+  CHECK(HalDmaPrintfStatusUpdate(0, "x", 0) ==
+        HAL_DMA_PRINTF_ERROR_INVALID_ARG);
+  CHECK(DrainOutput(&huart1) ==
+        StatusFrame(HAL_DMA_PRINTF_STATUS_MAX_KEYS - 1, "x"));
+
+  // No room for a new frame behind a full TX buffer
+  WriteText(1, Line('0', 250));
+  CHECK(Update(0, "t=21") == HAL_DMA_PRINTF_ERROR_NO_SPACE);
+}
+
+void TestRingEndInFlight() {
+  Setup();
+  WriteText(1, Line('0', 200));
+  DrainOutput(&huart1);
+
+  // The frame runs from 250 past the ring end to 8
+  const std::string in_flight = Line('1', 50);
+  WriteText(1, in_flight);
+  CHECK(Update(0, "value=01") == HAL_DMA_PRINTF_OK);
+
+  // 50 bytes take 4.3 ms at 115200 baud; then the 6 bytes up to the ring
+  // end go out while the rest of the frame is still queued
+  HalDmaPrintfHostAdvance(4500);
+  CHECK(Update(0, "value=02") == HAL_DMA_PRINTF_OK);
+  CHECK(GetCoalescedUpdates() == 0);
+  CHECK(DrainOutput(&huart1) == in_flight + StatusFrame(0, "value=01") +
+                                    StatusFrame(0, "value=02"));
+}
+
+const TestCase kCases[] = {
+    {"overwrite", TestOverwrite},
+    {"new_frame", TestNewFrame},
+    {"table_full", TestTableFull},
+    {"ring_end_in_flight", TestRingEndInFlight},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
@@ -0,0 +1,112 @@
+/**
+ * @file striping_test.cc
+ * @brief Bonded two-UART output tests (HAL_DMA_PRINTF_ENABLE_STRIPING)
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include <map>
+
+#include "hal_dma_printf_internal.h"
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+void Setup() {
+  MX_USART1_UART_Init();
+  MX_USART2_UART_Init();
+  CHECK(HalDmaPrintfSetupBonded(&huart1, &huart2, false) ==
+        HAL_DMA_PRINTF_OK);
+}
+
+std::string Line(char ch, size_t size) {
+  return std::string(size - 2, ch) + "\r\n";
+}
+
+/**
+ * @brief Decode the stripe frames of one link
+ * @param output Captured output of the link
+ * @param[in,out] chunks Data of each frame by sequence number
+ */
+void DecodeStripes(const std::string& output,
+                   std::map<uint16_t, std::string>* chunks) {
+  size_t pos = 0;
+  while (pos < output.size()) {
+    uint8_t type;
+    const std::string payload = DecodeFrame(output, &pos, &type);
+    CHECK(type == hal_dma_printf_internal::kFrameTypeStripe);
+    CHECK(payload.size() > 2);
+    const uint16_t sequence = static_cast<uint8_t>(payload[0]) |
+                              (static_cast<uint8_t>(payload[1]) << 8);
+    CHECK(chunks->count(sequence) == 0);
+    (*chunks)[sequence] = payload.substr(2);
+  }
+}
+
+/**
+ * @brief Reassemble the output as `hal_dma_printf_tool.py unstripe` does
+ * @param[out] link_frames Number of frames sent by each link
+ * @return Text in sequence order, checked to have no gaps
+ */
+std::string Unstripe(size_t link_frames[2]) {
+  std::map<uint16_t, std::string> chunks;
+  DecodeStripes(DrainOutput(&huart1), &chunks);
+  link_frames[0] = chunks.size();
+  DecodeStripes(DrainOutput(&huart2), &chunks);
+  link_frames[1] = chunks.size() - link_frames[0];
+
+  std::string text;
+  uint16_t expected = 0;
+  for (const auto& chunk : chunks) {
+    CHECK(chunk.first == expected++);
+    text += chunk.second;
+  }
+  return text;
+}
+
+void TestReassemble() {
+  Setup();
+  std::string text;
+  for (int i = 0; i < 6; ++i) {
+    const std::string line = Line(static_cast<char>('a' + i), 60);
+    WriteText(1, line);
+    text += line;
+    HalDmaPrintfHostAdvance(3000);
+  }
+
+  size_t link_frames[2];
+  CHECK(Unstripe(link_frames) == text);
+  CHECK(link_frames[0] > 0);
+  CHECK(link_frames[1] > 0);
+}
+
+void TestBothLinksBusy() {
+  Setup();
+  // Two full chunks go out at once, one per link
+  const std::string first = Line('a', HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE);
+  const std::string second = Line('b', HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE);
+  const uint64_t start_us = HalDmaPrintfHostGetTimeUs();
+  WriteText(1, first + second);
+  CHECK(HalDmaPrintfHostRunUntilIdle(1000000));
+
+  // One link would take twice as long for the same frames
+  const uint64_t chunk_us =
+      (HAL_DMA_PRINTF_STRIPE_CHUNK_SIZE + 7) * 10 * 1000000ULL / 115200;
+  CHECK(HalDmaPrintfHostGetTimeUs() - start_us < chunk_us + chunk_us / 2);
+
+  size_t link_frames[2];
+  CHECK(Unstripe(link_frames) == first + second);
+  CHECK(link_frames[0] == 1);
+  CHECK(link_frames[1] == 1);
+}
+
+const TestCase kCases[] = {
+    {"reassemble", TestReassemble},
+    {"both_links_busy", TestBothLinksBusy},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
@@ -0,0 +1,99 @@
+/**
+ * @file tx_test.cc
+ * @brief TX buffer, ring wraparound and input tests in the default
+ * configuration
+ * @version 1.0.0
+ * @date 2025-12-30
+ */
+
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+void Setup() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+}
+
+void TestBasic() {
+  Setup();
+  CHECK(HalDmaPrintfGetBufferSize() == 256);
+
+  CHECK(HalDmaPrintfHostPrintf("speed=%d\r\n", 42) == 10);
+  CHECK(DrainOutput(&huart1) == "speed=42\r\n");
+
+  HalDmaPrintfHostUartStats stats;
+  CHECK(HalDmaPrintfHostGetStats(&huart1, &stats));
+  CHECK(stats.tx_bytes == 10);
+  CHECK(stats.tx_transfers == 1);
+}
+
+void TestWrap() {
+  Setup();
+  const std::string first(100, 'a');
+  const std::string second(100, 'b');
+  const std::string third(100, 'c');
+  const std::string fourth(100, 'd');
+  const std::string fifth(150, 'e');
+
+  // The third message ends past the ring end: two transfers
+  WriteText(1, first);
+  WriteText(1, second);
+  CHECK(DrainOutput(&huart1) == first + second);
+  HalDmaPrintfHostResetStats(&huart1);
+  WriteText(1, third);
+  CHECK(DrainOutput(&huart1) == third);
+  HalDmaPrintfHostUartStats stats;
+  CHECK(HalDmaPrintfHostGetStats(&huart1, &stats));
+  CHECK(stats.tx_transfers == 2);
+
+  // Queued behind a transfer in flight, across the ring end again
+  WriteText(1, fourth);
+  WriteText(1, fifth);
+  CHECK(DrainOutput(&huart1) == fourth + fifth);
+}
+
+void TestOverflow() {
+  Setup();
+  const std::string first(100, 'a');
+  const std::string second(100, 'b');
+  const std::string third(100, 'c');
+
+  // The first message is in flight and still occupies TX buffer
+  CHECK(WriteText(1, first) == 100);
+  CHECK(WriteText(1, second) == 100);
+  WriteText(1, third);
+  CHECK(DrainOutput(&huart1) == first + second);
+
+  HalDmaPrintfStats stats;
+  HalDmaPrintfGetStats(&stats);
+  CHECK(stats.dropped_messages[HAL_DMA_PRINTF_SEVERITY_INFO] == 1);
+  CHECK(stats.lost_bytes == 100);
+
+  WriteText(1, third);
+  CHECK(DrainOutput(&huart1) == third);
+}
+
+void TestRead() {
+  Setup();
+  const uint8_t input[] = {'s', 'e', 't', ' ', '1', '\r'};
+  CHECK(HalDmaPrintfHostInjectRx(&huart1, input, sizeof(input)) ==
+        sizeof(input));
+
+  char line[16];
+  CHECK(_read(0, line, sizeof(line)) == 6);
+  CHECK(memcmp(line, "set 1\n", 6) == 0);
+}
+
+const TestCase kCases[] = {
+    {"basic", TestBasic},
+    {"wrap", TestWrap},
+    {"overflow", TestOverflow},
+    {"read", TestRead},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
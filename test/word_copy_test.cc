@@ -0,0 +1,75 @@
+/**
+ * @file word_copy_test.cc
+ * @brief Word-sized TX buffer copy tests (HAL_DMA_PRINTF_ENABLE_WORD_COPY)
+ * @version 1.0.0
+ * @date 2025-12-30
+ *
+ * @details
+ * Built twice: with unaligned loads, and with
+ * HAL_DMA_PRINTF_HAS_UNALIGNED_LOADS=0 for the ARMv6-M shifted-word path.
+ */
+
+#include <vector>
+
+#include "hal_dma_printf_test.h"
+
+namespace {
+
+void Setup() {
+  MX_USART1_UART_Init();
+  CHECK(HalDmaPrintfSetup(&huart1, false) == HAL_DMA_PRINTF_OK);
+}
+
+/**
+ * @brief Message bytes that tell position and length apart
+ */
+std::string Pattern(size_t size) {
+  std::string text;
+  for (size_t i = 0; i < size; ++i) {
+    text += static_cast<char>('!' + (i * 7 + size) % 90);
+  }
+  return text;
+}
+
+void TestSourceOffsets() {
+  Setup();
+  char source[80];
+  // Every source alignment, length and (as the ring fills) destination
+  // alignment
+  for (size_t offset = 0; offset < 4; ++offset) {
+    for (size_t size = 1; size <= 64; ++size) {
+      const std::string text = Pattern(size);
+      memcpy(source + offset, text.data(), size);
+      CHECK(_write(1, source + offset, static_cast<int>(size)) ==
+            static_cast<int>(size));
+      CHECK(DrainOutput(&huart1) == text);
+    }
+  }
+}
+
+void TestSourceEnd() {
+  Setup();
+  // Each source is a heap block of its own size, so AddressSanitizer
+  // reports any read past the end, even within the last word
+  for (size_t offset = 1; offset < 4; ++offset) {
+    for (size_t size = 1; size <= 64; ++size) {
+      const std::string text = Pattern(size);
+      std::vector<char> source(offset + size);
+      memcpy(source.data() + offset, text.data(), size);
+      CHECK(_write(1, source.data() + offset, static_cast<int>(size)) ==
+            static_cast<int>(size));
+      CHECK(DrainOutput(&huart1) == text);
+    }
+  }
+}
+
+const TestCase kCases[] = {
+    {"source_offsets", TestSourceOffsets},
+    {"source_end", TestSourceEnd},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  return RunTestCase(kCases, sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
@@ -0,0 +1,1585 @@
+#!/usr/bin/env python3
+"""Host-side companion tool for hal-dma-printf.
+
+Subcommands:
+  gen-dict  Train a static dictionary from a sample log corpus and emit the
+            constexpr header used by HAL_DMA_PRINTF_ENABLE_DICTIONARY.
+  decode    Decode a captured TX stream (file or stdin) back to plain text;
+            capture files can be decoded on several processes (-j).
+  record    Write a TX stream to a capture file with a block index, so
+            decode, watch, status, check and profile can select a time range
+            (--since/--until) and skip blocks without their frames.
+  watch     Convert variable watch frames in a TX stream to CSV.
+  unstripe  Reassemble the captures of two bonded UARTs into one stream.
+  profile   Summarise profiler samples per function using the firmware ELF.
+  status    Print status channel updates (last value per key).
+  replay    Replay a captured _write trace against buffer sizes and baud
+            rates and report overflows, fill and latency.
+  check     Check message sequence tags and tell messages dropped on the
+            target from messages lost on the link.
+  latency   Print console command round-trip latency per command and stage.
+
+Inputs are capture files, "-" for stdin, or "serial:PORT[@BAUD]" for a live
+port. Only the Python standard library is required, plus pyserial for live
+ports. Targets built with HAL_DMA_PRINTF_ENABLE_NEGOTIATION start in plain
+text; --negotiate asks them for binary frames and dictionary text.
+"""
+
+import argparse
+import bisect
+import collections
+import mmap
+import multiprocessing
+import os
+import re
+import struct
+import sys
+import time
+
+# ============================================================================
+# Dictionary coding
+# ============================================================================
+
+# Must match the constants in src/hal_dma_printf.cc
+DICT_ESCAPE = 0x7F
+DICT_ESCAPE_XOR = 0x40
+DICT_TOKEN_BASE = 0x80
+DICT_MAX_ENTRIES = 128
+DICT_MIN_LENGTH = 3
+DICT_MAX_LENGTH = 32
+
+# Candidate substrings start and end on token boundaries so the trained
+# vocabulary consists of whole words, separators and common line prefixes.
+_CANDIDATE_RE = re.compile(rb"[A-Za-z_]+|[0-9]+|\s+|[^A-Za-z0-9_\s]+")
+
+
+def _count_candidates(pieces):
+    counts = collections.Counter()
+    for piece in pieces:
+        tokens = _CANDIDATE_RE.findall(piece)
+        for start in range(len(tokens)):
+            candidate = b""
+            for end in range(start, min(start + 4, len(tokens))):
+                candidate += tokens[end]
+                if len(candidate) > DICT_MAX_LENGTH:
+                    break
+                if len(candidate) >= DICT_MIN_LENGTH:
+                    counts[candidate] += 1
+    return counts
+
+
+def _is_encodable(entry):
+    # Entries are matched against raw text only; bytes that the encoder
+    # escapes can never be part of a token.
+    return all(0 < b < DICT_ESCAPE for b in entry)
+
+
+def train_dictionary(corpus, max_entries=DICT_MAX_ENTRIES):
+    """Greedily pick the substrings that save the most bytes.
+
+    After each pick the corpus is split at every occurrence of the chosen
+    entry, so overlapping candidates are re-scored against what is left.
+    """
+    pieces = [corpus]
+    entries = []
+    while len(entries) < max_entries:
+        counts = _count_candidates(pieces)
+        best = None
+        best_saving = 0
+        for candidate, count in counts.items():
+            if count < 2 or not _is_encodable(candidate):
+                continue
+            saving = count * (len(candidate) - 1)
+            if saving > best_saving:
+                best, best_saving = candidate, saving
+        if best is None:
+            break
+        entries.append(best)
+        pieces = [p for piece in pieces for p in piece.split(best) if p]
+    return entries
+
+
+def _sorted_entries(entries):
+    # The encoder scans the entries sharing a first byte in order and takes
+    # the first match, so longer entries must come first.
+    return sorted(entries, key=lambda e: (e[0], -len(e), e))
+
+
+def _c_string(data):
+    out = []
+    for b in data:
+        if b == 0x5C:
+            out.append("\\\\")
+        elif b == 0x22:
+            out.append('\\"')
+        elif b == 0x0D:
+            out.append("\\r")
+        elif b == 0x0A:
+            out.append("\\n")
+        elif b == 0x09:
+            out.append("\\t")
+        elif 0x20 <= b < 0x7F and b != 0x3F:
+            out.append(chr(b))
+        else:
+            # Octal keeps the next character from extending the escape and
+            # avoids '?' forming a trigraph.
+            out.append("\\%03o" % b)
+    return '"' + "".join(out) + '"'
+
+
+def _rows(values, per_row=16):
+    return ["    %s," % ", ".join(str(v) for v in values[i:i + per_row])
+            for i in range(0, len(values), per_row)]
+
+
+def render_dictionary_header(entries, source_name,
+                             header_name="hal_dma_printf_dictionary.h"):
+    entries = _sorted_entries(entries)
+    guard = re.sub(r"[^A-Za-z0-9]", "_", header_name).upper()
+    first_entry = [0] * 257
+    for c in range(256):
+        first_entry[c] = sum(1 for e in entries if e[0] < c)
+    first_entry[256] = len(entries)
+
+    lines = [
+        "/**",
+        " * @file %s" % header_name,
+        " * @brief Static dictionary for hal-dma-printf text compression",
+        " *",
+        " * @details",
+        " * Generated by tools/hal_dma_printf_tool.py gen-dict from %s."
+        % source_name,
+        " * Do not edit by hand.",
+        " */",
+        "",
+        "#ifndef %s" % guard,
+        "#define %s" % guard,
+        "",
+        "#include <stdint.h>",
+        "",
+        "namespace hal_dma_printf_dictionary {",
+        "",
+        "constexpr int kEntryCount = %d;" % len(entries),
+        "",
+        "constexpr const char* kEntries[] = {",
+    ]
+    for entry in entries:
+        lines.append("    %s," % _c_string(entry))
+    if not entries:
+        lines.append('    "",')
+    lines += [
+        "};",
+        "",
+        "constexpr uint8_t kEntryLengths[] = {",
+    ]
+    lines += _rows([len(e) for e in entries] or [0])
+    lines += [
+        "};",
+        "",
+        "// Entries starting with byte c are kEntries[kFirstEntry[c]] up to",
+        "// kEntries[kFirstEntry[c + 1]], longest first.",
+        "constexpr uint8_t kFirstEntry[257] = {",
+    ]
+    lines += _rows(first_entry)
+    lines += [
+        "};",
+        "",
+        "}  // namespace hal_dma_printf_dictionary",
+        "",
+        "#endif  // %s" % guard,
+        "",
+    ]
+    return "\n".join(lines)
+
+
+_C_ESCAPES = {"\\": 0x5C, '"': 0x22, "r": 0x0D, "n": 0x0A, "t": 0x09}
+
+
+def _parse_c_string(text):
+    out = bytearray()
+    i = 0
+    while i < len(text):
+        ch = text[i]
+        if ch != "\\":
+            out.append(ord(ch))
+            i += 1
+            continue
+        nxt = text[i + 1]
+        if nxt in _C_ESCAPES:
+            out.append(_C_ESCAPES[nxt])
+            i += 2
+        else:
+            out.append(int(text[i + 1:i + 4], 8))
+            i += 4
+    return bytes(out)
+
+
+def load_dictionary_header(path):
+    with open(path, "r", encoding="ascii") as f:
+        text = f.read()
+    body = re.search(r"kEntries\[\] = \{(.*?)\};", text, re.S).group(1)
+    count = int(re.search(r"kEntryCount = (\d+);", text).group(1))
+    entries = [_parse_c_string(s) for s in re.findall(r'"((?:[^"\\]|\\.)*)"',
+                                                      body)]
+    return entries[:count]
+
+
+# Bytes the decoder has to act on. The regex engine scans the plain runs
+# between them in C; a lone escape can only match at the end of the data.
+_DICT_SPECIAL_RE = re.compile(rb"\x7f[\x00-\xff]?|[\x80-\xff]")
+
+
+class DictionaryDecoder:
+    def __init__(self, entries):
+        self._entries = entries
+        self._escaped = False
+
+    def _expand(self, match):
+        token = match.group()
+        if token[0] != DICT_ESCAPE:
+            return self._entries[token[0] - DICT_TOKEN_BASE]
+        if len(token) == 1:
+            self._escaped = True
+            return b""
+        return bytes([token[1] ^ DICT_ESCAPE_XOR])
+
+    def feed(self, data):
+        data = bytes(data)
+        prefix = b""
+        if self._escaped and data:
+            prefix = bytes([data[0] ^ DICT_ESCAPE_XOR])
+            data = data[1:]
+            self._escaped = False
+        return prefix + _DICT_SPECIAL_RE.sub(self._expand, data)
+
+
+# ============================================================================
+# Binary frames
+# ============================================================================
+
+# Must match src/hal_dma_printf_internal.h
+FRAME_SYNC = 0x00
+FRAME_OVERHEAD = 5
+FRAME_TYPE_WATCH_SAMPLE = 0x01
+FRAME_TYPE_WATCH_LAYOUT = 0x02
+FRAME_TYPE_STRIPE = 0x03
+FRAME_TYPE_PROFILE = 0x04
+FRAME_TYPE_WRITE_TRACE = 0x05
+FRAME_TYPE_STATUS = 0x06
+FRAME_TYPE_PADDING = 0x07  # HalDmaPrintfRunBenchmark filler
+FRAME_TYPE_SEQUENCE = 0x08
+FRAME_TYPE_ENCODING = 0x09
+FRAME_TYPE_LATENCY = 0x0A
+
+# HAL_DMA_PRINTF_ENCODING_* in include/hal_dma_printf/hal_dma_printf.h
+ENCODING_FRAMES = 0x01
+ENCODING_DICTIONARY = 0x02
+
+# Frames never exceed the target's TX buffer; a larger length field means the
+# sync byte was noise, so there is no point waiting for that many bytes.
+FRAME_MAX_PAYLOAD = 16384
+
+
+def encode_frame(frame_type, payload):
+    """Return one binary frame, e.g. a hello sent to the target."""
+    body = bytes([frame_type]) + struct.pack("<H", len(payload)) + payload
+    return bytes([FRAME_SYNC]) + body + bytes([-sum(body) & 0xFF])
+
+
+class StreamDecoder:
+    """Split a TX stream into text and checksummed binary frames.
+
+    With negotiated=True the stream starts as plain text and encoding frames
+    switch dictionary decoding on and off where the target switched.
+    """
+
+    def __init__(self, text_decoder=None, negotiated=False):
+        self._buffer = bytearray()
+        self._text_decoder = text_decoder
+        self._dictionary_active = not negotiated
+
+    @property
+    def pending(self):
+        """Number of bytes held back as the possible start of a frame."""
+        return len(self._buffer)
+
+    @property
+    def dictionary_active(self):
+        return self._dictionary_active
+
+    def restart(self, dictionary_active):
+        """Continue at a restart point after skipping part of the stream."""
+        self._buffer.clear()
+        self._dictionary_active = dictionary_active
+
+    def _text(self, data):
+        if self._text_decoder is not None and self._dictionary_active:
+            data = self._text_decoder.feed(data)
+        return ("text", bytes(data))
+
+    def feed(self, data, final=False):
+        """Return a list of ("text", bytes) and ("frame", type, payload).
+
+        The buffer is consumed through an index and trimmed once per call;
+        the sync search is a memchr. With final, no more data follows, so a
+        frame cut short is noise rather than something to wait for.
+        """
+        buf = self._buffer
+        buf += data
+        events = []
+        pos = 0
+        end = len(buf)
+        while pos < end:
+            sync = buf.find(FRAME_SYNC, pos)
+            if sync < 0:
+                events.append(self._text(buf[pos:]))
+                pos = end
+                break
+            if sync > pos:
+                events.append(self._text(buf[pos:sync]))
+                pos = sync
+            if end - pos < 4:
+                if not final:
+                    break
+                pos += 1
+                continue
+            length = buf[pos + 2] | (buf[pos + 3] << 8)
+            if length > FRAME_MAX_PAYLOAD:
+                pos += 1
+                continue
+            if end - pos < length + FRAME_OVERHEAD:
+                if not final:
+                    break
+                pos += 1
+                continue
+            if sum(buf[pos + 1:pos + length + FRAME_OVERHEAD]) & 0xFF:
+                pos += 1
+                continue
+            payload = bytes(buf[pos + 4:pos + 4 + length])
+            if buf[pos + 1] == FRAME_TYPE_ENCODING and len(payload) == 1:
+                self._dictionary_active = bool(payload[0] &
+                                               ENCODING_DICTIONARY)
+            events.append(("frame", buf[pos + 1], payload))
+            pos += length + FRAME_OVERHEAD
+        del buf[:pos]
+        return events
+
+
+def negotiation_hello(dictionary=None):
+    """Return the hello asking for frames (and dictionary text if given)."""
+    encoding = ENCODING_FRAMES | (ENCODING_DICTIONARY if dictionary else 0)
+    return encode_frame(FRAME_TYPE_ENCODING, bytes([encoding]))
+
+
+def read_events(path, dictionary=None, heartbeat=None, negotiate=False,
+                since=None, until=None, types=0, follow=False):
+    """Yield decoded events from a capture file, stdin or serial port.
+
+    With negotiate, a serial: input sends hellos asking for binary frames
+    (and dictionary text if a dictionary is given) in place of heartbeats.
+    A capture file written by record is read through its index: since and
+    until (seconds from its start) select blocks by time, and a content mask
+    in types skips blocks without those frames. With follow, a capture file
+    is tailed as it grows.
+    """
+    text_decoder = None
+    if dictionary:
+        text_decoder = DictionaryDecoder(load_dictionary_header(dictionary))
+    decoder = StreamDecoder(text_decoder, negotiate)
+    hello = negotiation_hello(dictionary) if negotiate else None
+    with _open_input(path, heartbeat, hello) as f:
+        index = None
+        if f is sys.stdin.buffer or isinstance(f, SerialInput):
+            follow = False
+        else:
+            index = CaptureIndex.open(path)
+        if index is not None:
+            with index:
+                yield from index.read_events(f, decoder, since, until, types)
+            if until is not None:
+                return
+        elif since is not None or until is not None:
+            sys.exit("%s has no index (%s); write it with record"
+                     % (path, path + INDEX_SUFFIX))
+        while True:
+            chunk = f.read(4096)
+            if chunk:
+                yield from decoder.feed(chunk)
+            elif follow and until is None:
+                time.sleep(FOLLOW_INTERVAL)
+            else:
+                break
+
+
+# ============================================================================
+# Sequence tags
+# ============================================================================
+
+# A restart of the target sets the sequence back to 0, which looks like a
+# jump of more than half the number space.
+SEQUENCE_RESTART_GAP = 0x8000
+
+
+def parse_sequence_frame(payload):
+    """Return (sequence, lost count or None), or None if malformed."""
+    if len(payload) == 2:
+        return struct.unpack("<H", payload)[0], None
+    if len(payload) == 4:
+        return struct.unpack("<HH", payload)
+    return None
+
+
+class SequenceChecker:
+    """Account for every message number between sequence tags.
+
+    A number that never arrives belongs to a message the target dropped or
+    evicted (its running lost count grows) or one lost on the link. The lost
+    count may arrive some tags after the gap it explains, so totals are
+    attributed, not single gaps. Counting starts at the first tag carrying
+    the lost count.
+    """
+
+    def __init__(self):
+        self.received = 0
+        self.missing = 0
+        self.dropped = 0
+        self.restarts = 0
+        self._sequence = None
+        self._lost = None
+
+    @property
+    def link_lost(self):
+        return max(self.missing - self.dropped, 0)
+
+    def feed(self, sequence, lost):
+        """Return (missing, dropped) before this tag, or None if not synced."""
+        if self._sequence is not None:
+            gap = (sequence - self._sequence - 1) & 0xFFFF
+            if gap >= SEQUENCE_RESTART_GAP:
+                self.restarts += 1
+                self._sequence = None
+        if self._sequence is None:
+            if lost is None:
+                return None
+            self._sequence, self._lost = sequence, lost
+            self.received += 1
+            return 0, 0
+
+        dropped = 0
+        if lost is not None:
+            dropped = (lost - self._lost) & 0xFFFF
+            self._lost = lost
+        self._sequence = sequence
+        self.received += 1
+        self.missing += gap
+        self.dropped += dropped
+        return gap, dropped
+
+
+# ============================================================================
+# Command latency
+# ============================================================================
+
+# Must match include/hal_dma_printf/hal_dma_printf_latency.h
+LATENCY_STAGES = ("rx", "read", "handler", "tx", "total")
+LATENCY_BUCKETS = 16
+LATENCY_FRAME = struct.Struct("<8sI%dI%dH" % (
+    len(LATENCY_STAGES), len(LATENCY_STAGES) * LATENCY_BUCKETS))
+
+
+def latency_bucket_limit_us(bucket):
+    """Upper bound of a histogram bucket (the last one is open)."""
+    return 16 << bucket
+
+
+def parse_latency_frame(payload):
+    """Return (name, count, max_us per stage, histogram per stage)."""
+    if len(payload) != LATENCY_FRAME.size:
+        return None
+    values = LATENCY_FRAME.unpack(payload)
+    stages = len(LATENCY_STAGES)
+    name = values[0].rstrip(b"\0").decode("utf-8", "replace")
+    counts = values[2 + stages:]
+    histograms = [counts[i * LATENCY_BUCKETS:(i + 1) * LATENCY_BUCKETS]
+                  for i in range(stages)]
+    return name, values[1], values[2:2 + stages], histograms
+
+
+def histogram_percentile_us(histogram, max_us, fraction):
+    """Bucket upper bound below which `fraction` of the counts fall."""
+    total = sum(histogram)
+    if total == 0:
+        return 0
+    running = 0
+    for bucket, count in enumerate(histogram):
+        running += count
+        if running >= fraction * total:
+            if bucket == len(histogram) - 1:
+                return max_us
+            return min(latency_bucket_limit_us(bucket), max_us)
+    return max_us
+
+
+# ============================================================================
+# Bonded links
+# ============================================================================
+
+# Chunks are sent by availability, so one link can run ahead of the other by
+# a few chunks; a gap larger than this is treated as lost data.
+STRIPE_REORDER_WINDOW = 64
+
+
+def unstripe(frame_lists):
+    """Merge stripe frames from several links in sequence order.
+
+    Yields ("data", bytes) in order and ("gap", first_missing, count) where
+    chunks were lost.
+    """
+    pending = {}
+    expected = None
+    cursors = [iter(frames) for frames in frame_lists]
+    while cursors or pending:
+        for cursor in list(cursors):
+            try:
+                sequence, data = next(cursor)
+            except StopIteration:
+                cursors.remove(cursor)
+                continue
+            pending[sequence] = data
+            if expected is None:
+                expected = sequence
+        while expected is not None and expected in pending:
+            yield ("data", pending.pop(expected))
+            expected = (expected + 1) & 0xFFFF
+        if pending and (len(pending) > STRIPE_REORDER_WINDOW or not cursors):
+            # Skip to the oldest chunk we have, in sequence order from expected
+            nearest = min(pending, key=lambda s: (s - expected) & 0xFFFF)
+            yield ("gap", expected, (nearest - expected) & 0xFFFF)
+            expected = nearest
+
+
+def read_stripe_frames(path):
+    """Yield (sequence, data) for each stripe frame in one link's capture."""
+    for event in read_events(path):
+        if event[0] == "frame" and event[1] == FRAME_TYPE_STRIPE:
+            payload = event[2]
+            if len(payload) >= 2:
+                yield (payload[0] | (payload[1] << 8), payload[2:])
+
+
+# ============================================================================
+# Variable watch
+# ============================================================================
+
+_WATCH_TYPES = {
+    "u8": "<B", "i8": "<b", "u16": "<H", "i16": "<h", "u32": "<I",
+    "i32": "<i", "u64": "<Q", "i64": "<q", "f32": "<f", "f64": "<d",
+}
+
+
+def parse_watch_layout(payload):
+    """Return a list of (address, size) tuples."""
+    return [struct.unpack_from("<IB", payload, i)
+            for i in range(0, len(payload) - 4, 5)]
+
+
+def format_watch_value(data, type_name):
+    if type_name == "text":
+        return data.decode("ascii", "replace").rstrip("\0")
+    if type_name in _WATCH_TYPES:
+        fmt = _WATCH_TYPES[type_name]
+        if struct.calcsize(fmt) == len(data):
+            return str(struct.unpack(fmt, data)[0])
+    if type_name == "hex" or len(data) > 8:
+        return data.hex()
+    return str(int.from_bytes(data, "little"))
+
+
+# ============================================================================
+# Profiler
+# ============================================================================
+
+PROFILE_HEADER = struct.Struct("<IIII")  # tick, taken, dropped, cycles
+
+
+def parse_profile_frame(payload):
+    """Return (tick, taken, dropped, cycles, pcs) or None if malformed."""
+    if len(payload) < PROFILE_HEADER.size or len(payload) % 4:
+        return None
+    header = PROFILE_HEADER.unpack_from(payload)
+    pcs = struct.unpack_from("<%dI" % ((len(payload) - PROFILE_HEADER.size)
+                                       // 4), payload, PROFILE_HEADER.size)
+    return header + (pcs,)
+
+
+class ElfSymbols:
+    """Function symbols of a 32-bit little-endian ELF, for PC lookup."""
+
+    STT_FUNC = 2
+    SHT_SYMTAB = 2
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ValueError("%s: not a 32-bit little-endian ELF" % path)
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+        sections = [struct.unpack_from("<IIIIIIIIII", data,
+                                       shoff + i * shentsize)
+                    for i in range(shnum)]
+        functions = []
+        for section in sections:
+            if section[1] != self.SHT_SYMTAB:
+                continue
+            strtab = sections[section[6]]
+            for offset in range(section[4], section[4] + section[5], 16):
+                name, value, size, info = struct.unpack_from("<IIIB", data,
+                                                             offset)
+                if info & 0xF != self.STT_FUNC or size == 0:
+                    continue
+                start = strtab[4] + name
+                symbol = data[start:data.index(b"\0", start)].decode(
+                    "ascii", "replace")
+                # Bit 0 marks Thumb code, it is not part of the address
+                functions.append((value & ~1, size, symbol))
+        functions.sort()
+        self._starts = [start for start, _, _ in functions]
+        self._functions = functions
+
+    def lookup(self, pc):
+        i = bisect.bisect_right(self._starts, pc) - 1
+        if i >= 0:
+            start, size, name = self._functions[i]
+            if pc < start + size:
+                return name
+        return None
+
+
+# ============================================================================
+# Workload replay
+# ============================================================================
+
+TRACE_RECORD = struct.Struct("<IHBx")  # time_us, length, fd
+
+
+def read_write_trace(path, dictionary=None):
+    """Return ([(time_s, fd, length)], lost) from a capture or a CSV file.
+
+    CSV files hold one "time_us,fd,length" row per _write call.
+    """
+    events = []
+    lost = 0
+    if path.endswith(".csv"):
+        with open(path) as f:
+            for row in f:
+                fields = row.strip().split(",")
+                if len(fields) == 3 and fields[0].isdigit():
+                    events.append((int(fields[0]) * 1e-6, int(fields[1]),
+                                   int(fields[2])))
+        return events, lost
+
+    offset = 0.0
+    previous = None
+    for event in read_events(path, dictionary):
+        if event[0] != "frame" or event[1] != FRAME_TYPE_WRITE_TRACE:
+            continue
+        payload = event[2]
+        if len(payload) < 4 or (len(payload) - 4) % TRACE_RECORD.size:
+            continue
+        lost = struct.unpack_from("<I", payload)[0]
+        for time_us, length, fd in TRACE_RECORD.iter_unpack(payload[4:]):
+            # Unwrap the 32-bit microsecond clock (the target keeps it
+            # monotonic across CYCCNT wraps)
+            if previous is not None and time_us < previous:
+                offset += 2 ** 32 * 1e-6
+            previous = time_us
+            events.append((offset + time_us * 1e-6, fd, length))
+    return events, lost
+
+
+def simulate_tx(events, buffer_size, baud, gap_s=0.0, bits_per_byte=10):
+    """Replay _write calls through a model of TX buffer, DMA and UART.
+
+    Mirrors src/hal_dma_printf.cc: a message is dropped whole when it does
+    not fit, bytes handed to the DMA stay reserved until the transfer
+    completes, a transfer never crosses the end of the ring, and the next
+    transfer starts from the completion callback (after gap_s).
+    """
+    byte_s = bits_per_byte / float(baud)
+    state = {"read": 0, "write": 0, "dma": 0, "end": None, "sent": 0,
+             "busy_s": 0.0}
+    messages = collections.deque()  # (end position, enqueue time)
+    latencies = []
+    result = {"overflows": 0, "dropped_bytes": 0, "peak_fill": 0}
+
+    def available():
+        return (state["write"] - state["read"]) % buffer_size
+
+    def start(now):
+        if state["write"] < state["read"]:
+            size = buffer_size - state["read"]
+            state["read"] = 0
+        else:
+            size = state["write"] - state["read"]
+            state["read"] = state["write"]
+        state["dma"] = size
+        state["end"] = now + gap_s + size * byte_s
+        state["busy_s"] += size * byte_s
+
+    def complete():
+        now = state["end"]
+        state["sent"] += state["dma"]
+        state["dma"] = 0
+        state["end"] = None
+        while messages and messages[0][0] <= state["sent"]:
+            latencies.append(now - messages.popleft()[1])
+        if available():
+            start(now)
+        return now
+
+    written = 0
+    finish = events[0][0] if events else 0.0
+    for now, _, length in events:
+        while state["end"] is not None and state["end"] <= now:
+            complete()
+        fill = available() + state["dma"]
+        if length > buffer_size - 1 - fill:
+            result["overflows"] += 1
+            result["dropped_bytes"] += length
+            continue
+        state["write"] = (state["write"] + length) % buffer_size
+        written += length
+        messages.append((written, now))
+        result["peak_fill"] = max(result["peak_fill"], fill + length)
+        if state["end"] is None:
+            start(now)
+        finish = now
+    while state["end"] is not None:
+        finish = complete()
+
+    duration = finish - events[0][0] if events else 0.0
+    latencies.sort()
+    result["latency"] = latencies
+    result["utilisation"] = state["busy_s"] / duration if duration else 0.0
+    return result
+
+
+def percentile(sorted_values, fraction):
+    if not sorted_values:
+        return 0.0
+    index = min(int(fraction * len(sorted_values)), len(sorted_values) - 1)
+    return sorted_values[index]
+
+
+# ============================================================================
+# Bulk decoding
+# ============================================================================
+
+# Capture files are cut into chunks of about this size for parallel decoding
+DECODE_CHUNK_SIZE = 8 << 20
+
+# A chunk is fed to its decoder in pieces of this size, which stay in cache
+DECODE_FEED_SIZE = 64 << 10
+
+_SYNC_BYTE = bytes([FRAME_SYNC])
+
+
+def find_chunk_boundary(data, start, pos, end):
+    """Return the first offset in [pos, end) where decoding can restart.
+
+    That is a sync byte StreamDecoder would look at, or the position after
+    a newline in text. Both start from fresh decoder state (text has no
+    escape pending after a newline). Payloads have zero bytes of their own,
+    so frames are walked from start, a restart point, like StreamDecoder
+    does; only their headers and checksums are read. Returns end if there
+    is none, or if the decoder would wait at a frame cut short by the end.
+    """
+    walk = start
+    while True:
+        sync = data.find(_SYNC_BYTE, walk, end)
+        newline = data.find(b"\n", max(walk, pos), end if sync < 0 else sync)
+        if newline >= 0:
+            return newline + 1
+        if sync < 0:
+            return end
+        if sync >= pos:
+            return sync
+        if end - sync < 4:
+            return end
+        length = data[sync + 2] | (data[sync + 3] << 8)
+        size = length + FRAME_OVERHEAD
+        if length > FRAME_MAX_PAYLOAD:
+            walk = sync + 1
+        elif end - sync < size:
+            return end
+        elif sum(data[sync + 1:sync + size]) & 0xFF:
+            walk = sync + 1
+        else:
+            walk = sync + size
+
+
+def render_decoded(events, show_frames):
+    """Return the output of decode for a list of events."""
+    out = bytearray()
+    for event in events:
+        if event[0] == "text":
+            out += event[1]
+        elif show_frames and event[1] not in (FRAME_TYPE_PADDING,
+                                              FRAME_TYPE_SEQUENCE,
+                                              FRAME_TYPE_ENCODING):
+            out += b"<frame type=0x%02x size=%d>\n" % (event[1],
+                                                       len(event[2]))
+    return bytes(out)
+
+
+# Per worker process: the mapped capture and the decode options
+_worker = {}
+
+
+def _init_decode_worker(path, dictionary, show_frames):
+    with open(path, "rb") as f:
+        _worker["data"] = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    _worker["entries"] = (load_dictionary_header(dictionary)
+                          if dictionary else None)
+    _worker["show_frames"] = show_frames
+
+
+def _decode_chunk(start, end, final):
+    entries = _worker["entries"]
+    decoder = StreamDecoder(DictionaryDecoder(entries) if entries else None)
+    data = _worker["data"]
+    events = []
+    for pos in range(start, end, DECODE_FEED_SIZE):
+        stop = min(pos + DECODE_FEED_SIZE, end)
+        events += decoder.feed(data[pos:stop], final and stop == end)
+    return render_decoded(events, _worker["show_frames"])
+
+
+def _chunk_spans(data):
+    start, size = 0, len(data)
+    while start < size:
+        end = find_chunk_boundary(data, start,
+                                  min(start + DECODE_CHUNK_SIZE, size), size)
+        # Every chunk but the last ends where the next one restarts
+        yield start, end, end < size
+        start = end
+
+
+def decode_file(path, out, jobs=1, dictionary=None, show_frames=False):
+    """Decode a capture file chunk by chunk, on jobs processes if above 1.
+
+    The capture is cut at restart points (find_chunk_boundary) and each
+    chunk is decoded with fresh decoder state. Output is written in capture
+    order, with at most two chunks per process in flight.
+    Returns the capture size.
+    """
+    with open(path, "rb") as f:
+        size = os.fstat(f.fileno()).st_size
+        if size == 0:
+            return 0
+        data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    with data:
+        if jobs <= 1:
+            _init_decode_worker(path, dictionary, show_frames)
+            for span in _chunk_spans(data):
+                out.write(_decode_chunk(*span))
+            return size
+        with multiprocessing.Pool(jobs, _init_decode_worker,
+                                  (path, dictionary, show_frames)) as pool:
+            pending = collections.deque()
+            for span in _chunk_spans(data):
+                pending.append(pool.apply_async(_decode_chunk, span))
+                if len(pending) > 2 * jobs:
+                    out.write(pending.popleft().get())
+            while pending:
+                out.write(pending.popleft().get())
+    return size
+
+
+# ============================================================================
+# Indexed captures
+# ============================================================================
+
+# record writes the TX stream to the capture file unchanged as it arrives, so
+# every subcommand reads it as before, and appends one fixed-size entry per
+# block to CAPTURE.idx. Blocks start where decoding can restart, so readers
+# find a time or frame type in the mapped index and decode from that block.
+INDEX_SUFFIX = ".idx"
+INDEX_MAGIC = b"HDPCIDX1"
+INDEX_HEADER = struct.Struct("<8sI4x")  # magic, entry size
+# Capture offset, host time of the first byte (seconds since the epoch),
+# size, content mask, first and last sequence tag, flags
+INDEX_ENTRY = struct.Struct("<QdIIHHH2x")
+
+# Content mask bits; frame type N sets bit N (types 1 to 31)
+INDEX_TEXT = 0x01
+
+# Entry flags
+INDEX_DICTIONARY = 0x01  # Dictionary text active at the block start
+INDEX_SEQUENCE = 0x02  # Block has sequence tags
+
+# A block ends at the first restart point after this many bytes or seconds
+INDEX_BLOCK_SIZE = 64 << 10
+INDEX_BLOCK_SECONDS = 1.0
+
+# How often a followed capture is checked for new data
+FOLLOW_INTERVAL = 0.2
+
+
+def frame_types_mask(*frame_types):
+    """Return the content mask of blocks holding any of these frames."""
+    mask = 0
+    for frame_type in frame_types:
+        mask |= 1 << frame_type
+    return mask
+
+
+class CaptureRecorder:
+    """Write a live TX stream to a capture file and its block index."""
+
+    def __init__(self, path, negotiated=False, block_size=INDEX_BLOCK_SIZE,
+                 block_seconds=INDEX_BLOCK_SECONDS):
+        self._data = open(path, "wb")
+        self._index = open(path + INDEX_SUFFIX, "wb")
+        self._index.write(INDEX_HEADER.pack(INDEX_MAGIC, INDEX_ENTRY.size))
+        self._index.flush()
+        self._decoder = StreamDecoder(None, negotiated)
+        self._block_size = block_size
+        self._block_seconds = block_seconds
+        self._size = 0
+        self._block = None
+        # A dictionary escape (0x7F) ending the text so far applies to the
+        # next text byte, so no block may start there
+        self._escape_pending = False
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def write(self, data, now=None):
+        """Append bytes received at now (time.time() if None)."""
+        if not data:
+            return
+        now = time.time() if now is None else now
+        self._data.write(data)
+        self._data.flush()
+        if self._block is None:
+            self._start_block(self._size, now)
+
+        block = self._block
+        for event in self._decoder.feed(data):
+            if event[0] == "text":
+                if event[1]:
+                    block["mask"] |= INDEX_TEXT
+                    self._escape_pending = event[1][-1] == DICT_ESCAPE
+                continue
+            if event[1] < 32:
+                block["mask"] |= 1 << event[1]
+            if event[1] == FRAME_TYPE_SEQUENCE:
+                tag = parse_sequence_frame(event[2])
+                if tag is not None:
+                    if not block["flags"] & INDEX_SEQUENCE:
+                        block["first_sequence"] = tag[0]
+                    block["last_sequence"] = tag[0]
+                    block["flags"] |= INDEX_SEQUENCE
+        self._size += len(data)
+
+        # Everything but the bytes held back has been decoded
+        cut = self._size - self._decoder.pending
+        if (cut > block["offset"] and not self._escape_pending and
+                (cut - block["offset"] >= self._block_size or
+                 now - block["time"] >= self._block_seconds)):
+            self._end_block(cut)
+            self._start_block(cut, now)
+
+    def close(self):
+        if self._block is not None and self._size > self._block["offset"]:
+            self._end_block(self._size)
+        self._block = None
+        self._data.close()
+        self._index.close()
+
+    def _start_block(self, offset, now):
+        flags = INDEX_DICTIONARY if self._decoder.dictionary_active else 0
+        self._block = {"offset": offset, "time": now, "mask": 0,
+                       "first_sequence": 0, "last_sequence": 0,
+                       "flags": flags}
+
+    def _end_block(self, end):
+        block = self._block
+        self._index.write(INDEX_ENTRY.pack(
+            block["offset"], block["time"], end - block["offset"],
+            block["mask"], block["first_sequence"], block["last_sequence"],
+            block["flags"]))
+        self._index.flush()
+
+
+class CaptureIndex:
+    """Memory-mapped block index of a capture written by record.
+
+    Entries are fixed-size and in capture order, so a time is found by
+    bisection without reading the index. Bytes after the last entry belong
+    to the block record is still writing.
+    """
+
+    def __init__(self, index_map):
+        self._map = index_map
+        self.times = _IndexTimes(self)
+
+    @classmethod
+    def open(cls, path):
+        """Return the index of a capture file, or None if it has none."""
+        try:
+            f = open(path + INDEX_SUFFIX, "rb")
+        except FileNotFoundError:
+            return None
+        with f:
+            if os.fstat(f.fileno()).st_size < INDEX_HEADER.size:
+                return None
+            index_map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, entry_size = INDEX_HEADER.unpack_from(index_map)
+        if magic != INDEX_MAGIC or entry_size != INDEX_ENTRY.size:
+            index_map.close()
+            sys.exit("%s is not a capture index" % (path + INDEX_SUFFIX))
+        return cls(index_map)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self._map.close()
+
+    def __len__(self):
+        return (len(self._map) - INDEX_HEADER.size) // INDEX_ENTRY.size
+
+    def __getitem__(self, i):
+        """Return (offset, time, size, mask, first_sequence, last_sequence,
+        flags) of block i."""
+        if not 0 <= i < len(self):
+            raise IndexError(i)
+        return INDEX_ENTRY.unpack_from(self._map,
+                                       INDEX_HEADER.size + i * INDEX_ENTRY.size)
+
+    def select(self, since=None, until=None, types=0):
+        """Return the blocks in a time range holding the given content.
+
+        since and until are seconds from the first block. A block is kept
+        if any of its time span falls in the range and its content mask
+        shares a bit with types (all blocks if 0).
+        """
+        count = len(self)
+        if count == 0:
+            return []
+        start = self.times[0]
+        first = 0
+        if since is not None:
+            first = max(bisect.bisect_right(self.times, start + since) - 1, 0)
+        last = count
+        if until is not None:
+            last = bisect.bisect_left(self.times, start + until)
+        return [i for i in range(first, last)
+                if not types or self[i][3] & types]
+
+    def read_events(self, f, decoder, since=None, until=None, types=0):
+        """Decode the selected blocks of capture f.
+
+        Unless until is given, f is left at the unindexed tail, ready for
+        decoder to continue with.
+        """
+        blocks = self.select(since, until, types)
+        end = 0
+        # The tail continues the last block, so decode that one too
+        if until is None and len(self) and blocks[-1:] != [len(self) - 1]:
+            blocks.append(len(self) - 1)
+        for i in blocks:
+            offset, _, size, _, _, _, flags = self[i]
+            if offset != end:
+                decoder.restart(bool(flags & INDEX_DICTIONARY))
+                f.seek(offset)
+            remaining = size
+            while remaining:
+                chunk = f.read(min(remaining, 4096))
+                if not chunk:
+                    return
+                remaining -= len(chunk)
+                yield from decoder.feed(chunk)
+            end = offset + size
+        if f.tell() != end:
+            f.seek(end)
+
+
+class _IndexTimes:
+    """Block start times of a CaptureIndex as a sequence, for bisect."""
+
+    def __init__(self, index):
+        self._index = index
+
+    def __len__(self):
+        return len(self._index)
+
+    def __getitem__(self, i):
+        return self._index[i][1]
+
+
+# ============================================================================
+# Command line
+# ============================================================================
+
+
+# Must match kHeartbeatByte in src/hal_dma_printf.cc; the target's _read
+# discards it, so it never shows up as console input.
+HEARTBEAT_BYTE = b"\x00"
+
+
+# Well inside HAL_DMA_PRINTF_NEGOTIATION_TIMEOUT_MS (default 2000 ms)
+HELLO_INTERVAL = 0.5
+
+
+class SerialInput:
+    """Live serial port that optionally sends heartbeats or hellos."""
+
+    def __init__(self, spec, heartbeat=None, hello=None):
+        try:
+            import serial
+        except ImportError:
+            sys.exit("pyserial is required for serial: inputs")
+        port, _, baud = spec.partition("@")
+        self._port = serial.Serial(port, int(baud or 115200), timeout=0.1)
+        self._heartbeat = heartbeat
+        self._next_heartbeat = 0.0
+        if hello is not None:
+            # Hellos are RX activity too, so they also keep gating open
+            self._heartbeat = min(heartbeat or HELLO_INTERVAL, HELLO_INTERVAL)
+        self._keepalive = hello or HEARTBEAT_BYTE
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self._port.close()
+
+    def read(self, size):
+        while True:
+            if self._heartbeat and time.monotonic() >= self._next_heartbeat:
+                self._port.write(self._keepalive)
+                self._next_heartbeat = time.monotonic() + self._heartbeat
+            data = self._port.read(size)
+            if data:
+                return data
+
+
+def _open_input(path, heartbeat=None, hello=None):
+    if path == "-":
+        return sys.stdin.buffer
+    if path.startswith("serial:"):
+        return SerialInput(path[len("serial:"):], heartbeat, hello)
+    return open(path, "rb")
+
+
+def cmd_gen_dict(args):
+    with open(args.corpus, "rb") as f:
+        corpus = f.read()
+    entries = train_dictionary(corpus, args.max_entries)
+    source_name = os.path.basename(args.corpus)
+    if args.output == "-":
+        sys.stdout.write(render_dictionary_header(entries, source_name))
+    else:
+        header = render_dictionary_header(entries, source_name,
+                                          os.path.basename(args.output))
+        with open(args.output, "w", encoding="ascii", newline="\n") as f:
+            f.write(header)
+    return 0
+
+
+def cmd_decode(args):
+    out = sys.stdout.buffer
+    is_file = args.input != "-" and not args.input.startswith("serial:")
+    started = time.perf_counter()
+    ranged = (args.since is not None or args.until is not None or
+              args.follow)
+    if is_file and not args.negotiate and not ranged:
+        jobs = args.jobs or os.cpu_count() or 1
+        size = decode_file(args.input, out, jobs, args.dictionary,
+                           args.show_frames)
+        out.flush()
+        if args.stats:
+            elapsed = time.perf_counter() - started
+            print("decode: %d bytes in %.3f s, %.3f GB/s (%d jobs)"
+                  % (size, elapsed, size / elapsed / 1e9 if elapsed else 0.0,
+                     jobs), file=sys.stderr)
+        return 0
+
+    for event in read_events(args.input, args.dictionary, args.heartbeat,
+                             args.negotiate, args.since, args.until,
+                             follow=args.follow):
+        out.write(render_decoded([event], args.show_frames))
+        out.flush()
+    return 0
+
+
+def cmd_record(args):
+    hello = negotiation_hello(args.dictionary) if args.negotiate else None
+    with _open_input(args.input, args.heartbeat, hello) as f, \
+            CaptureRecorder(args.output, args.negotiate, args.block_size,
+                            args.block_seconds) as recorder:
+        # Take what has arrived rather than waiting for a full read
+        read = getattr(f, "read1", f.read)
+        try:
+            while True:
+                chunk = read(4096)
+                if not chunk:
+                    break
+                recorder.write(chunk)
+        except KeyboardInterrupt:
+            pass
+    return 0
+
+
+def cmd_watch(args):
+    types = args.types.split(",") if args.types else []
+    layout = None
+    frames = frame_types_mask(FRAME_TYPE_WATCH_LAYOUT,
+                              FRAME_TYPE_WATCH_SAMPLE)
+    for event in read_events(args.input, args.dictionary, args.heartbeat,
+                             args.negotiate, args.since, args.until, frames,
+                             args.follow):
+        if event[0] != "frame":
+            continue
+        _, frame_type, payload = event
+        if frame_type == FRAME_TYPE_WATCH_LAYOUT:
+            new_layout = parse_watch_layout(payload)
+            if new_layout != layout:
+                layout = new_layout
+                print(",".join(["tick_ms"] + ["0x%08x" % addr
+                                              for addr, _ in layout]))
+        elif frame_type == FRAME_TYPE_WATCH_SAMPLE and layout is not None:
+            expected = 4 + sum(size for _, size in layout)
+            if len(payload) != expected:
+                continue
+            row = [str(struct.unpack_from("<I", payload)[0])]
+            offset = 4
+            for i, (_, size) in enumerate(layout):
+                type_name = types[i] if i < len(types) else ""
+                row.append(format_watch_value(payload[offset:offset + size],
+                                              type_name))
+                offset += size
+            print(",".join(row), flush=True)
+    return 0
+
+
+def cmd_unstripe(args):
+    out = sys.stdout.buffer
+    links = [read_stripe_frames(path) for path in args.inputs]
+    for event in unstripe(links):
+        if event[0] == "data":
+            out.write(event[1])
+        else:
+            sys.stderr.write("unstripe: %d chunk(s) lost at sequence %d\n"
+                             % (event[2], event[1]))
+    out.flush()
+    return 0
+
+
+def cmd_profile(args):
+    symbols = ElfSymbols(args.elf) if args.elf else None
+    histogram = collections.Counter()
+    first = last = None
+    for event in read_events(args.input, args.dictionary, since=args.since,
+                             until=args.until,
+                             types=frame_types_mask(FRAME_TYPE_PROFILE)):
+        if event[0] != "frame" or event[1] != FRAME_TYPE_PROFILE:
+            continue
+        frame = parse_profile_frame(event[2])
+        if frame is None:
+            continue
+        first = first or frame
+        last = frame
+        for pc in frame[4]:
+            name = symbols.lookup(pc) if symbols else None
+            histogram[name or "0x%08x" % pc] += 1
+    if last is None:
+        sys.stderr.write("profile: no profiler frames found\n")
+        return 1
+
+    total = sum(histogram.values())
+    for name, count in histogram.most_common(args.top):
+        print("%6d %5.1f%%  %s" % (count, 100.0 * count / total, name))
+
+    # Totals are running counters; report the span between the first and
+    # the last frame of the capture
+    taken = (last[1] - first[1]) & 0xFFFFFFFF
+    dropped = (last[2] - first[2]) & 0xFFFFFFFF
+    print("samples: %d received, %d dropped by the target"
+          % (total, dropped), file=sys.stderr)
+    elapsed_ms = (last[0] - first[0]) & 0xFFFFFFFF
+    if args.cpu_hz and elapsed_ms and last[3]:
+        cycles = (last[3] - first[3]) & 0xFFFFFFFF
+        print("profiler overhead: %.3f%% of CPU (%.0f cycles per sample)"
+              % (100.0 * cycles / (elapsed_ms * args.cpu_hz / 1000.0),
+                 cycles / max(taken, 1)), file=sys.stderr)
+    return 0
+
+
+def cmd_status(args):
+    types = args.types.split(",") if args.types else []
+    latest = {}
+    for event in read_events(args.input, args.dictionary, args.heartbeat,
+                             args.negotiate, args.since, args.until,
+                             frame_types_mask(FRAME_TYPE_STATUS),
+                             args.follow):
+        if event[0] != "frame" or event[1] != FRAME_TYPE_STATUS:
+            continue
+        payload = event[2]
+        if len(payload) < 2:
+            continue
+        key = payload[0]
+        type_name = types[key] if key < len(types) else ""
+        latest[key] = format_watch_value(payload[1:], type_name)
+        if not args.summary:
+            print("%d=%s" % (key, latest[key]), flush=True)
+    if args.summary:
+        for key in sorted(latest):
+            print("%d=%s" % (key, latest[key]))
+    return 0
+
+
+def _int_list(text):
+    return [int(float(value)) for value in text.split(",")]
+
+
+def cmd_replay(args):
+    events, lost = read_write_trace(args.input, args.dictionary)
+    if not events:
+        sys.stderr.write("replay: no write trace records found\n")
+        return 1
+    duration = events[-1][0] - events[0][0]
+    total = sum(length for _, _, length in events)
+    print("trace: %d writes, %d bytes over %.3f s (%d records lost on target)"
+          % (len(events), total, duration, lost))
+    print("%8s %8s %9s %9s %9s %9s %9s %9s %6s"
+          % ("buffer", "baud", "overflow", "dropped", "peak", "p50_ms",
+             "p99_ms", "max_ms", "util"))
+    for buffer_size in args.buffer_sizes:
+        for baud in args.baud_rates:
+            r = simulate_tx(events, buffer_size, baud, args.gap_us * 1e-6)
+            latency = r["latency"]
+            print("%8d %8d %9d %9d %9d %9.2f %9.2f %9.2f %5.1f%%"
+                  % (buffer_size, baud, r["overflows"], r["dropped_bytes"],
+                     r["peak_fill"], percentile(latency, 0.5) * 1e3,
+                     percentile(latency, 0.99) * 1e3,
+                     (latency[-1] if latency else 0.0) * 1e3,
+                     100.0 * r["utilisation"]))
+    return 0
+
+
+def cmd_check(args):
+    checker = SequenceChecker()
+    tags = 0
+    for event in read_events(args.input, args.dictionary, args.heartbeat,
+                             args.negotiate, args.since, args.until,
+                             frame_types_mask(FRAME_TYPE_SEQUENCE),
+                             args.follow):
+        if event[0] != "frame" or event[1] != FRAME_TYPE_SEQUENCE:
+            continue
+        tag = parse_sequence_frame(event[2])
+        if tag is None:
+            continue
+        tags += 1
+        restarts = checker.restarts
+        result = checker.feed(*tag)
+        if checker.restarts != restarts:
+            print("check: target restarted at #%d" % tag[0], flush=True)
+        if result is not None and (result[0] or result[1]):
+            print("check: #%d: %d missing, target reports %d dropped"
+                  % (tag[0], result[0], result[1]), flush=True)
+    if tags == 0:
+        sys.stderr.write("check: no sequence tags found\n")
+        return 1
+
+    print("messages: %d received, %d missing (%d dropped on target, "
+          "%d lost on link)" % (checker.received, checker.missing,
+                                checker.dropped, checker.link_lost))
+    return 1 if checker.link_lost else 0
+
+
+def cmd_latency(args):
+    reports = collections.OrderedDict()
+    for event in read_events(args.input, args.dictionary, args.heartbeat,
+                             types=frame_types_mask(FRAME_TYPE_LATENCY)):
+        if event[0] != "frame" or event[1] != FRAME_TYPE_LATENCY:
+            continue
+        report = parse_latency_frame(event[2])
+        if report is not None:
+            # Histograms are cumulative; the latest report per command wins
+            reports[report[0]] = report
+    if not reports:
+        sys.stderr.write("latency: no latency frames found\n")
+        return 1
+
+    print("%-8s %7s %-8s %9s %9s %9s" % ("command", "count", "stage",
+                                         "p50_us", "p99_us", "max_us"))
+    for name, count, max_us, histograms in reports.values():
+        for stage, histogram in enumerate(histograms):
+            print("%-8s %7s %-8s %9d %9d %9d"
+                  % (name if stage == 0 else "", count if stage == 0 else "",
+                     LATENCY_STAGES[stage],
+                     histogram_percentile_us(histogram, max_us[stage], 0.5),
+                     histogram_percentile_us(histogram, max_us[stage], 0.99),
+                     max_us[stage]))
+            if args.buckets:
+                print("  " + " ".join(
+                    "<%d:%d" % (latency_bucket_limit_us(bucket), value)
+                    for bucket, value in enumerate(histogram) if value))
+    return 0
+
+
+def _add_range_args(p, follow=True):
+    p.add_argument("--since", type=float, metavar="SECONDS",
+                   help="start this long into a capture written by record")
+    p.add_argument("--until", type=float, metavar="SECONDS",
+                   help="stop this long into a capture written by record")
+    if follow:
+        p.add_argument("--follow", action="store_true",
+                       help="keep reading a capture file as it grows")
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("gen-dict", help="train a static dictionary header")
+    p.add_argument("corpus", help="sample log corpus")
+    p.add_argument("-o", "--output", default="-", help="output header path")
+    p.add_argument("--max-entries", type=int, default=DICT_MAX_ENTRIES,
+                   choices=range(0, DICT_MAX_ENTRIES + 1), metavar="N")
+    p.set_defaults(func=cmd_gen_dict)
+
+    p = sub.add_parser("decode", help="decode a captured TX stream")
+    p.add_argument("input", nargs="?", default="-", help="capture file")
+    p.add_argument("--dictionary", help="dictionary header used by the target")
+    p.add_argument("--show-frames", action="store_true",
+                   help="print a marker for each binary frame")
+    p.add_argument("--heartbeat", type=float, metavar="SECONDS",
+                   help="send listener heartbeats on a serial: input")
+    p.add_argument("--negotiate", action="store_true",
+                   help="target starts in plain text; on a serial: input, "
+                        "ask it for frames and dictionary text")
+    p.add_argument("-j", "--jobs", type=int, default=1,
+                   help="decode a capture file on this many processes, 0 "
+                        "for one per CPU (not with --negotiate)")
+    p.add_argument("--stats", action="store_true",
+                   help="report decode throughput of a capture file")
+    _add_range_args(p)
+    p.set_defaults(func=cmd_decode)
+
+    p = sub.add_parser("record",
+                       help="write a TX stream to an indexed capture file")
+    p.add_argument("input", nargs="?", default="-",
+                   help="serial:PORT[@BAUD] or - for stdin")
+    p.add_argument("-o", "--output", required=True,
+                   help="capture file; the index goes to OUTPUT.idx")
+    p.add_argument("--dictionary",
+                   help="dictionary header used by the target; with "
+                        "--negotiate, ask for dictionary text")
+    p.add_argument("--heartbeat", type=float, metavar="SECONDS",
+                   help="send listener heartbeats on a serial: input")
+    p.add_argument("--negotiate", action="store_true",
+                   help="target starts in plain text; on a serial: input, "
+                        "ask it for frames")
+    p.add_argument("--block-size", type=int, default=INDEX_BLOCK_SIZE,
+                   help="bytes per index block")
+    p.add_argument("--block-seconds", type=float, default=INDEX_BLOCK_SECONDS,
+                   help="seconds per index block")
+    p.set_defaults(func=cmd_record)
+
+    p = sub.add_parser("watch", help="convert watch frames to CSV")
+    p.add_argument("input", nargs="?", default="-", help="capture file")
+    p.add_argument("--dictionary", help="dictionary header used by the target")
+    p.add_argument("--types",
+                   help="comma-separated value types in registration order "
+                        "(%s, hex)" % ", ".join(_WATCH_TYPES))
+    p.add_argument("--heartbeat", type=float, metavar="SECONDS",
+                   help="send listener heartbeats on a serial: input")
+    p.add_argument("--negotiate", action="store_true",
+                   help="target starts in plain text; on a serial: input, "
+                        "ask it for frames and dictionary text")
+    _add_range_args(p)
+    p.set_defaults(func=cmd_watch)
+
+    p = sub.add_parser("unstripe",
+                       help="merge captures of bonded UARTs (pipe the output "
+                            "into decode)")
+    p.add_argument("inputs", nargs=2, help="capture file of each link")
+    p.set_defaults(func=cmd_unstripe)
+
+    p = sub.add_parser("profile", help="histogram of profiler samples")
+    p.add_argument("input", nargs="?", default="-", help="capture file")
+    p.add_argument("--elf", help="firmware ELF for symbol names")
+    p.add_argument("--dictionary", help="dictionary header used by the target")
+    p.add_argument("--top", type=int, default=20, help="functions to list")
+    p.add_argument("--cpu-hz", type=float,
+                   help="core clock, to report the profiler overhead")
+    _add_range_args(p, follow=False)
+    p.set_defaults(func=cmd_profile)
+
+    p = sub.add_parser("status", help="print status channel updates")
+    p.add_argument("input", nargs="?", default="-", help="capture file")
+    p.add_argument("--dictionary", help="dictionary header used by the target")
+    p.add_argument("--types",
+                   help="comma-separated value types by key "
+                        "(%s, hex, text)" % ", ".join(_WATCH_TYPES))
+    p.add_argument("--summary", action="store_true",
+                   help="print only the last value of each key at the end")
+    p.add_argument("--heartbeat", type=float, metavar="SECONDS",
+                   help="send listener heartbeats on a serial: input")
+    p.add_argument("--negotiate", action="store_true",
+                   help="target starts in plain text; on a serial: input, "
+                        "ask it for frames and dictionary text")
+    _add_range_args(p)
+    p.set_defaults(func=cmd_status)
+
+    p = sub.add_parser("replay",
+                       help="replay a write trace over buffer sizes and "
+                            "baud rates")
+    p.add_argument("input", help="capture file with trace frames, or a "
+                                 "time_us,fd,length .csv")
+    p.add_argument("--dictionary", help="dictionary header used by the target")
+    p.add_argument("--buffer-sizes", type=_int_list, default=[1024],
+                   metavar="N,...", help="TX buffer sizes to try")
+    p.add_argument("--baud-rates", type=_int_list, default=[115200],
+                   metavar="N,...", help="baud rates to try")
+    p.add_argument("--gap-us", type=float, default=0.0,
+                   help="idle time between DMA transfers (ISR latency)")
+    p.set_defaults(func=cmd_replay)
+
+    p = sub.add_parser("check",
+                       help="check message sequence tags for lost messages")
+    p.add_argument("input", nargs="?", default="-", help="capture file")
+    p.add_argument("--dictionary", help="dictionary header used by the target")
+    p.add_argument("--heartbeat", type=float, metavar="SECONDS",
+                   help="send listener heartbeats on a serial: input")
+    p.add_argument("--negotiate", action="store_true",
+                   help="target starts in plain text; on a serial: input, "
+                        "ask it for frames and dictionary text")
+    _add_range_args(p)
+    p.set_defaults(func=cmd_check)
+
+    p = sub.add_parser("latency",
+                       help="command round-trip latency per stage")
+    p.add_argument("input", nargs="?", default="-", help="capture file")
+    p.add_argument("--dictionary", help="dictionary header used by the target")
+    p.add_argument("--buckets", action="store_true",
+                   help="also print the histogram bucket counts")
+    p.add_argument("--heartbeat", type=float, metavar="SECONDS",
+                   help="send listener heartbeats on a serial: input")
+    p.set_defaults(func=cmd_latency)
+
+    args = parser.parse_args(argv)
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())